@@ -0,0 +1,149 @@
+#ifndef ALIGNED_ARRAY_H
+#define ALIGNED_ARRAY_H
+
+#include <cstddef>
+#include <cstring>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * @class AlignedArray
+ * @brief Growable contiguous array whose storage starts on an Alignment-byte boundary.
+ *
+ * Used for the structure-of-arrays particle data so every column can be
+ * streamed with aligned vector loads. Only trivially copyable types are supported.
+ */
+template <typename T, std::size_t Alignment = 64>
+class AlignedArray {
+    static_assert(std::is_trivially_copyable<T>::value, "AlignedArray only holds trivially copyable types");
+
+public:
+    AlignedArray() = default;
+
+    AlignedArray(const AlignedArray& other) {
+        reserve(other.count);
+        if (other.count > 0) {
+            std::memcpy(items, other.items, other.count * sizeof(T));
+        }
+        count = other.count;
+    }
+
+    AlignedArray(AlignedArray&& other) noexcept
+        : items(other.items), count(other.count), capacity(other.capacity) {
+        other.items = nullptr;
+        other.count = 0;
+        other.capacity = 0;
+    }
+
+    AlignedArray& operator=(AlignedArray other) noexcept {
+        std::swap(items, other.items);
+        std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
+        return *this;
+    }
+
+    ~AlignedArray() {
+        release();
+    }
+
+    /**
+     * @brief Ensures room for at least newCapacity elements without reallocating.
+     *
+     * @param newCapacity Minimum number of elements to hold.
+     */
+    void reserve(std::size_t newCapacity) {
+        if (newCapacity <= capacity) return;
+
+        T* newItems = static_cast<T*>(::operator new(newCapacity * sizeof(T), std::align_val_t(Alignment)));
+        if (count > 0) {
+            std::memcpy(newItems, items, count * sizeof(T));
+        }
+        release();
+        items = newItems;
+        capacity = newCapacity;
+    }
+
+    /**
+     * @brief Resizes the array, value-initializing any new elements.
+     *
+     * @param newSize New number of elements.
+     */
+    void resize(std::size_t newSize) {
+        reserve(newSize);
+        for (std::size_t i = count; i < newSize; i++) {
+            items[i] = T();
+        }
+        count = newSize;
+    }
+
+    /**
+     * @brief Resizes the array without initializing any elements, so they can be filled in parallel.
+     *
+     * Existing elements are not kept; every element must be written before it is read.
+     *
+     * @param newSize New number of elements.
+     */
+    void resizeForOverwrite(std::size_t newSize) {
+        count = 0;
+        reserve(newSize);
+        count = newSize;
+    }
+
+    /**
+     * @brief Appends an element, growing geometrically when full.
+     *
+     * @param value Element to append.
+     */
+    void push_back(const T& value) {
+        if (count == capacity) {
+            reserve(capacity == 0 ? 16 : capacity * 2);
+        }
+        items[count++] = value;
+    }
+
+    /**
+     * @brief Replaces the contents with a copy of n elements, writing each element once.
+     *
+     * @param first First element to copy.
+     * @param n Number of elements to copy.
+     */
+    void assign(const T* first, std::size_t n) {
+        // Nothing worth keeping is copied when the storage grows
+        count = 0;
+        reserve(n);
+        if (n > 0) {
+            std::memcpy(items, first, n * sizeof(T));
+        }
+        count = n;
+    }
+
+    void clear() { count = 0; }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T& operator[](std::size_t i) { return items[i]; }
+    const T& operator[](std::size_t i) const { return items[i]; }
+
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+private:
+    void release() {
+        if (items != nullptr) {
+            ::operator delete(items, std::align_val_t(Alignment));
+            items = nullptr;
+        }
+    }
+
+    T* items = nullptr;       /* Aligned element storage */
+    std::size_t count = 0;    /* Number of live elements */
+    std::size_t capacity = 0; /* Number of allocated elements */
+};
+
+#endif
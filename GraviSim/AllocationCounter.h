@@ -0,0 +1,139 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// -----------------------------------------------
+// ALLOCATION COUNTER
+// Counts heap allocations made through operator
+// new, on every thread, so a caller can check
+// that a frame or step allocated nothing.
+//
+// Counting replaces the global operator new and
+// delete, which must be defined once per program;
+// each of GraviSim's executables is a single
+// translation unit. Debug builds count by default;
+// define GRAVISIM_COUNT_ALLOCATIONS to count in
+// release builds as well.
+// -----------------------------------------------
+
+#if !defined(GRAVISIM_COUNT_ALLOCATIONS) && !defined(NDEBUG)
+#define GRAVISIM_COUNT_ALLOCATIONS
+#endif
+
+/**
+ * @brief Gets the counter of heap allocations made so far.
+ */
+inline std::atomic<uint64_t>& getAllocationCounter() {
+    static std::atomic<uint64_t> counter{ 0 };
+    return counter;
+}
+
+/**
+ * @brief Gets the number of heap allocations made so far, or 0 if counting is compiled out.
+ */
+inline uint64_t getAllocationCount() {
+    return getAllocationCounter().load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Tells whether heap allocations are being counted.
+ */
+inline bool isCountingAllocations() {
+#ifdef GRAVISIM_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+#ifdef GRAVISIM_COUNT_ALLOCATIONS
+
+// The helpers stay out of line: once GCC inlines std::free into the replaced
+// operator delete, it pairs that free with operator new at the call site and
+// warns about mismatched allocation functions (-Wmismatched-new-delete)
+#ifdef _MSC_VER
+#define GRAVISIM_NOINLINE __declspec(noinline)
+#else
+#define GRAVISIM_NOINLINE __attribute__((noinline))
+#endif
+
+/**
+ * @brief Counts and performs one allocation for the replaced operator new.
+ */
+GRAVISIM_NOINLINE inline void* countedAllocate(std::size_t size, std::size_t alignment) {
+    getAllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    if (size == 0) size = 1;
+#ifdef _WIN32
+    return _aligned_malloc(size, alignment);
+#else
+    if (alignment <= alignof(std::max_align_t)) return std::malloc(size);
+    void* memory = nullptr;
+    return posix_memalign(&memory, alignment, size) == 0 ? memory : nullptr;
+#endif
+}
+
+/**
+ * @brief Frees memory from countedAllocate for the replaced operator delete.
+ */
+GRAVISIM_NOINLINE inline void countedFree(void* memory) {
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void* operator new(std::size_t size) {
+    void* memory = countedAllocate(size, alignof(std::max_align_t));
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size) {
+    void* memory = countedAllocate(size, alignof(std::max_align_t));
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* memory = countedAllocate(size, static_cast<std::size_t>(alignment));
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    void* memory = countedAllocate(size, static_cast<std::size_t>(alignment));
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return countedAllocate(size, alignof(std::max_align_t));
+}
+
+void operator delete(void* memory) noexcept { countedFree(memory); }
+void operator delete[](void* memory) noexcept { countedFree(memory); }
+void operator delete(void* memory, std::size_t) noexcept { countedFree(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { countedFree(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { countedFree(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { countedFree(memory); }
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept { countedFree(memory); }
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept { countedFree(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { countedFree(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { countedFree(memory); }
+
+#endif
+
+#endif
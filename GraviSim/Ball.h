@@ -2,100 +2,59 @@
 #define BALL_H
 
 #include <glm/gtc/matrix_transform.hpp>
+#include "BallSystem.h"
 
 /**
- * @brief Represents a ball with physics properties such as position, velocity, gravity, and damping.
+ * @brief Lightweight view of a single ball stored in a BallSystem.
+ *
+ * A Ball holds no state of its own; it reads and writes the ball's columns in
+ * the owning system, so it stays valid as long as the system does not shrink.
  */
 class Ball {
 public:
-    glm::vec3 position; // Position of the ball in 3D space.
-    glm::vec2 velocity; // Velocity of the ball in 2D (x, y) plane.
-	glm::vec3 color; // Color of the ball.
-    float radius; // Radius of the ball.
-    float gravity = -9.81f; // Gravity affecting the ball's motion.
-    float damping = 0.8f; // Damping factor applied during collisions.
-    float velocityThreshold = 0.01f; // Minimum velocity below which movement stops.
-    int segments; // Number of segments used to approximate the circle.
-
     /**
-     * @brief Constructs a Ball object with initial position, velocity, radius, and resolution.
+     * @brief Constructs a view of a ball in a system.
      *
-     * @param pos Initial position of the ball.
-     * @param vel Initial velocity of the ball.
-     * @param r Radius of the ball.
-     * @param res Number of segments for circle approximation.
+     * @param sys System that owns the ball.
+     * @param idx Index of the ball in the system.
      */
-    Ball(glm::vec3 pos, glm::vec2 vel,glm::vec3 col, float r, int res)
-        : position(pos), velocity(vel), radius(r), segments(res), color(col) {
+    Ball(BallSystem& sys, std::size_t idx)
+        : system(&sys), index(idx) {
     }
 
-    /**
-     * @brief Updates the ball's physics including position and velocity.
-     *
-     * @param deltaTime Time step for the physics update.
-     */
-    void updatePhysics(float deltaTime) {
-        // Apply gravity if above ground
-      
-       /* if (position.y - radius > -1.0f)
-            velocity.y += gravity * deltaTime;*/
+    std::size_t getIndex() const { return index; }
 
-        // Update position
-        position += glm::vec3(velocity * deltaTime, 0.0f);
+    glm::vec3 getPosition() const { return glm::vec3(system->x[index], system->y[index], 0.0f); }
+    glm::vec2 getVelocity() const { return glm::vec2(system->vx[index], system->vy[index]); }
+    glm::vec3 getColor() const { return glm::vec3(system->colorR[index], system->colorG[index], system->colorB[index]); }
+    float getRadius() const { return system->radius[index]; }
+    bool isSleeping() const { return system->isSleeping(index); }
+
+    // Moving a ball by hand wakes it and its island
+    void setPosition(glm::vec2 pos) {
+        system->wake(index);
+        system->x[index] = pos.x;
+        system->y[index] = pos.y;
+    }
 
-        // Handle collisions
-        handleCollisions();
+    void setVelocity(glm::vec2 vel) {
+        system->wake(index);
+        system->vx[index] = vel.x;
+        system->vy[index] = vel.y;
     }
 
     /**
-     * @brief Generates the vertex data for rendering the ball as a 2D circle.
+     * @brief Updates the ball's physics including position and velocity.
      *
-     * @param circleVertices Vector to store generated vertex data.
+     * @param deltaTime Time step for the physics update.
      */
-    void generateBallVertices(std::vector<float>& circleVertices) {
-        // Center position of the circle
-        circleVertices.push_back(0.0f);
-        circleVertices.push_back(0.0f);
-        circleVertices.push_back(0.0f);
-
-        // Generate circle vertices
-        for (int i = 0; i <= segments; i++) {
-            float angle = (2.0f * glm::pi<float>() * i) / segments;
-            float x = radius * cos(angle);
-            float y = radius * sin(angle);
-            circleVertices.push_back(x);
-            circleVertices.push_back(y);
-            circleVertices.push_back(0.0f);
-        }
+    void updatePhysics(float deltaTime) {
+        system->updatePhysics(index, index + 1, deltaTime);
     }
 
 private:
-    /**
-     * @brief Handles ball collisions with boundaries and applies response forces.
-     */
-    void handleCollisions() {
-        // Collision with left or right wall
-        if (position.x + radius >= 1.0f || position.x - radius <= -1.0f) {
-            velocity.x *= -damping;
-            position.x = glm::clamp(position.x, -1.0f + radius, 1.0f - radius);
-            if (fabs(velocity.x) < velocityThreshold) velocity.x = 0.0f;
-        }
-
-        // Collision with the ground
-        if (position.y - radius <= -1.0f) {
-            velocity.y *= -damping;
-            position.y = -1.0f + radius;
-            velocity.x *= damping;  // Apply ground friction
-            if (fabs(velocity.y) < velocityThreshold) velocity.y = 0.0f;
-            if (fabs(velocity.x) < velocityThreshold) velocity.x = 0.0f;
-        }
-        // Collision with the ceiling
-        else if (position.y + radius >= 1.0f) {
-            velocity.y *= -damping;
-            position.y = 1.0f - radius;
-            if (fabs(velocity.y) < velocityThreshold) velocity.y = 0.0f;
-        }
-    }
+    BallSystem* system; // System that owns the ball's data.
+    std::size_t index;  // Index of the ball in the system.
 };
 
 #endif
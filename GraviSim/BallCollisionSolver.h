@@ -0,0 +1,231 @@
+#ifndef BALL_COLLISION_SOLVER_H
+#define BALL_COLLISION_SOLVER_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include "BallSystem.h"
+#include "Broadphase.h"
+#include "Parallel.h"
+#include "UniformGridBroadphase.h"
+#include "SweepAndPruneBroadphase.h"
+
+/**
+ * @brief Broadphase algorithms that can be selected at runtime.
+ */
+enum class BroadphaseType {
+    None,         // Ball-ball collisions disabled
+    BruteForce,   // Test every pair
+    UniformGrid,  // Counting-sort spatial grid
+    SweepAndPrune // Incremental sort on the x axis
+};
+
+/**
+ * @brief Creates a broadphase of the given type.
+ *
+ * @param type Algorithm to create.
+ * @return The broadphase, or nullptr for BroadphaseType::None.
+ */
+inline std::unique_ptr<Broadphase> createBroadphase(BroadphaseType type) {
+    switch (type) {
+    case BroadphaseType::BruteForce:
+        return std::make_unique<BruteForceBroadphase>();
+    case BroadphaseType::UniformGrid:
+        return std::make_unique<UniformGridBroadphase>();
+    case BroadphaseType::SweepAndPrune:
+        return std::make_unique<SweepAndPruneBroadphase>();
+    default:
+        return nullptr;
+    }
+}
+
+/**
+ * @class BallCollisionSolver
+ * @brief Detects and resolves ball-ball collisions using a pluggable broadphase.
+ *
+ * Overlapping balls are pushed apart in proportion to their inverse mass (mass
+ * grows with radius squared) and receive an impulse along the contact normal
+ * whose restitution is the material's damping. Sleeping balls act as if their
+ * mass were infinite, so they stay where they fell asleep until woken.
+ *
+ * Contacts are greedily graph-colored so no two contacts of the same color
+ * share a ball. Colors are resolved one after another and the contacts of a
+ * color in parallel, which is race free and gives the same result for any
+ * thread count.
+ */
+class BallCollisionSolver {
+public:
+    explicit BallCollisionSolver(BroadphaseType type = BroadphaseType::UniformGrid) {
+        setBroadphase(type);
+    }
+
+    /**
+     * @brief Switches the pair search algorithm.
+     *
+     * @param type Algorithm to use from the next step on.
+     */
+    void setBroadphase(BroadphaseType type) {
+        broadphaseType = type;
+        broadphase = createBroadphase(type);
+    }
+
+    BroadphaseType getBroadphaseType() const { return broadphaseType; }
+    Broadphase* getBroadphase() const { return broadphase.get(); }
+    const std::vector<BallPair>& getPairs() const { return pairs; }
+
+    /**
+     * @brief Finds overlapping pairs and resolves them.
+     *
+     * @param balls System to resolve.
+     */
+    void solve(BallSystem& balls) {
+        if (!broadphase) {
+            pairs.clear();
+            return;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        broadphase->findPairs(balls, pairs);
+        auto end = std::chrono::steady_clock::now();
+        broadphase->getStats().timeMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        colorContacts(balls.size());
+        for (std::size_t color = 0; color + 1 < colorStart.size(); color++) {
+            const std::size_t begin = colorStart[color];
+            const std::size_t end = colorStart[color + 1];
+            // Contacts beyond the last color may share balls and are resolved serially
+            if (color == maxColors) {
+                resolvePairs(balls, coloredPairs.data() + begin, end - begin);
+                continue;
+            }
+            parallelFor(begin, end, 2048, [&](std::size_t rangeBegin, std::size_t rangeEnd) {
+                resolvePairs(balls, coloredPairs.data() + rangeBegin, rangeEnd - rangeBegin);
+            });
+        }
+    }
+
+    std::size_t getColorCount() const { return colorStart.empty() ? 0 : colorStart.size() - 1; }
+
+    /**
+     * @brief Resolves a list of contacts.
+     *
+     * @param balls System that owns the balls.
+     * @param contacts Pairs to resolve.
+     * @param contactCount Number of pairs.
+     */
+    static void resolvePairs(BallSystem& balls, const BallPair* contacts, std::size_t contactCount) {
+        for (std::size_t i = 0; i < contactCount; i++) {
+            resolvePair(balls, contacts[i].a, contacts[i].b);
+        }
+    }
+
+    /**
+     * @brief Separates two balls and applies a restitution impulse if they are approaching.
+     *
+     * @param balls System that owns the balls.
+     * @param a Index of the first ball.
+     * @param b Index of the second ball.
+     */
+    static void resolvePair(BallSystem& balls, uint32_t a, uint32_t b) {
+        float dx = balls.x[b] - balls.x[a];
+        float dy = balls.y[b] - balls.y[a];
+        const float rsum = balls.radius[a] + balls.radius[b];
+        const float dist2 = dx * dx + dy * dy;
+        if (dist2 >= rsum * rsum) return;
+
+        // Contact normal from a to b; coincident centers push apart along x
+        float dist = std::sqrt(dist2);
+        float nx = 1.0f, ny = 0.0f;
+        if (dist > 1e-6f) {
+            nx = dx / dist;
+            ny = dy / dist;
+        }
+
+        const float invMassA = balls.sleeping[a] ? 0.0f : 1.0f / (balls.radius[a] * balls.radius[a]);
+        const float invMassB = balls.sleeping[b] ? 0.0f : 1.0f / (balls.radius[b] * balls.radius[b]);
+        const float invMassSum = invMassA + invMassB;
+        if (invMassSum == 0.0f) return;
+
+        // Positional correction
+        const float penetration = rsum - dist;
+        balls.x[a] -= nx * penetration * invMassA / invMassSum;
+        balls.y[a] -= ny * penetration * invMassA / invMassSum;
+        balls.x[b] += nx * penetration * invMassB / invMassSum;
+        balls.y[b] += ny * penetration * invMassB / invMassSum;
+
+        // Velocity response, only when the balls move towards each other
+        const float relativeVelocity = (balls.vx[b] - balls.vx[a]) * nx + (balls.vy[b] - balls.vy[a]) * ny;
+        if (relativeVelocity >= 0.0f) return;
+
+        const float restitution = balls.material.damping;
+        const float impulse = -(1.0f + restitution) * relativeVelocity / invMassSum;
+        balls.vx[a] -= impulse * invMassA * nx;
+        balls.vy[a] -= impulse * invMassA * ny;
+        balls.vx[b] += impulse * invMassB * nx;
+        balls.vy[b] += impulse * invMassB * ny;
+    }
+
+private:
+    static constexpr std::size_t maxColors = 64; /* Colors tracked per ball in a 64-bit mask */
+
+    /**
+     * @brief Assigns each contact the lowest color not yet used by either of its balls and groups contacts by color.
+     *
+     * @param ballCount Number of balls in the system.
+     */
+    void colorContacts(std::size_t ballCount) {
+        ballColors.resize(ballCount, 0);
+        reserveWithHeadroom(contactColor, pairs.size());
+        reserveWithHeadroom(coloredPairs, pairs.size());
+        contactColor.resize(pairs.size());
+        // The color count is bounded, so reserving the bound once keeps a new highest count from reallocating
+        colorStart.reserve(maxColors + 2);
+        colorCursor.reserve(maxColors + 1);
+
+        std::size_t colorCount = 0;
+        for (std::size_t i = 0; i < pairs.size(); i++) {
+            const uint64_t used = ballColors[pairs[i].a] | ballColors[pairs[i].b];
+            std::size_t color = 0;
+            while (color < maxColors && (used & (uint64_t(1) << color))) color++;
+            if (color < maxColors) {
+                ballColors[pairs[i].a] |= uint64_t(1) << color;
+                ballColors[pairs[i].b] |= uint64_t(1) << color;
+            }
+            contactColor[i] = static_cast<uint8_t>(color);
+            colorCount = std::max(colorCount, color + 1);
+        }
+
+        // Counting sort of the contacts by color
+        colorStart.assign(colorCount + 1, 0);
+        for (std::size_t i = 0; i < pairs.size(); i++) {
+            colorStart[contactColor[i] + 1]++;
+        }
+        for (std::size_t color = 0; color < colorCount; color++) {
+            colorStart[color + 1] += colorStart[color];
+        }
+        colorCursor.assign(colorStart.begin(), colorStart.end() - 1);
+        coloredPairs.resize(pairs.size());
+        for (std::size_t i = 0; i < pairs.size(); i++) {
+            coloredPairs[colorCursor[contactColor[i]]++] = pairs[i];
+        }
+
+        // Reset only the masks that were touched
+        for (const BallPair& pair : pairs) {
+            ballColors[pair.a] = 0;
+            ballColors[pair.b] = 0;
+        }
+    }
+
+    BroadphaseType broadphaseType = BroadphaseType::None; /* Currently selected algorithm */
+    std::unique_ptr<Broadphase> broadphase;               /* Pair search, null when disabled */
+    std::vector<BallPair> pairs;                          /* Overlapping pairs of the last step */
+    std::vector<BallPair> coloredPairs;                   /* Pairs grouped by color */
+    std::vector<std::size_t> colorStart;                  /* First colored pair of each color, plus a sentinel */
+    std::vector<std::size_t> colorCursor;                 /* Scatter cursors used while grouping */
+    std::vector<uint8_t> contactColor;                    /* Color of each pair */
+    std::vector<uint64_t> ballColors;                     /* Colors already used by each ball's contacts */
+};
+
+#endif
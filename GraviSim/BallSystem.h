@@ -0,0 +1,301 @@
+#ifndef BALL_SYSTEM_H
+#define BALL_SYSTEM_H
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include "AlignedArray.h"
+#include "Parallel.h"
+#include "SimdKernels.h"
+
+/**
+ * @class BallSystem
+ * @brief Structure-of-arrays store for every ball in the simulation.
+ *
+ * Hot per-ball state (position, velocity, radius, color) lives in separate
+ * cache-line aligned columns, while parameters that are identical for every
+ * ball are kept once in a shared Material.
+ *
+ * Balls at rest can be put to sleep (see SleepSolver). A sleeping ball has zero
+ * velocity, is skipped by integration, does not move when touched and is only
+ * paired with awake balls. Balls that fell asleep together are linked into a
+ * ring through islandNext, so waking one of them wakes the whole island.
+ */
+class BallSystem {
+public:
+    /**
+     * @struct Material
+     * @brief Physics and render parameters shared by all balls.
+     */
+    struct Material {
+        float gravity = -9.81f;          /* Gravity affecting the balls' motion */
+        float damping = 0.8f;            /* Damping factor applied during collisions */
+        float velocityThreshold = 0.01f; /* Minimum velocity below which movement stops */
+        int segments = 25;               /* Number of segments used to approximate a circle */
+    };
+
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1); /* Returned when no ball matches */
+
+    AlignedArray<float> x;                /* Position x of each ball */
+    AlignedArray<float> y;                /* Position y of each ball */
+    AlignedArray<float> vx;               /* Velocity x of each ball */
+    AlignedArray<float> vy;               /* Velocity y of each ball */
+    AlignedArray<float> radius;           /* Radius of each ball */
+    AlignedArray<float> colorR;           /* Red color channel of each ball */
+    AlignedArray<float> colorG;           /* Green color channel of each ball */
+    AlignedArray<float> colorB;           /* Blue color channel of each ball */
+    AlignedArray<uint8_t> sleeping;       /* 1 while the ball is asleep */
+    AlignedArray<float> sleepTimer;       /* Time the ball has been at rest */
+    AlignedArray<uint32_t> islandNext;    /* Next ball of its sleeping island, itself while awake */
+    Material material;                    /* Parameters shared by every ball */
+    SimdLevel simdLevel = getSimdLevel(); /* Instruction set used by updatePhysics */
+
+    BallSystem() = default;
+
+    /**
+     * @brief Appends a ball to the system.
+     *
+     * @param pos Initial position of the ball.
+     * @param vel Initial velocity of the ball.
+     * @param col Color of the ball.
+     * @param r Radius of the ball.
+     * @return Index of the new ball.
+     */
+    std::size_t addBall(glm::vec2 pos, glm::vec2 vel, glm::vec3 col, float r) {
+        x.push_back(pos.x);
+        y.push_back(pos.y);
+        vx.push_back(vel.x);
+        vy.push_back(vel.y);
+        radius.push_back(r);
+        colorR.push_back(col.x);
+        colorG.push_back(col.y);
+        colorB.push_back(col.z);
+        sleeping.push_back(0);
+        sleepTimer.push_back(0.0f);
+        islandNext.push_back(static_cast<uint32_t>(x.size() - 1));
+        return x.size() - 1;
+    }
+
+    /**
+     * @brief Reserves storage for count balls in every column.
+     *
+     * @param count Number of balls to make room for.
+     */
+    void reserve(std::size_t count) {
+        x.reserve(count);
+        y.reserve(count);
+        vx.reserve(count);
+        vy.reserve(count);
+        radius.reserve(count);
+        colorR.reserve(count);
+        colorG.reserve(count);
+        colorB.reserve(count);
+        sleeping.reserve(count);
+        sleepTimer.reserve(count);
+        islandNext.reserve(count);
+    }
+
+    /**
+     * @brief Sets the number of balls without initializing any column, so they can be filled in parallel.
+     *
+     * Existing balls are not kept; every column of every ball must be written before the system is used.
+     *
+     * @param count Number of balls.
+     */
+    void resizeForOverwrite(std::size_t count) {
+        x.resizeForOverwrite(count);
+        y.resizeForOverwrite(count);
+        vx.resizeForOverwrite(count);
+        vy.resizeForOverwrite(count);
+        radius.resizeForOverwrite(count);
+        colorR.resizeForOverwrite(count);
+        colorG.resizeForOverwrite(count);
+        colorB.resizeForOverwrite(count);
+        sleeping.resizeForOverwrite(count);
+        sleepTimer.resizeForOverwrite(count);
+        islandNext.resizeForOverwrite(count);
+    }
+
+    /**
+     * @brief Removes every ball while keeping the allocated storage.
+     */
+    void clear() {
+        x.clear();
+        y.clear();
+        vx.clear();
+        vy.clear();
+        radius.clear();
+        colorR.clear();
+        colorG.clear();
+        colorB.clear();
+        sleeping.clear();
+        sleepTimer.clear();
+        islandNext.clear();
+    }
+
+    std::size_t size() const { return x.size(); }
+    bool isSleeping(std::size_t i) const { return sleeping[i] != 0; }
+
+    /**
+     * @brief Wakes a ball together with every ball of its sleeping island.
+     *
+     * @param i Index of the ball.
+     */
+    void wake(std::size_t i) {
+        uint32_t ball = static_cast<uint32_t>(i);
+        do {
+            const uint32_t next = islandNext[ball];
+            sleeping[ball] = 0;
+            sleepTimer[ball] = 0.0f;
+            islandNext[ball] = ball;
+            ball = next;
+        } while (ball != i);
+    }
+
+    /**
+     * @brief Advances every ball by one time step, spreading ranges of balls over the job system.
+     *
+     * @param deltaTime Time step for the physics update.
+     */
+    void updatePhysics(float deltaTime) {
+        parallelFor(0, size(), 16384, [this, deltaTime](std::size_t begin, std::size_t end) {
+            updatePhysics(begin, end, deltaTime);
+        });
+    }
+
+    /**
+     * @brief Advances the awake balls in [begin, end) by one time step.
+     *
+     * Sleeping balls are skipped; each run of consecutive awake balls is
+     * advanced with updateRange.
+     *
+     * @param begin First ball index.
+     * @param end One past the last ball index.
+     * @param deltaTime Time step for the physics update.
+     */
+    void updatePhysics(std::size_t begin, std::size_t end, float deltaTime) {
+        const uint8_t* asleep = sleeping.data();
+        std::size_t runBegin = begin;
+        while (runBegin < end) {
+            while (runBegin < end && asleep[runBegin]) runBegin++;
+            std::size_t runEnd = runBegin;
+            while (runEnd < end && !asleep[runEnd]) runEnd++;
+            if (runBegin < runEnd) updateRange(runBegin, runEnd, deltaTime);
+            runBegin = runEnd;
+        }
+    }
+
+    /**
+     * @brief Advances the balls in [begin, end) by one time step, regardless of their sleep state.
+     *
+     * Whole vectors of balls go through the SIMD kernel selected by simdLevel;
+     * the remaining balls, or all of them at SimdLevel::Scalar, use the scalar kernels.
+     *
+     * @param begin First ball index.
+     * @param end One past the last ball index.
+     * @param deltaTime Time step for the physics update.
+     */
+    void updateRange(std::size_t begin, std::size_t end, float deltaTime) {
+        std::size_t done = begin;
+#if defined(GRAVISIM_X86)
+        if (simdLevel == SimdLevel::AVX2) {
+            done = updatePhysicsAVX2(x.data(), y.data(), vx.data(), vy.data(), radius.data(),
+                begin, end, deltaTime, material.damping, material.velocityThreshold);
+        }
+        else if (simdLevel == SimdLevel::SSE2) {
+            done = updatePhysicsSSE2(x.data(), y.data(), vx.data(), vy.data(), radius.data(),
+                begin, end, deltaTime, material.damping, material.velocityThreshold);
+        }
+#endif
+        integrate(done, end, deltaTime);
+        handleCollisions(done, end);
+    }
+
+    /**
+     * @brief Integrates positions of the balls in [begin, end).
+     *
+     * @param begin First ball index.
+     * @param end One past the last ball index.
+     * @param deltaTime Time step for the physics update.
+     */
+    void integrate(std::size_t begin, std::size_t end, float deltaTime) {
+        float* px = x.data();
+        float* py = y.data();
+        const float* pvx = vx.data();
+        const float* pvy = vy.data();
+
+        for (std::size_t i = begin; i < end; i++) {
+            // Apply gravity if above ground
+
+            /* if (py[i] - radius[i] > -1.0f)
+                vy[i] += material.gravity * deltaTime;*/
+
+            // Update position
+            px[i] += pvx[i] * deltaTime;
+            py[i] += pvy[i] * deltaTime;
+        }
+    }
+
+    /**
+     * @brief Handles collisions of the balls in [begin, end) with the boundaries and applies response forces.
+     *
+     * @param begin First ball index.
+     * @param end One past the last ball index.
+     */
+    void handleCollisions(std::size_t begin, std::size_t end) {
+        const float damping = material.damping;
+        const float velocityThreshold = material.velocityThreshold;
+        float* px = x.data();
+        float* py = y.data();
+        float* pvx = vx.data();
+        float* pvy = vy.data();
+        const float* pr = radius.data();
+
+        for (std::size_t i = begin; i < end; i++) {
+            const float r = pr[i];
+
+            // Collision with left or right wall
+            if (px[i] + r >= 1.0f || px[i] - r <= -1.0f) {
+                pvx[i] *= -damping;
+                px[i] = glm::clamp(px[i], -1.0f + r, 1.0f - r);
+                if (fabs(pvx[i]) < velocityThreshold) pvx[i] = 0.0f;
+            }
+
+            // Collision with the ground
+            if (py[i] - r <= -1.0f) {
+                pvy[i] *= -damping;
+                py[i] = -1.0f + r;
+                pvx[i] *= damping;  // Apply ground friction
+                if (fabs(pvy[i]) < velocityThreshold) pvy[i] = 0.0f;
+                if (fabs(pvx[i]) < velocityThreshold) pvx[i] = 0.0f;
+            }
+            // Collision with the ceiling
+            else if (py[i] + r >= 1.0f) {
+                pvy[i] *= -damping;
+                py[i] = 1.0f - r;
+                if (fabs(pvy[i]) < velocityThreshold) pvy[i] = 0.0f;
+            }
+        }
+    }
+
+    /**
+     * @brief Finds the first ball containing a point.
+     *
+     * @param px X coordinate of the point.
+     * @param py Y coordinate of the point.
+     * @return Index of the ball, or npos if none contains the point.
+     */
+    std::size_t findBallAt(float px, float py) const {
+        for (std::size_t i = 0; i < size(); i++) {
+            float dx = px - x[i];
+            float dy = py - y[i];
+            if ((dx * dx + dy * dy) < (radius[i] * radius[i])) {
+                return i;
+            }
+        }
+        return npos;
+    }
+};
+
+#endif
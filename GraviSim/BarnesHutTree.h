@@ -0,0 +1,450 @@
+#ifndef BARNES_HUT_TREE_H
+#define BARNES_HUT_TREE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "BallSystem.h"
+#include "FrameArena.h"
+#include "Parallel.h"
+
+/**
+ * @class BarnesHutTree
+ * @brief Quadtree that approximates mutual gravity in O(N log N).
+ *
+ * Every build sorts the balls by the Morton code of their position, so each
+ * quadtree cell is a contiguous range of the sorted arrays. The top two levels
+ * are split into up to 16 independent subtrees that are built in parallel and
+ * stitched into a single node array. A ball's mass is its radius squared,
+ * matching the collision response.
+ *
+ * Subtrees are built in per-thread frame arenas, and every other buffer is
+ * kept between builds, so rebuilding a tree of a similar size every step
+ * makes no heap allocation.
+ */
+class BarnesHutTree {
+public:
+    /**
+     * @struct Node
+     * @brief Quadtree cell with the aggregated mass of every ball inside it.
+     */
+    struct Node {
+        float comX;          /* Center of mass x */
+        float comY;          /* Center of mass y */
+        float mass;          /* Total mass of the cell */
+        float size;          /* Width of the cell */
+        int32_t firstChild;  /* Index of the first child, -1 for a leaf */
+        uint32_t childCount; /* Number of non-empty children, stored contiguously */
+        uint32_t bodyBegin;  /* First ball of the cell in sorted order */
+        uint32_t bodyEnd;    /* One past the last ball of the cell in sorted order */
+    };
+
+    static constexpr uint32_t leafCapacity = 8;        /* Maximum balls per leaf above the deepest level */
+    static constexpr int maxLevel = 16;                /* Morton codes hold 16 levels of 2 bits */
+    static constexpr uint32_t parallelThreshold = 4096; /* Below this many balls the tree is built serially */
+
+    /**
+     * @brief Rebuilds the tree from the current ball positions.
+     *
+     * @param balls System to build the tree for.
+     */
+    void build(const BallSystem& balls) {
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        nodes.clear();
+        if (count == 0) return;
+        arenas.reset();
+
+        computeBounds(balls);
+        sortBodies(balls);
+
+        if (count <= parallelThreshold) {
+            nodes.resize(1);
+            buildNode(nodes, 0, 0, count, 0);
+        }
+        else {
+            buildParallel();
+        }
+    }
+
+    /**
+     * @brief Computes the gravitational acceleration of every ball.
+     *
+     * @param theta Opening angle; cells with size / distance below it are approximated by their center of mass.
+     * @param gravitationalConstant Gravitational constant G.
+     * @param softening Softening length that keeps close encounters finite.
+     * @param ax Output acceleration x, indexed like the ball system.
+     * @param ay Output acceleration y, indexed like the ball system.
+     */
+    void computeAccelerations(float theta, float gravitationalConstant, float softening, float* ax, float* ay) const {
+        if (nodes.empty()) return;
+
+        // Walk balls in Morton order so neighbouring threads traverse similar cells
+        parallelFor(0, order.size(), 1024, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t s = begin; s < end; s++) {
+                glm::vec2 acceleration = accelerationOf(static_cast<uint32_t>(s), theta, gravitationalConstant, softening);
+                ax[order[s]] = acceleration.x;
+                ay[order[s]] = acceleration.y;
+            }
+        });
+    }
+
+    /**
+     * @brief Computes the acceleration of a single ball.
+     *
+     * @param ball Index of the ball in the system.
+     * @param theta Opening angle.
+     * @param gravitationalConstant Gravitational constant G.
+     * @param softening Softening length.
+     * @return Acceleration of the ball.
+     */
+    glm::vec2 accelerationOfBall(uint32_t ball, float theta, float gravitationalConstant, float softening) const {
+        return accelerationOf(sortedSlot[ball], theta, gravitationalConstant, softening);
+    }
+
+    std::size_t getNodeCount() const { return nodes.size(); }
+    const std::vector<Node>& getNodes() const { return nodes; }
+
+private:
+    /**
+     * @brief Finds the square that bounds every ball.
+     */
+    void computeBounds(const BallSystem& balls) {
+        float minX = balls.x[0], maxX = balls.x[0];
+        float minY = balls.y[0], maxY = balls.y[0];
+        for (std::size_t i = 1; i < balls.size(); i++) {
+            minX = std::min(minX, balls.x[i]);
+            maxX = std::max(maxX, balls.x[i]);
+            minY = std::min(minY, balls.y[i]);
+            maxY = std::max(maxY, balls.y[i]);
+        }
+        originX = minX;
+        originY = minY;
+        // Pad slightly so the maximum coordinate still maps inside the last cell
+        rootSize = std::max(std::max(maxX - minX, maxY - minY), 1e-6f) * 1.0001f;
+    }
+
+    /**
+     * @brief Spreads the low 16 bits of v so there is a zero bit between each of them.
+     */
+    static uint32_t expandBits(uint32_t v) {
+        v &= 0x0000ffff;
+        v = (v | (v << 8)) & 0x00ff00ff;
+        v = (v | (v << 4)) & 0x0f0f0f0f;
+        v = (v | (v << 2)) & 0x33333333;
+        v = (v | (v << 1)) & 0x55555555;
+        return v;
+    }
+
+    /**
+     * @brief Computes Morton codes, sorts balls by them and gathers positions and masses in sorted order.
+     */
+    void sortBodies(const BallSystem& balls) {
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        const float scale = 65536.0f / rootSize;
+
+        keys.resize(count);
+        parallelFor(0, count, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                uint32_t qx = std::min<uint32_t>(65535, static_cast<uint32_t>((balls.x[i] - originX) * scale));
+                uint32_t qy = std::min<uint32_t>(65535, static_cast<uint32_t>((balls.y[i] - originY) * scale));
+                uint64_t code = expandBits(qx) | (expandBits(qy) << 1);
+                keys[i] = (code << 32) | static_cast<uint64_t>(i);
+            }
+        });
+
+        parallelSort(keys);
+
+        codes.resize(count);
+        order.resize(count);
+        sortedSlot.resize(count);
+        bodyX.resize(count);
+        bodyY.resize(count);
+        bodyMass.resize(count);
+        parallelFor(0, count, 4096, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t s = begin; s < end; s++) {
+                const uint32_t ball = static_cast<uint32_t>(keys[s] & 0xffffffffu);
+                codes[s] = static_cast<uint32_t>(keys[s] >> 32);
+                order[s] = ball;
+                sortedSlot[ball] = static_cast<uint32_t>(s);
+                bodyX[s] = balls.x[ball];
+                bodyY[s] = balls.y[ball];
+                bodyMass[s] = balls.radius[ball] * balls.radius[ball];
+            }
+        });
+    }
+
+    /**
+     * @brief Sorts chunks on separate threads and merges them pairwise.
+     */
+    void parallelSort(std::vector<uint64_t>& values) {
+        const std::size_t chunks = std::min<std::size_t>(getWorkerCount(), std::max<std::size_t>(1, values.size() / 16384));
+        if (chunks <= 1) {
+            std::sort(values.begin(), values.end());
+            return;
+        }
+
+        ArenaVector<std::size_t> bounds(chunks + 1, 0, ArenaAllocator<std::size_t>(arenas.get()));
+        for (std::size_t c = 0; c <= chunks; c++) {
+            bounds[c] = values.size() * c / chunks;
+        }
+        parallelFor(0, chunks, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t c = begin; c < end; c++) {
+                std::sort(values.begin() + bounds[c], values.begin() + bounds[c + 1]);
+            }
+        });
+
+        // Merge neighbouring runs through the scratch buffer until a single sorted run remains
+        mergeScratch.resize(values.size());
+        for (std::size_t width = 1; width < chunks; width *= 2) {
+            const std::size_t merges = (chunks + 2 * width - 1) / (2 * width);
+            parallelFor(0, merges, 1, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t m = begin; m < end; m++) {
+                    const std::size_t left = m * 2 * width;
+                    const std::size_t middle = std::min(chunks, left + width);
+                    const std::size_t right = std::min(chunks, left + 2 * width);
+                    if (middle >= right) continue;
+                    std::merge(values.begin() + bounds[left], values.begin() + bounds[middle], values.begin() + bounds[middle],
+                        values.begin() + bounds[right], mergeScratch.begin() + bounds[left]);
+                    std::copy(mergeScratch.begin() + bounds[left], mergeScratch.begin() + bounds[right], values.begin() + bounds[left]);
+                }
+            });
+        }
+    }
+
+    /**
+     * @brief Finds the end of the child quadrant q of the sorted range [begin, end) at a given level.
+     */
+    uint32_t quadrantEnd(uint32_t begin, uint32_t end, int level, uint32_t q) const {
+        const int shift = 30 - 2 * level;
+        return static_cast<uint32_t>(std::partition_point(codes.begin() + begin, codes.begin() + end,
+            [shift, q](uint32_t code) { return ((code >> shift) & 3u) <= q; }) - codes.begin());
+    }
+
+    /**
+     * @brief Builds the subtree for the sorted range [begin, end) into out[slot], appending descendants to out.
+     */
+    template <typename NodeVector>
+    void buildNode(NodeVector& out, uint32_t slot, uint32_t begin, uint32_t end, int level) const {
+        Node node{};
+        node.size = rootSize / static_cast<float>(1u << level);
+        node.bodyBegin = begin;
+        node.bodyEnd = end;
+        node.firstChild = -1;
+
+        if (end - begin <= leafCapacity || level >= maxLevel) {
+            float mass = 0.0f, mx = 0.0f, my = 0.0f;
+            for (uint32_t s = begin; s < end; s++) {
+                mass += bodyMass[s];
+                mx += bodyMass[s] * bodyX[s];
+                my += bodyMass[s] * bodyY[s];
+            }
+            node.mass = mass;
+            node.comX = mass > 0.0f ? mx / mass : bodyX[begin];
+            node.comY = mass > 0.0f ? my / mass : bodyY[begin];
+            out[slot] = node;
+            return;
+        }
+
+        // Split the range into its non-empty quadrants
+        uint32_t childBegin[4], childEnd[4];
+        uint32_t childCount = 0;
+        uint32_t cursor = begin;
+        for (uint32_t q = 0; q < 4; q++) {
+            uint32_t qEnd = quadrantEnd(cursor, end, level, q);
+            if (qEnd > cursor) {
+                childBegin[childCount] = cursor;
+                childEnd[childCount] = qEnd;
+                childCount++;
+            }
+            cursor = qEnd;
+        }
+
+        const uint32_t firstChild = static_cast<uint32_t>(out.size());
+        out.resize(out.size() + childCount);
+        for (uint32_t c = 0; c < childCount; c++) {
+            buildNode(out, firstChild + c, childBegin[c], childEnd[c], level + 1);
+        }
+
+        node.firstChild = static_cast<int32_t>(firstChild);
+        node.childCount = childCount;
+        aggregateChildren(node, out);
+        out[slot] = node;
+    }
+
+    /**
+     * @brief Sets a node's mass and center of mass from its children.
+     */
+    template <typename NodeVector>
+    static void aggregateChildren(Node& node, const NodeVector& from) {
+        float mass = 0.0f, mx = 0.0f, my = 0.0f;
+        for (uint32_t c = 0; c < node.childCount; c++) {
+            const Node& child = from[node.firstChild + c];
+            mass += child.mass;
+            mx += child.mass * child.comX;
+            my += child.mass * child.comY;
+        }
+        node.mass = mass;
+        node.comX = mass > 0.0f ? mx / mass : from[node.firstChild].comX;
+        node.comY = mass > 0.0f ? my / mass : from[node.firstChild].comY;
+    }
+
+    /**
+     * @brief Builds the 16 level-two subtrees in parallel and stitches them below a serial top.
+     *
+     * Layout: [root][level-1 nodes][level-2 roots of each level-1 node][rest of subtree 0][rest of subtree 1]...
+     * so every node's children stay contiguous.
+     */
+    void buildParallel() {
+        const uint32_t count = static_cast<uint32_t>(codes.size());
+
+        // Range of each level-2 bucket (top 4 bits of the code)
+        uint32_t bucketBegin[17];
+        bucketBegin[0] = 0;
+        for (uint32_t b = 0; b < 16; b++) {
+            bucketBegin[b + 1] = static_cast<uint32_t>(std::partition_point(codes.begin() + bucketBegin[b], codes.end(),
+                [b](uint32_t code) { return (code >> 28) <= b; }) - codes.begin());
+        }
+        bucketBegin[16] = count;
+
+        // Each subtree grows in the arena of the thread that builds it
+        ArenaVector<Node> subtrees[16];
+        parallelFor(0, 16, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++) {
+                if (bucketBegin[b] == bucketBegin[b + 1]) continue;
+                subtrees[b] = ArenaVector<Node>(ArenaAllocator<Node>(arenas.get()));
+                subtrees[b].resize(1);
+                buildNode(subtrees[b], 0, bucketBegin[b], bucketBegin[b + 1], 2);
+            }
+        });
+
+        // Top two levels
+        nodes.assign(1, Node{});
+        Node root{};
+        root.size = rootSize;
+        root.bodyBegin = 0;
+        root.bodyEnd = count;
+        root.firstChild = 1;
+
+        uint32_t levelOne[4];
+        for (uint32_t q = 0; q < 4; q++) {
+            if (bucketBegin[4 * q] != bucketBegin[4 * q + 4]) {
+                levelOne[root.childCount++] = q;
+            }
+        }
+        nodes.resize(1 + root.childCount);
+
+        uint32_t subtreeSlot[16] = {};
+        for (uint32_t c = 0; c < root.childCount; c++) {
+            const uint32_t q = levelOne[c];
+            Node node{};
+            node.size = rootSize / 2.0f;
+            node.bodyBegin = bucketBegin[4 * q];
+            node.bodyEnd = bucketBegin[4 * q + 4];
+            node.firstChild = static_cast<int32_t>(nodes.size());
+            for (uint32_t b = 4 * q; b < 4 * q + 4; b++) {
+                if (subtrees[b].empty()) continue;
+                subtreeSlot[b] = static_cast<uint32_t>(nodes.size());
+                nodes.push_back(subtrees[b][0]);
+                node.childCount++;
+            }
+            nodes[1 + c] = node;
+        }
+
+        // Append the remainder of every subtree and remap its child indices
+        uint32_t restOffset[16] = {};
+        std::size_t total = nodes.size();
+        for (uint32_t b = 0; b < 16; b++) {
+            restOffset[b] = static_cast<uint32_t>(total);
+            if (!subtrees[b].empty()) total += subtrees[b].size() - 1;
+        }
+        reserveWithHeadroom(nodes, total);
+        nodes.resize(total);
+
+        parallelFor(0, 16, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t b = begin; b < end; b++) {
+                const ArenaVector<Node>& subtree = subtrees[b];
+                if (subtree.empty()) continue;
+                const int32_t shift = static_cast<int32_t>(restOffset[b]) - 1;
+                for (std::size_t local = 0; local < subtree.size(); local++) {
+                    Node node = subtree[local];
+                    if (node.firstChild >= 0) node.firstChild += shift;
+                    const std::size_t target = local == 0 ? subtreeSlot[b] : restOffset[b] + local - 1;
+                    nodes[target] = node;
+                }
+            }
+        });
+
+        for (uint32_t c = 0; c < root.childCount; c++) {
+            aggregateChildren(nodes[1 + c], nodes);
+        }
+        aggregateChildren(root, nodes);
+        nodes[0] = root;
+    }
+
+    /**
+     * @brief Traverses the tree for the ball at sorted slot s.
+     */
+    glm::vec2 accelerationOf(uint32_t s, float theta, float gravitationalConstant, float softening) const {
+        const float px = bodyX[s];
+        const float py = bodyY[s];
+        const float theta2 = theta * theta;
+        const float softening2 = softening * softening;
+        float ax = 0.0f, ay = 0.0f;
+
+        uint32_t stack[64];
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            const float dx = node.comX - px;
+            const float dy = node.comY - py;
+            const float dist2 = dx * dx + dy * dy;
+
+            if (node.firstChild < 0) {
+                // Leaf: sum its balls exactly
+                for (uint32_t other = node.bodyBegin; other < node.bodyEnd; other++) {
+                    if (other == s) continue;
+                    const float ox = bodyX[other] - px;
+                    const float oy = bodyY[other] - py;
+                    const float r2 = ox * ox + oy * oy + softening2;
+                    const float invR = 1.0f / std::sqrt(r2);
+                    const float factor = bodyMass[other] * invR * invR * invR;
+                    ax += ox * factor;
+                    ay += oy * factor;
+                }
+            }
+            else if (node.size * node.size < theta2 * dist2) {
+                // Far enough away: use the cell's center of mass
+                const float r2 = dist2 + softening2;
+                const float invR = 1.0f / std::sqrt(r2);
+                const float factor = node.mass * invR * invR * invR;
+                ax += dx * factor;
+                ay += dy * factor;
+            }
+            else {
+                for (uint32_t c = 0; c < node.childCount; c++) {
+                    stack[top++] = static_cast<uint32_t>(node.firstChild) + c;
+                }
+            }
+        }
+
+        return glm::vec2(ax * gravitationalConstant, ay * gravitationalConstant);
+    }
+
+    float originX = 0.0f;               /* Lower-left corner of the root cell */
+    float originY = 0.0f;
+    float rootSize = 1.0f;              /* Width of the root cell */
+    std::vector<Node> nodes;            /* Quadtree nodes, root at index 0 */
+    std::vector<uint64_t> keys;         /* Morton code in the high half, ball index in the low half */
+    std::vector<uint32_t> codes;        /* Morton codes in sorted order */
+    std::vector<uint32_t> order;        /* Ball index of each sorted slot */
+    std::vector<uint32_t> sortedSlot;   /* Sorted slot of each ball */
+    std::vector<float> bodyX;           /* Positions and masses in sorted order */
+    std::vector<float> bodyY;
+    std::vector<float> bodyMass;
+    std::vector<uint64_t> mergeScratch; /* Merged runs of keys during the sort */
+    ThreadArenas arenas;                /* Subtrees and other memory of the current build */
+};
+
+#endif
@@ -0,0 +1,575 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <string>
+#include "BallSystem.h"
+#include "BallCollisionSolver.h"
+#include "GravitySolver.h"
+#include "Parallel.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "Simulation.h"
+#include "TrajectoryRecorder.h"
+#include "TrajectoryReplay.h"
+
+/**
+ * @brief Fills a system with randomly placed balls with radii in [minRadius, maxRadius).
+ *
+ * @param balls System to fill; existing balls are removed.
+ * @param ballCount Number of balls to create.
+ * @param minRadius Smallest radius.
+ * @param maxRadius Largest radius.
+ * @param seed Random seed, so runs are reproducible.
+ */
+inline void fillRandomScene(BallSystem& balls, std::size_t ballCount, float minRadius, float maxRadius, unsigned int seed) {
+    SceneSettings settings;
+    settings.ballCount = ballCount;
+    settings.minRadius = minRadius;
+    settings.maxRadius = maxRadius;
+    settings.seed = seed;
+    generateScene(balls, settings);
+}
+
+/**
+ * @brief Fills a system with randomly placed balls whose total area covers a fraction of the world box.
+ *
+ * @param balls System to fill; existing balls are removed.
+ * @param ballCount Number of balls to create.
+ * @param coverage Fraction of the [-1, 1] box covered by balls.
+ * @param seed Random seed, so runs are reproducible.
+ */
+inline void fillRandomScene(BallSystem& balls, std::size_t ballCount, float coverage, unsigned int seed) {
+    const float meanRadius = std::sqrt(coverage * 4.0f / (glm::pi<float>() * ballCount));
+    fillRandomScene(balls, ballCount, 0.5f * meanRadius, 1.5f * meanRadius, seed);
+}
+
+/**
+ * @brief Runs the same scene through every broadphase and prints pair tests, swaps and time per frame.
+ *
+ * @param ballCount Number of balls in the scene.
+ * @param frames Number of simulated frames per broadphase.
+ * @param seed Random seed of the scene.
+ */
+inline void runBroadphaseBenchmark(std::size_t ballCount, int frames, unsigned int seed = 1) {
+    const BroadphaseType types[] = { BroadphaseType::BruteForce, BroadphaseType::UniformGrid, BroadphaseType::SweepAndPrune };
+    const float deltaTime = 1.0f / 60.0f;
+
+    std::cout << "Broadphase benchmark: " << ballCount << " balls, " << frames << " frames\n";
+    for (BroadphaseType type : types) {
+        // The O(N^2) reference becomes unusable long before the grid does
+        if (type == BroadphaseType::BruteForce && ballCount > 20000) {
+            std::cout << "  brute-force: skipped above 20000 balls\n";
+            continue;
+        }
+
+        BallSystem balls;
+        fillRandomScene(balls, ballCount, 0.3f, seed);
+        BallCollisionSolver solver(type);
+
+        double pairTests = 0.0;
+        double pairsFound = 0.0;
+        double broadphaseMs = 0.0;
+        double endpointSwaps = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            balls.updatePhysics(deltaTime);
+            solver.solve(balls);
+            const BroadphaseStats& stats = solver.getBroadphase()->getStats();
+            pairTests += stats.pairTests;
+            pairsFound += stats.pairsFound;
+            broadphaseMs += stats.timeMs;
+            endpointSwaps += stats.endpointSwaps;
+        }
+        auto end = std::chrono::steady_clock::now();
+        double totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+
+        std::cout << "  " << solver.getBroadphase()->getName()
+            << ": pair tests/frame " << pairTests / frames
+            << ", contacts/frame " << pairsFound / frames
+            << ", broadphase ms/frame " << broadphaseMs / frames
+            << ", endpoint swaps/frame " << endpointSwaps / frames
+            << ", step ms/frame " << totalMs / frames << "\n";
+    }
+}
+
+/**
+ * @brief Compares Barnes-Hut force evaluation against the exact pairwise sum and prints error, speedup and thread scaling.
+ *
+ * The speedup over the exact sum is measured with one thread on both sides;
+ * the thread scaling of Barnes-Hut, from one thread to every hardware
+ * thread, is reported separately. Above 20000 balls the exact sum is only
+ * evaluated for an evenly strided sample of balls and its full cost is
+ * extrapolated from the sample.
+ *
+ * @param ballCount Number of balls in the scene; at least 1.
+ * @param theta Barnes-Hut opening angle.
+ * @param seed Random seed of the scene.
+ */
+inline void runGravityBenchmark(std::size_t ballCount, float theta, unsigned int seed = 1) {
+    ballCount = std::max<std::size_t>(ballCount, 1);
+    BallSystem balls;
+    fillRandomScene(balls, ballCount, 0.3f, seed);
+
+    GravitySolver solver;
+    solver.mode = GravityMode::BarnesHut;
+    solver.theta = theta;
+
+    // One untimed evaluation grows the solver's buffers, then each thread count keeps its best of five on the same scene
+    const unsigned int previousCount = getWorkerCount();
+    const unsigned int threads = JobSystem::getDefaultThreadCount();
+    auto timeTree = [&](unsigned int threadCount) {
+        setWorkerCount(threadCount);
+        solver.computeAccelerations(balls);
+        double bestMs = std::numeric_limits<double>::max();
+        for (int run = 0; run < 5; run++) {
+            auto start = std::chrono::steady_clock::now();
+            solver.computeAccelerations(balls);
+            auto end = std::chrono::steady_clock::now();
+            bestMs = std::min(bestMs, std::chrono::duration<double, std::milli>(end - start).count());
+        }
+        return bestMs;
+    };
+    const double singleThreadTreeMs = timeTree(1);
+    const double treeMs = timeTree(threads);
+    setWorkerCount(previousCount);
+
+    const std::size_t sampleCount = ballCount > 20000 ? 2000 : ballCount;
+    const std::size_t stride = ballCount / sampleCount;
+    double sumError = 0.0, sumError2 = 0.0, maxError = 0.0;
+
+    auto directStart = std::chrono::steady_clock::now();
+    for (std::size_t s = 0; s < sampleCount; s++) {
+        const std::size_t i = s * stride;
+        glm::vec2 exact = GravitySolver::directAcceleration(balls, i, solver.gravitationalConstant, solver.softening);
+        glm::vec2 approx(solver.getAccelerationX()[i], solver.getAccelerationY()[i]);
+        double error = glm::length(approx - exact) / std::max(glm::length(exact), 1e-12f);
+        sumError += error;
+        sumError2 += error * error;
+        maxError = std::max(maxError, error);
+    }
+    auto directEnd = std::chrono::steady_clock::now();
+    double directMs = std::chrono::duration<double, std::milli>(directEnd - directStart).count()
+        * static_cast<double>(ballCount) / sampleCount;
+
+    const double threadSpeedup = singleThreadTreeMs / treeMs;
+    std::cout << "Gravity benchmark: " << ballCount << " balls, theta " << theta << ", " << solver.getTree().getNodeCount() << " nodes\n"
+        << "  at 1 thread: barnes-hut " << singleThreadTreeMs << " ms, direct" << (sampleCount < ballCount ? " (extrapolated) " : " ")
+        << directMs << " ms, speedup " << directMs / singleThreadTreeMs << "x\n"
+        << "  barnes-hut at " << threads << (threads == 1 ? " thread: " : " threads: ") << treeMs << " ms, scaling "
+        << threadSpeedup << "x over 1 thread, efficiency " << 100.0 * threadSpeedup / threads << "%\n"
+        << "  relative error over " << sampleCount << " balls: mean " << sumError / sampleCount
+        << ", rms " << std::sqrt(sumError2 / sampleCount) << ", max " << maxError << "\n";
+}
+
+/**
+ * @brief Times the integration and wall kernels at every supported SIMD level and checks they match the scalar result bit for bit.
+ *
+ * @param ballCount Number of balls in the scene.
+ * @param steps Number of steps per level.
+ * @param seed Random seed of the scene.
+ */
+inline void runKernelBenchmark(std::size_t ballCount, int steps, unsigned int seed = 1) {
+    const float deltaTime = 1.0f / 60.0f;
+    BallSystem initial;
+    fillRandomScene(initial, ballCount, 0.3f, seed);
+    // Fast balls so the wall branches are exercised
+    for (std::size_t i = 0; i < ballCount; i++) {
+        initial.vx[i] *= 40.0f;
+        initial.vy[i] *= 40.0f;
+    }
+
+    std::cout << "Kernel benchmark: " << ballCount << " balls, " << steps << " steps, detected " << getSimdLevelName(getSimdLevel()) << "\n";
+
+    BallSystem reference;
+    const SimdLevel levels[] = { SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2 };
+    for (SimdLevel level : levels) {
+        if (level > getSimdLevel()) break;
+
+        BallSystem balls = initial;
+        balls.simdLevel = level;
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; step++) {
+            balls.updatePhysics(deltaTime);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ns = std::chrono::duration<double, std::nano>(end - start).count();
+
+        std::cout << "  " << getSimdLevelName(level) << ": " << ns / (static_cast<double>(steps) * ballCount) << " ns/ball-step";
+        if (level == SimdLevel::Scalar) {
+            reference = balls;
+        }
+        else {
+            const std::size_t bytes = ballCount * sizeof(float);
+            bool exact = std::memcmp(reference.x.data(), balls.x.data(), bytes) == 0
+                && std::memcmp(reference.y.data(), balls.y.data(), bytes) == 0
+                && std::memcmp(reference.vx.data(), balls.vx.data(), bytes) == 0
+                && std::memcmp(reference.vy.data(), balls.vy.data(), bytes) == 0;
+            std::cout << (exact ? ", bit-exact with scalar" : ", MISMATCH with scalar");
+        }
+        std::cout << "\n";
+    }
+}
+
+/**
+ * @brief Runs integration, the grid broadphase and contact resolution at 1 to 32 threads and prints the scaling.
+ *
+ * @param ballCount Number of balls in the scene.
+ * @param steps Number of timed steps per thread count.
+ * @param seed Random seed of the scene.
+ */
+inline void runThreadScalingBenchmark(std::size_t ballCount, int steps, unsigned int seed = 1) {
+    const unsigned int threadCounts[] = { 1, 2, 4, 8, 16, 32 };
+    const unsigned int previousCount = getWorkerCount();
+    const float deltaTime = 1.0f / 60.0f;
+    double singleThreadMs = 0.0;
+
+    std::cout << "Thread scaling benchmark: " << ballCount << " balls, " << steps << " steps, "
+        << JobSystem::getDefaultThreadCount() << " hardware threads\n";
+    for (unsigned int threads : threadCounts) {
+        setWorkerCount(threads);
+
+        BallSystem balls;
+        fillRandomScene(balls, ballCount, 0.3f, seed);
+        BallCollisionSolver solver(BroadphaseType::UniformGrid);
+
+        // One untimed step warms up caches and grows the solver's buffers
+        balls.updatePhysics(deltaTime);
+        solver.solve(balls);
+
+        auto start = std::chrono::steady_clock::now();
+        for (int step = 0; step < steps; step++) {
+            balls.updatePhysics(deltaTime);
+            solver.solve(balls);
+        }
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count() / steps;
+        if (threads == 1) singleThreadMs = ms;
+
+        double speedup = singleThreadMs / ms;
+        std::cout << "  " << threads << " threads: " << ms << " ms/step, speedup " << speedup
+            << "x, efficiency " << 100.0 * speedup / threads << "%, colors " << solver.getColorCount() << "\n";
+    }
+
+    setWorkerCount(previousCount);
+}
+
+/**
+ * @brief Saves, maps, verifies and restores a scene file and prints the throughput of each stage.
+ *
+ * The file is read back right after it was written, so the reads are served
+ * from the page cache; a cold restore is bounded by the disk instead.
+ *
+ * @param ballCount Number of balls in the scene.
+ * @param path Scene file to write; removed at the end.
+ * @param seed Random seed of the scene.
+ */
+inline void runSceneFileBenchmark(std::size_t ballCount, const std::string& path, unsigned int seed = 1) {
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+
+    BallSystem balls;
+    fillRandomScene(balls, ballCount, 0.3f, seed);
+
+    std::cout << "Scene file benchmark: " << ballCount << " balls, " << getWorkerCount() << " threads, " << path << "\n";
+    auto start = Clock::now();
+    if (!saveScene(balls, path)) return;
+    auto end = Clock::now();
+    const double saveMs = milliseconds(start, end);
+
+    MappedScene scene;
+    start = Clock::now();
+    if (!scene.open(path)) return;
+    end = Clock::now();
+    const double openMs = milliseconds(start, end);
+    const double gigabytes = scene.getFileSize() / 1e9;
+
+    start = Clock::now();
+    const bool valid = scene.verify();
+    end = Clock::now();
+    const double verifyMs = milliseconds(start, end);
+
+    BallSystem restored;
+    start = Clock::now();
+    scene.copyTo(restored);
+    end = Clock::now();
+    const double copyMs = milliseconds(start, end);
+    scene.close();
+
+    const std::size_t bytes = ballCount * sizeof(float);
+    const bool exact = restored.size() == ballCount
+        && std::memcmp(restored.x.data(), balls.x.data(), bytes) == 0
+        && std::memcmp(restored.vy.data(), balls.vy.data(), bytes) == 0
+        && std::memcmp(restored.colorB.data(), balls.colorB.data(), bytes) == 0
+        && std::memcmp(restored.islandNext.data(), balls.islandNext.data(), ballCount * sizeof(uint32_t)) == 0;
+
+    std::cout << "  file    " << gigabytes * 1e3 << " MB\n";
+    std::cout << "  save    " << saveMs << " ms, " << gigabytes / (saveMs / 1e3) << " GB/s\n";
+    std::cout << "  open    " << openMs << " ms (map and validate header)\n";
+    std::cout << "  verify  " << verifyMs << " ms, " << gigabytes / (verifyMs / 1e3) << " GB/s, " << (valid ? "checksums match" : "CHECKSUM MISMATCH") << "\n";
+    std::cout << "  restore " << copyMs << " ms, " << gigabytes / (copyMs / 1e3) << " GB/s, " << (exact ? "bit-exact" : "MISMATCH") << "\n";
+
+    // A file cut short must be rejected on open, before any data is read
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    std::cout << "  truncated file " << (scene.open(path) ? "NOT DETECTED" : "rejected") << "\n";
+    scene.close();
+    std::filesystem::remove(path);
+}
+
+/**
+ * @brief Records a run, then replays it from the start and from random steps and prints the cost of each.
+ *
+ * Seeking decodes one chunk whatever the step, where reading forward from the
+ * start would decode every chunk before it; both files are removed at the end.
+ *
+ * @param ballCount Number of balls in the scene.
+ * @param steps Number of recorded steps.
+ * @param path Trajectory file to write.
+ * @param seed Random seed of the scene and the seek positions.
+ */
+inline void runReplayBenchmark(std::size_t ballCount, int steps, const std::string& path, unsigned int seed = 1) {
+    using Clock = std::chrono::steady_clock;
+    auto milliseconds = [](Clock::time_point start, Clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - start).count();
+    };
+    const float deltaTime = 1.0f / 120.0f;
+
+    Simulation simulation;
+    fillRandomScene(simulation.balls, ballCount, 0.3f, seed);
+    std::cout << "Replay benchmark: " << ballCount << " balls, " << steps << " steps, " << getWorkerCount() << " threads, " << path << "\n";
+
+    // Blocking instead of dropping, so every step is in the recording
+    TrajectoryRecorder recorder;
+    RecorderSettings settings;
+    settings.overflow = RecorderOverflow::Block;
+    if (!recorder.open(path, simulation.balls, deltaTime, settings)) return;
+    simulation.onStep = [&recorder](const Simulation& sim) { recorder.record(sim.balls, sim.getStepCount()); };
+    auto start = Clock::now();
+    for (int step = 0; step < steps; step++) {
+        simulation.step(deltaTime);
+    }
+    recorder.close();
+    auto end = Clock::now();
+    simulation.onStep = nullptr;
+    const RecorderStats recorded = recorder.getStats();
+    std::cout << "  record  " << milliseconds(start, end) / steps << " ms/step, " << recorded.framesRecorded << " frames in "
+        << recorded.chunks << " chunks, ratio " << recorded.getCompressionRatio() << "\n";
+
+    TrajectoryReplay replay;
+    if (!replay.open(path)) return;
+    SimulationSnapshot snapshot;
+
+    // Playback at recorded speed, one frame per step
+    start = Clock::now();
+    for (int step = 0; step < steps; step++) {
+        replay.fillSnapshot(snapshot);
+        replay.advance(deltaTime);
+    }
+    end = Clock::now();
+    TrajectoryReplay::ReplayStats playback = replay.getStats();
+    std::cout << "  play    " << milliseconds(start, end) / steps << " ms/frame, " << playback.chunksDecoded << " chunks decoded, "
+        << playback.waits << " waits (" << playback.waitMs << " ms)\n";
+
+    // Seeks to random steps, each waiting for its chunk
+    const int seeks = 100;
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<double> distribution(static_cast<double>(replay.getFirstStep()), static_cast<double>(replay.getLastStep()));
+    double totalMs = 0.0;
+    double worstMs = 0.0;
+    for (int i = 0; i < seeks; i++) {
+        replay.seek(distribution(gen));
+        start = Clock::now();
+        replay.fillSnapshot(snapshot);
+        end = Clock::now();
+        totalMs += milliseconds(start, end);
+        worstMs = std::max(worstMs, milliseconds(start, end));
+    }
+    const TrajectoryReplay::ReplayStats seeking = replay.getStats();
+    const double decodeMs = seeking.decodeMs / std::max<uint64_t>(seeking.chunksDecoded, 1);
+    std::cout << "  seek    " << totalMs / seeks << " ms average, " << worstMs << " ms worst, "
+        << seeking.waits - playback.waits << " waits\n";
+    std::cout << "  decode  " << decodeMs << " ms/chunk; reading forward to the last step would decode "
+        << replay.getChunkCount() << " chunks (" << decodeMs * replay.getChunkCount() << " ms)\n";
+
+    replay.close();
+    std::filesystem::remove(path);
+    std::filesystem::remove(getTrajectoryIndexPath(path));
+}
+
+/**
+ * @brief Generates every scene distribution at 1 to 8 threads and prints the rate and whether the scenes match.
+ *
+ * @param ballCount Number of balls in each scene.
+ * @param seed Random seed of the scenes.
+ */
+inline void runSceneGeneratorBenchmark(std::size_t ballCount, unsigned int seed = 1) {
+    const SceneDistribution distributions[] = { SceneDistribution::Box, SceneDistribution::Disc, SceneDistribution::Plummer, SceneDistribution::Lattice };
+    const unsigned int threadCounts[] = { 1, 2, 4, 8 };
+    const unsigned int previousCount = getWorkerCount();
+
+    auto sameColumns = [](const BallSystem& a, const BallSystem& b) {
+        const std::size_t bytes = a.size() * sizeof(float);
+        return a.size() == b.size()
+            && std::memcmp(a.x.data(), b.x.data(), bytes) == 0 && std::memcmp(a.y.data(), b.y.data(), bytes) == 0
+            && std::memcmp(a.vx.data(), b.vx.data(), bytes) == 0 && std::memcmp(a.vy.data(), b.vy.data(), bytes) == 0
+            && std::memcmp(a.radius.data(), b.radius.data(), bytes) == 0 && std::memcmp(a.colorR.data(), b.colorR.data(), bytes) == 0
+            && std::memcmp(a.colorG.data(), b.colorG.data(), bytes) == 0 && std::memcmp(a.colorB.data(), b.colorB.data(), bytes) == 0;
+    };
+
+    std::cout << "Scene generator benchmark: " << ballCount << " balls, " << JobSystem::getDefaultThreadCount() << " hardware threads\n";
+    for (SceneDistribution distribution : distributions) {
+        SceneSettings settings;
+        settings.distribution = distribution;
+        settings.ballCount = ballCount;
+        settings.seed = seed;
+
+        BallSystem reference;
+        BallSystem balls;
+        std::cout << "  " << getSceneDistributionName(distribution) << "\n";
+        for (unsigned int threads : threadCounts) {
+            setWorkerCount(threads);
+
+            // One untimed run touches the columns' pages
+            BallSystem& target = threads == 1 ? reference : balls;
+            generateScene(target, settings);
+            auto start = std::chrono::steady_clock::now();
+            generateScene(target, settings);
+            auto end = std::chrono::steady_clock::now();
+            const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+            std::cout << "    " << threads << " threads: " << ms << " ms, " << ballCount / (ms * 1e3) << " M balls/s";
+            if (threads > 1) std::cout << ", " << (sameColumns(reference, balls) ? "identical" : "MISMATCH") << " to 1 thread";
+            std::cout << "\n";
+        }
+    }
+
+    setWorkerCount(previousCount);
+}
+
+/**
+ * @brief Runs head-on collisions of two fast balls for a few steps and checks the result.
+ *
+ * Both balls are fast, so each is swept by the continuous solver; the second
+ * must start its sweep from the impact the first one gave it instead of
+ * tunnelling through. The run passes if the balls end apart, mirrored about
+ * the center and moving away from each other with no net momentum.
+ *
+ * @return True if every case passed.
+ */
+inline bool runContinuousCollisionCheck() {
+    const float radius = 0.05f;
+    const float speed = 30.0f;
+    const float deltaTime = 1.0f / 120.0f;
+    const int steps = 3;  // Too few to reach a wall, so momentum must be conserved
+    const float starts[] = { 0.2f, 0.25f, 0.3f };
+
+    std::cout << "Continuous collision check: head-on, radius " << radius << ", speed " << speed << ", "
+        << steps << " steps of " << deltaTime << " s\n";
+    bool passed = true;
+    for (float start : starts) {
+        Simulation simulation;
+        simulation.sleepSolver.enabled = false;
+        simulation.balls.addBall(glm::vec2(-start, 0.0f), glm::vec2(speed, 0.0f), glm::vec3(1.0f), radius);
+        simulation.balls.addBall(glm::vec2(start, 0.0f), glm::vec2(-speed, 0.0f), glm::vec3(1.0f), radius);
+        for (int step = 0; step < steps; step++) {
+            simulation.step(deltaTime);
+        }
+
+        const BallSystem& balls = simulation.balls;
+        const float momentum = balls.vx[0] + balls.vx[1];
+        const bool apart = balls.x[1] - balls.x[0] >= 2.0f * radius - 1e-4f;
+        const bool mirrored = std::fabs(balls.x[0] + balls.x[1]) <= 1e-4f;
+        const bool separating = balls.vx[0] < 0.0f && balls.vx[1] > 0.0f;
+        const bool conserved = std::fabs(momentum) <= 1e-3f * speed;
+        const bool ok = apart && mirrored && separating && conserved;
+        passed = passed && ok;
+
+        std::cout << "  start +-" << start << ": x " << balls.x[0] << ", " << balls.x[1]
+            << "; vx " << balls.vx[0] << ", " << balls.vx[1] << "; momentum " << momentum
+            << (ok ? ", ok" : ", FAILED") << "\n";
+    }
+    return passed;
+}
+
+/**
+ * @brief Runs the benchmark named by argv[1], if any.
+ *
+ * Recognized commands are --bench-broadphase [balls] [frames], --bench-gravity [balls] [theta],
+ * --bench-kernels [balls] [steps], --bench-threads [balls] [steps], --bench-scene [balls] [path],
+ * --bench-replay [balls] [steps] [path], --bench-generate [balls] and the
+ * self-check --check-ccd.
+ *
+ * @param argc Argument count of main.
+ * @param argv Arguments of main.
+ * @param status Receives the exit status of the command, non-zero if a check failed.
+ * @return True if a benchmark was run.
+ */
+inline bool runBenchmarkCommand(int argc, char** argv, int& status) {
+    status = 0;
+    if (argc < 2) return false;
+    const std::string command = argv[1];
+
+    if (command == "--check-ccd") {
+        status = runContinuousCollisionCheck() ? 0 : 1;
+        return true;
+    }
+
+    if (command == "--bench-broadphase") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 20000;
+        int frames = argc > 3 ? std::stoi(argv[3]) : 100;
+        runBroadphaseBenchmark(ballCount, frames);
+        return true;
+    }
+    if (command == "--bench-gravity") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 100000;
+        float theta = argc > 3 ? std::stof(argv[3]) : 0.5f;
+        if (ballCount == 0) {
+            std::cerr << "ERROR::BENCHMARK::GRAVITY_NEEDS_AT_LEAST_ONE_BALL" << std::endl;
+            status = 1;
+            return true;
+        }
+        runGravityBenchmark(ballCount, theta);
+        return true;
+    }
+    if (command == "--bench-kernels") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 1000000;
+        int steps = argc > 3 ? std::stoi(argv[3]) : 100;
+        runKernelBenchmark(ballCount, steps);
+        return true;
+    }
+    if (command == "--bench-threads") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 200000;
+        int steps = argc > 3 ? std::stoi(argv[3]) : 50;
+        runThreadScalingBenchmark(ballCount, steps);
+        return true;
+    }
+    if (command == "--bench-scene") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 10000000;
+        std::string path = argc > 3 ? argv[3] : "benchmark.scene";
+        runSceneFileBenchmark(ballCount, path);
+        return true;
+    }
+    if (command == "--bench-replay") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 100000;
+        int steps = argc > 3 ? std::stoi(argv[3]) : 1200;
+        std::string path = argc > 4 ? argv[4] : "benchmark.traj";
+        runReplayBenchmark(ballCount, steps, path);
+        return true;
+    }
+    if (command == "--bench-generate") {
+        std::size_t ballCount = argc > 2 ? std::stoul(argv[2]) : 4000000;
+        runSceneGeneratorBenchmark(ballCount);
+        return true;
+    }
+    return false;
+}
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef BROADPHASE_H
+#define BROADPHASE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "BallSystem.h"
+
+/**
+ * @struct BallPair
+ * @brief Indices of two overlapping balls, with a < b.
+ */
+struct BallPair {
+    uint32_t a; /* Index of the first ball */
+    uint32_t b; /* Index of the second ball */
+};
+
+/**
+ * @struct BroadphaseStats
+ * @brief Counters describing the work done by the last findPairs call.
+ */
+struct BroadphaseStats {
+    std::size_t pairTests = 0;     /* Number of narrow circle-circle tests performed */
+    std::size_t pairsFound = 0;    /* Number of overlapping pairs reported */
+    std::size_t endpointSwaps = 0; /* Number of sort swaps (sweep-and-prune only) */
+    double timeMs = 0.0;           /* Wall time spent in findPairs, in milliseconds */
+};
+
+/**
+ * @class Broadphase
+ * @brief Interface for algorithms that find every pair of overlapping balls.
+ */
+class Broadphase {
+public:
+    virtual ~Broadphase() = default;
+
+    /**
+     * @brief Collects every pair of overlapping balls.
+     *
+     * @param balls System to search.
+     * @param pairs Output list, cleared before being filled.
+     */
+    virtual void findPairs(const BallSystem& balls, std::vector<BallPair>& pairs) = 0;
+
+    /**
+     * @brief Gets a human readable name of the algorithm.
+     */
+    virtual const char* getName() const = 0;
+
+    const BroadphaseStats& getStats() const { return stats; }
+    BroadphaseStats& getStats() { return stats; }
+
+protected:
+    /**
+     * @brief Tests two balls for overlap and records the pair if they touch.
+     *
+     * Two sleeping balls are never paired, since neither of them can move.
+     *
+     * @param balls System that owns the balls.
+     * @param i Index of the first ball.
+     * @param j Index of the second ball.
+     * @param pairs Output list, a vector of BallPair with any allocator.
+     * @param pairTests Counter of performed tests.
+     */
+    template <typename PairList>
+    static void testPair(const BallSystem& balls, uint32_t i, uint32_t j, PairList& pairs, std::size_t& pairTests) {
+        if (balls.sleeping[i] & balls.sleeping[j]) return;
+        pairTests++;
+        float dx = balls.x[j] - balls.x[i];
+        float dy = balls.y[j] - balls.y[i];
+        float rsum = balls.radius[i] + balls.radius[j];
+        if (dx * dx + dy * dy < rsum * rsum) {
+            pairs.push_back(i < j ? BallPair{ i, j } : BallPair{ j, i });
+        }
+    }
+
+    BroadphaseStats stats; /* Counters of the last findPairs call */
+};
+
+/**
+ * @class BruteForceBroadphase
+ * @brief Reference O(N^2) broadphase that tests every pair of balls.
+ */
+class BruteForceBroadphase : public Broadphase {
+public:
+    void findPairs(const BallSystem& balls, std::vector<BallPair>& pairs) override {
+        pairs.clear();
+        stats.pairTests = 0;
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint32_t j = i + 1; j < count; j++) {
+                testPair(balls, i, j, pairs, stats.pairTests);
+            }
+        }
+        stats.pairsFound = pairs.size();
+    }
+
+    const char* getName() const override { return "brute-force"; }
+};
+
+#endif
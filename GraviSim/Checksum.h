@@ -0,0 +1,89 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Updates a CRC-32 (IEEE 802.3, as used by PNG and zlib) with more bytes.
+ *
+ * Start with crc = 0; the result of one call is the crc of the next.
+ *
+ * @param crc CRC-32 of the bytes so far.
+ * @param data Bytes to add.
+ * @param size Number of bytes.
+ * @return CRC-32 of all bytes.
+ */
+inline uint32_t updateCrc32(uint32_t crc, const void* data, std::size_t size) {
+    // Slicing-by-8 tables for the reflected polynomial, built on first use: entries[k][i]
+    // is the CRC of byte i followed by k zero bytes, so eight bytes fold in one round
+    static const struct Table {
+        uint32_t entries[8][256];
+        Table() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[0][i] = c;
+            }
+            for (uint32_t i = 0; i < 256; i++) {
+                for (int k = 1; k < 8; k++) {
+                    entries[k][i] = entries[0][entries[k - 1][i] & 0xff] ^ (entries[k - 1][i] >> 8);
+                }
+            }
+        }
+    } table;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+    // Eight bytes at a time, assembled in little-endian order as the reflected CRC expects
+    while (size >= 8) {
+        const uint32_t low = crc ^ (bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32_t>(bytes[3]) << 24));
+        const uint32_t high = bytes[4] | (bytes[5] << 8) | (bytes[6] << 16) | (static_cast<uint32_t>(bytes[7]) << 24);
+        crc = table.entries[7][low & 0xff] ^ table.entries[6][(low >> 8) & 0xff]
+            ^ table.entries[5][(low >> 16) & 0xff] ^ table.entries[4][low >> 24]
+            ^ table.entries[3][high & 0xff] ^ table.entries[2][(high >> 8) & 0xff]
+            ^ table.entries[1][(high >> 16) & 0xff] ^ table.entries[0][high >> 24];
+        bytes += 8;
+        size -= 8;
+    }
+    for (std::size_t i = 0; i < size; i++) {
+        crc = table.entries[0][(crc ^ bytes[i]) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Updates an Adler-32 (as used by zlib) with more bytes.
+ *
+ * Start with adler = 1; the result of one call is the adler of the next.
+ *
+ * @param adler Adler-32 of the bytes so far.
+ * @param data Bytes to add.
+ * @param size Number of bytes.
+ * @return Adler-32 of all bytes.
+ */
+inline uint32_t updateAdler32(uint32_t adler, const void* data, std::size_t size) {
+    const uint32_t modulus = 65521;
+    // Largest run of bytes whose sums cannot overflow 32 bits before the modulo
+    const std::size_t blockSize = 5552;
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t a = adler & 0xffff;
+    uint32_t b = adler >> 16;
+    while (size > 0) {
+        const std::size_t block = size < blockSize ? size : blockSize;
+        for (std::size_t i = 0; i < block; i++) {
+            a += bytes[i];
+            b += a;
+        }
+        a %= modulus;
+        b %= modulus;
+        bytes += block;
+        size -= block;
+    }
+    return (b << 16) | a;
+}
+
+#endif
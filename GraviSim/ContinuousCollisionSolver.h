@@ -0,0 +1,411 @@
+#ifndef CONTINUOUS_COLLISION_SOLVER_H
+#define CONTINUOUS_COLLISION_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "AlignedArray.h"
+#include "BallSystem.h"
+#include "FrameArena.h"
+
+/**
+ * @class ContinuousCollisionSolver
+ * @brief Swept-circle time-of-impact collision for balls that move too far in one step.
+ *
+ * A ball is "fast" when its displacement in a step exceeds motionFraction of
+ * its radius. Fast balls are found before the discrete update and their start
+ * state is saved; after the update their discrete result is thrown away and
+ * they are re-integrated event by event: the earliest impact with a wall or a
+ * ball along the remaining path is found, the ball is moved to it, the contact
+ * response is applied and the rest of the step continues with the new velocity.
+ *
+ * Other balls are assumed to move linearly from their start to their end
+ * position over the step. A fast ball that is struck before its own sweep
+ * starts that sweep from the impact, with the velocity the impact gave it. Candidates come from a uniform grid over every ball's
+ * swept bounding box, so a fast ball is also found by the balls it crosses.
+ * Steps without fast balls only pay for the velocity scan.
+ */
+class ContinuousCollisionSolver {
+public:
+    bool enabled = true;         /* Use time of impact for fast balls */
+    float motionFraction = 1.0f; /* Displacement, relative to the radius, above which a ball is fast */
+    int maxImpacts = 4;          /* Most impacts handled per fast ball and step */
+
+    /**
+     * @brief Finds the fast balls and saves the state they start the step with.
+     *
+     * Must be called before BallSystem::updatePhysics.
+     *
+     * @param balls System about to be stepped.
+     * @param deltaTime Length of the step.
+     */
+    void begin(const BallSystem& balls, float deltaTime) {
+        fastBalls.clear();
+        if (!enabled) return;
+
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        const float scale = deltaTime * deltaTime / (motionFraction * motionFraction);
+        for (uint32_t i = 0; i < count; i++) {
+            const float speed2 = balls.vx[i] * balls.vx[i] + balls.vy[i] * balls.vy[i];
+            if (speed2 * scale > balls.radius[i] * balls.radius[i]) fastBalls.push_back(i);
+        }
+        if (fastBalls.empty()) return;
+
+        startX.resize(count);
+        startY.resize(count);
+        std::copy(balls.x.begin(), balls.x.end(), startX.begin());
+        std::copy(balls.y.begin(), balls.y.end(), startY.begin());
+        fastSlot.assign(count, noBall);
+        reserveWithHeadroom(fastPosition, fastBalls.size());
+        reserveWithHeadroom(fastVelocity, fastBalls.size());
+        reserveWithHeadroom(fastTime, fastBalls.size());
+        fastPosition.resize(fastBalls.size());
+        fastVelocity.resize(fastBalls.size());
+        fastTime.assign(fastBalls.size(), 0.0f);
+        for (std::size_t k = 0; k < fastBalls.size(); k++) {
+            const uint32_t i = fastBalls[k];
+            fastSlot[i] = static_cast<uint32_t>(k);
+            fastPosition[k] = glm::vec2(balls.x[i], balls.y[i]);
+            fastVelocity[k] = glm::vec2(balls.vx[i], balls.vy[i]);
+        }
+    }
+
+    /**
+     * @brief Replaces the discrete result of every fast ball with a swept one.
+     *
+     * Must be called after BallSystem::updatePhysics and before the discrete ball-ball solver.
+     *
+     * @param balls System that was stepped.
+     * @param deltaTime Length of the step.
+     * @param ballCollisions Whether fast balls collide with other balls, or only with the walls.
+     */
+    void solve(BallSystem& balls, float deltaTime, bool ballCollisions) {
+        impactCount = 0;
+        if (fastBalls.empty()) return;
+
+        // Fast balls start from their saved state and so do not move in the grid
+        for (std::size_t k = 0; k < fastBalls.size(); k++) {
+            const uint32_t i = fastBalls[k];
+            balls.x[i] = startX[i] + fastVelocity[k].x * deltaTime;
+            balls.y[i] = startY[i] + fastVelocity[k].y * deltaTime;
+        }
+        if (ballCollisions) buildGrid(balls);
+
+        for (sweeping = 0; sweeping < fastBalls.size(); sweeping++) {
+            sweepBall(balls, fastBalls[sweeping], deltaTime, ballCollisions);
+        }
+    }
+
+    std::size_t getFastCount() const { return fastBalls.size(); }
+    std::size_t getImpactCount() const { return impactCount; }
+
+private:
+    static constexpr float noImpact = 1e30f;
+    static constexpr uint32_t noBall = 0xffffffffu;
+
+    /**
+     * @brief Moves one fast ball through the step, impact by impact.
+     *
+     * @param balls System that owns the ball.
+     * @param i Index of the fast ball; its sweep starts from fastPosition, fastVelocity and fastTime.
+     * @param deltaTime Length of the step.
+     * @param ballCollisions Whether other balls are tested.
+     */
+    void sweepBall(BallSystem& balls, uint32_t i, float deltaTime, bool ballCollisions) {
+        const float r = balls.radius[i];
+        const uint32_t k = fastSlot[i];
+        glm::vec2 position = fastPosition[k];
+        glm::vec2 velocity = fastVelocity[k];
+        float time = fastTime[k];
+
+        for (int impact = 0; impact < maxImpacts && time < deltaTime; impact++) {
+            const float remaining = deltaTime - time;
+            int wall = -1;
+            float toi = wallImpact(position, velocity, r, remaining, wall);
+            uint32_t other = noBall;
+            if (ballCollisions) {
+                const float ballToi = ballImpact(balls, i, position, velocity, time, remaining, other);
+                if (ballToi < toi) {
+                    toi = ballToi;
+                    wall = -1;
+                }
+            }
+            if (toi > remaining) break;
+
+            position += velocity * toi;
+            time += toi;
+            impactCount++;
+            if (wall >= 0) respondToWall(balls, wall, velocity);
+            else respondToBall(balls, i, other, position, velocity, time, deltaTime);
+        }
+
+        position += velocity * (deltaTime - time);
+        position.x = glm::clamp(position.x, -1.0f + r, 1.0f - r);
+        position.y = glm::clamp(position.y, -1.0f + r, 1.0f - r);
+        balls.x[i] = position.x;
+        balls.y[i] = position.y;
+        balls.vx[i] = velocity.x;
+        balls.vy[i] = velocity.y;
+
+        // Later fast balls see this one moving linearly along its last segment
+        startX[i] = position.x - velocity.x * deltaTime;
+        startY[i] = position.y - velocity.y * deltaTime;
+    }
+
+    /**
+     * @brief Finds when a moving circle first touches one of the walls of the [-1, 1] box.
+     *
+     * @param wall Receives 0 for the side walls, 1 for the ground and 2 for the ceiling.
+     * @return Time of impact, or noImpact.
+     */
+    static float wallImpact(glm::vec2 position, glm::vec2 velocity, float r, float remaining, int& wall) {
+        float toi = noImpact;
+        if (velocity.x > 0.0f) considerWall((1.0f - r - position.x) / velocity.x, 0, toi, wall);
+        else if (velocity.x < 0.0f) considerWall((-1.0f + r - position.x) / velocity.x, 0, toi, wall);
+        if (velocity.y < 0.0f) considerWall((-1.0f + r - position.y) / velocity.y, 1, toi, wall);
+        else if (velocity.y > 0.0f) considerWall((1.0f - r - position.y) / velocity.y, 2, toi, wall);
+        return toi <= remaining ? toi : noImpact;
+    }
+
+    static void considerWall(float t, int candidate, float& toi, int& wall) {
+        t = std::max(t, 0.0f);
+        if (t < toi) {
+            toi = t;
+            wall = candidate;
+        }
+    }
+
+    /**
+     * @brief Applies the same wall response as BallSystem::handleCollisions.
+     */
+    static void respondToWall(const BallSystem& balls, int wall, glm::vec2& velocity) {
+        const float damping = balls.material.damping;
+        const float velocityThreshold = balls.material.velocityThreshold;
+        if (wall == 0) {
+            velocity.x *= -damping;
+            if (std::fabs(velocity.x) < velocityThreshold) velocity.x = 0.0f;
+        }
+        else if (wall == 1) {
+            velocity.y *= -damping;
+            velocity.x *= damping;  // Ground friction
+            if (std::fabs(velocity.y) < velocityThreshold) velocity.y = 0.0f;
+            if (std::fabs(velocity.x) < velocityThreshold) velocity.x = 0.0f;
+        }
+        else {
+            velocity.y *= -damping;
+            if (std::fabs(velocity.y) < velocityThreshold) velocity.y = 0.0f;
+        }
+    }
+
+    /**
+     * @brief Finds the first ball the fast ball touches along its remaining path.
+     *
+     * @param balls System that owns the balls.
+     * @param i Index of the fast ball.
+     * @param position Position of the fast ball at time.
+     * @param velocity Velocity of the fast ball.
+     * @param time Time into the step.
+     * @param remaining Time left in the step.
+     * @param other Receives the index of the ball that is hit.
+     * @return Time of impact relative to time, or noImpact.
+     */
+    float ballImpact(const BallSystem& balls, uint32_t i, glm::vec2 position, glm::vec2 velocity, float time, float remaining, uint32_t& other) {
+        const float r = balls.radius[i];
+        const glm::vec2 end = position + velocity * remaining;
+        const float deltaTime = time + remaining;
+        int x0, y0, x1, y1;
+        cellRange(std::min(position.x, end.x) - r, std::min(position.y, end.y) - r,
+            std::max(position.x, end.x) + r, std::max(position.y, end.y) + r, x0, y0, x1, y1);
+
+        queryStamp++;
+        float toi = noImpact;
+        for (int cy = y0; cy <= y1; cy++) {
+            for (int cx = x0; cx <= x1; cx++) {
+                const int cell = cy * gridSize + cx;
+                for (uint32_t slot = cellStart[cell]; slot < cellStart[cell + 1]; slot++) {
+                    const uint32_t j = cellBalls[slot];
+                    if (j == i || visitStamp[j] == queryStamp) continue;
+                    visitStamp[j] = queryStamp;
+
+                    // Other ball moves linearly from its start to its end position
+                    const glm::vec2 otherVelocity((balls.x[j] - startX[j]) / deltaTime, (balls.y[j] - startY[j]) / deltaTime);
+                    const glm::vec2 otherPosition = glm::vec2(startX[j], startY[j]) + otherVelocity * time;
+                    const float t = circleImpact(otherPosition - position, otherVelocity - velocity, r + balls.radius[j]);
+                    if (t <= remaining && t < toi) {
+                        toi = t;
+                        other = j;
+                    }
+                }
+            }
+        }
+        return toi;
+    }
+
+    /**
+     * @brief Solves |p + w t| = R for the first touch of two circles in relative motion.
+     *
+     * @param p Relative position.
+     * @param w Relative velocity.
+     * @param R Sum of the radii.
+     * @return Time of impact, or noImpact if the circles overlap already, separate or miss.
+     */
+    static float circleImpact(glm::vec2 p, glm::vec2 w, float R) {
+        const float c = glm::dot(p, p) - R * R;
+        const float b = glm::dot(p, w);
+        if (c <= 0.0f || b >= 0.0f) return noImpact;  // Overlaps are left to the discrete solver
+        const float a = glm::dot(w, w);
+        const float discriminant = b * b - a * c;
+        if (discriminant < 0.0f) return noImpact;
+        return c / (-b + std::sqrt(discriminant));  // Same root as (-b - sqrt) / a, without cancellation
+    }
+
+    /**
+     * @brief Applies the ball-ball impulse of BallCollisionSolver::resolvePair at the moment of impact.
+     *
+     * The ball that is hit gets a new path through its impact position, which
+     * bounces off the walls and is clamped to the box like the fast ball's.
+     * A sleeping ball is woken first, so it reacts with its own mass.
+     */
+    void respondToBall(BallSystem& balls, uint32_t i, uint32_t j, glm::vec2 position, glm::vec2& velocity, float time, float deltaTime) {
+        if (balls.sleeping[j]) balls.wake(j);
+
+        glm::vec2 otherVelocity((balls.x[j] - startX[j]) / deltaTime, (balls.y[j] - startY[j]) / deltaTime);
+        const glm::vec2 otherPosition = glm::vec2(startX[j], startY[j]) + otherVelocity * time;
+        glm::vec2 normal = otherPosition - position;
+        const float dist = glm::length(normal);
+        normal = dist > 1e-6f ? normal / dist : glm::vec2(1.0f, 0.0f);
+
+        const float invMassA = 1.0f / (balls.radius[i] * balls.radius[i]);
+        const float invMassB = 1.0f / (balls.radius[j] * balls.radius[j]);
+        const float relativeVelocity = glm::dot(otherVelocity - velocity, normal);
+        if (relativeVelocity >= 0.0f) return;
+
+        const float impulse = -(1.0f + balls.material.damping) * relativeVelocity / (invMassA + invMassB);
+        velocity -= impulse * invMassA * normal;
+        otherVelocity += impulse * invMassB * normal;
+        const glm::vec2 impactVelocity = otherVelocity;
+
+        // A fast hit near a wall must not push the struck ball out of the box
+        const float r = balls.radius[j];
+        glm::vec2 otherEnd = otherPosition;
+        float otherTime = time;
+        for (int impact = 0; impact < maxImpacts && otherTime < deltaTime; impact++) {
+            const float remaining = deltaTime - otherTime;
+            int wall = -1;
+            const float toi = wallImpact(otherEnd, otherVelocity, r, remaining, wall);
+            if (toi > remaining) break;
+
+            otherEnd += otherVelocity * toi;
+            otherTime += toi;
+            impactCount++;
+            respondToWall(balls, wall, otherVelocity);
+        }
+        otherEnd += otherVelocity * (deltaTime - otherTime);
+        otherEnd.x = glm::clamp(otherEnd.x, -1.0f + r, 1.0f - r);
+        otherEnd.y = glm::clamp(otherEnd.y, -1.0f + r, 1.0f - r);
+
+        balls.x[j] = otherEnd.x;
+        balls.y[j] = otherEnd.y;
+        balls.vx[j] = otherVelocity.x;
+        balls.vy[j] = otherVelocity.y;
+        startX[j] = otherEnd.x - otherVelocity.x * deltaTime;
+        startY[j] = otherEnd.y - otherVelocity.y * deltaTime;
+
+        // A fast ball that has not been swept yet would otherwise start from its old state and lose the impulse
+        const uint32_t slot = fastSlot[j];
+        if (slot != noBall && slot > sweeping) {
+            fastPosition[slot] = otherPosition;
+            fastVelocity[slot] = impactVelocity;
+            fastTime[slot] = time;
+        }
+    }
+
+    /**
+     * @brief Bins every ball's swept bounding box into a uniform grid with a counting sort.
+     */
+    void buildGrid(const BallSystem& balls) {
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        float maxRadius = 0.0f;
+        for (uint32_t i = 0; i < count; i++) {
+            maxRadius = std::max(maxRadius, balls.radius[i]);
+        }
+
+        // Same sizing as UniformGridBroadphase: cells fit the largest ball, at most ~N cells
+        const int maxCellsForRadius = maxRadius > 0.0f ? static_cast<int>(2.0f / (2.0f * maxRadius)) : 1;
+        const int maxCellsForCount = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+        gridSize = std::max(1, std::min(maxCellsForRadius, maxCellsForCount));
+        cellScale = gridSize / 2.0f;
+
+        const int cellCount = gridSize * gridSize;
+        cellStart.assign(cellCount + 1, 0);
+        ballRange.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            const float r = balls.radius[i];
+            int x0, y0, x1, y1;
+            cellRange(std::min(startX[i], balls.x[i]) - r, std::min(startY[i], balls.y[i]) - r,
+                std::max(startX[i], balls.x[i]) + r, std::max(startY[i], balls.y[i]) + r, x0, y0, x1, y1);
+            ballRange[i] = { x0, y0, x1, y1 };
+            for (int cy = y0; cy <= y1; cy++) {
+                for (int cx = x0; cx <= x1; cx++) cellStart[cy * gridSize + cx + 1]++;
+            }
+        }
+        for (int cell = 0; cell < cellCount; cell++) {
+            cellStart[cell + 1] += cellStart[cell];
+        }
+
+        cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+        cellBalls.resize(cellStart[cellCount]);
+        for (uint32_t i = 0; i < count; i++) {
+            const CellRange& range = ballRange[i];
+            for (int cy = range.y0; cy <= range.y1; cy++) {
+                for (int cx = range.x0; cx <= range.x1; cx++) cellBalls[cellCursor[cy * gridSize + cx]++] = i;
+            }
+        }
+
+        visitStamp.assign(count, 0);
+        queryStamp = 0;
+    }
+
+    /**
+     * @brief Maps a world-space box to the range of cells it overlaps, clamped to the grid.
+     */
+    void cellRange(float minX, float minY, float maxX, float maxY, int& x0, int& y0, int& x1, int& y1) const {
+        x0 = toCell(minX);
+        y0 = toCell(minY);
+        x1 = toCell(maxX);
+        y1 = toCell(maxY);
+    }
+
+    int toCell(float coordinate) const {
+        return std::min(gridSize - 1, std::max(0, static_cast<int>((coordinate + 1.0f) * cellScale)));
+    }
+
+    /**
+     * @struct CellRange
+     * @brief Inclusive range of cells covered by a ball's swept box.
+     */
+    struct CellRange {
+        int x0, y0, x1, y1;
+    };
+
+    std::vector<uint32_t> fastBalls;      /* Balls handled by this solver in the current step */
+    std::vector<uint32_t> fastSlot;       /* Index of each ball in fastBalls, noBall for slow balls */
+    std::vector<glm::vec2> fastPosition;  /* Position each fast ball's sweep starts from */
+    std::vector<glm::vec2> fastVelocity;  /* Velocity each fast ball's sweep starts with */
+    std::vector<float> fastTime;          /* Time into the step each fast ball's sweep starts at */
+    std::size_t sweeping = 0;             /* Slot of the fast ball being swept */
+    AlignedArray<float> startX;           /* Position x at the start of each ball's straight path */
+    AlignedArray<float> startY;           /* Position y at the start of each ball's straight path */
+    int gridSize = 1;                     /* Number of cells along each axis */
+    float cellScale = 0.5f;               /* Cells per world unit */
+    std::vector<uint32_t> cellStart;      /* First slot of each cell in cellBalls, plus a sentinel */
+    std::vector<uint32_t> cellCursor;     /* Scatter cursors used during the counting sort */
+    std::vector<uint32_t> cellBalls;      /* Balls whose swept box overlaps each cell */
+    std::vector<CellRange> ballRange;     /* Cells covered by each ball */
+    std::vector<uint32_t> visitStamp;     /* Last query that tested each ball */
+    uint32_t queryStamp = 0;              /* Id of the current query */
+    std::size_t impactCount = 0;          /* Impacts handled in the last step */
+};
+
+#endif
@@ -0,0 +1,198 @@
+#ifndef ENTROPY_CODER_H
+#define ENTROPY_CODER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Appends an unsigned integer in LEB128 form: 7 bits per byte, high bit set on all but the last.
+ */
+inline void writeVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+/**
+ * @brief Reads an unsigned integer written by writeVarint.
+ *
+ * @param in Next byte to read; advanced past the integer.
+ * @param end One past the last readable byte.
+ * @param value Receives the integer.
+ * @return False if the input ends inside the integer or it does not fit 64 bits.
+ */
+inline bool readVarint(const uint8_t*& in, const uint8_t* end, uint64_t& value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (in == end) return false;
+        const uint8_t byte = *in++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+/**
+ * @class EntropyCoder
+ * @brief Order-0 range asymmetric numeral system (rANS) coder for byte streams.
+ *
+ * Each call codes one block with its own byte histogram, so blocks with
+ * different statistics, such as the low and high bytes of small deltas, are
+ * coded separately and compress well. A block is written as its length, its
+ * frequency table quantized to 1 << scaleBits and the rANS bytes. A block of
+ * a single repeated byte costs only its header.
+ */
+class EntropyCoder {
+public:
+    static constexpr uint32_t scaleBits = 12;          /* Frequencies sum to 1 << scaleBits */
+    static constexpr uint32_t scale = 1u << scaleBits; /* Sum of the quantized frequencies */
+    static constexpr uint32_t lowerBound = 1u << 23;   /* The coder state stays in [lowerBound, lowerBound << 8) */
+
+    /**
+     * @brief Appends a coded block.
+     *
+     * @param data Bytes to code.
+     * @param size Number of bytes.
+     * @param out Receives the block.
+     */
+    static void encode(const uint8_t* data, std::size_t size, std::vector<uint8_t>& out) {
+        writeVarint(out, size);
+        if (size == 0) return;
+
+        uint32_t frequencies[256];
+        uint32_t cumulative[257];
+        buildFrequencies(data, size, frequencies);
+        buildCumulative(frequencies, cumulative);
+        for (uint32_t frequency : frequencies) writeVarint(out, frequency);
+
+        // rANS codes back to front: the bytes are appended reversed, flipped in place, and their count moved in front of them
+        const std::size_t bytesStart = out.size();
+        uint32_t state = lowerBound;
+        for (std::size_t i = size; i-- > 0;) {
+            const uint8_t symbol = data[i];
+            const uint32_t frequency = frequencies[symbol];
+            const uint32_t stateMax = ((lowerBound >> scaleBits) << 8) * frequency;
+            while (state >= stateMax) {
+                out.push_back(static_cast<uint8_t>(state));
+                state >>= 8;
+            }
+            state = ((state / frequency) << scaleBits) + (state % frequency) + cumulative[symbol];
+        }
+        for (int i = 0; i < 4; i++) {
+            out.push_back(static_cast<uint8_t>(state));
+            state >>= 8;
+        }
+
+        const std::size_t byteCount = out.size() - bytesStart;
+        std::reverse(out.begin() + bytesStart, out.end());
+        writeVarint(out, byteCount);
+        std::rotate(out.begin() + bytesStart, out.begin() + bytesStart + byteCount, out.end());
+    }
+
+    /**
+     * @brief Gets an upper bound on the bytes encode appends for a block, for reserving output buffers.
+     *
+     * Two length varints, 256 frequencies below 1 << 14 and the rANS bytes,
+     * which carry at most scaleBits bits per symbol plus the 32-bit final state.
+     *
+     * @param size Number of bytes to code.
+     */
+    static std::size_t getMaxEncodedSize(std::size_t size) {
+        return 2 * 10 + 256 * 2 + (size * scaleBits + 7) / 8 + 4;
+    }
+
+    /**
+     * @brief Decodes a block written by encode.
+     *
+     * @param in Start of the block; advanced past it.
+     * @param end One past the last readable byte.
+     * @param out Receives the decoded bytes, replacing its contents.
+     * @return False if the block is malformed or runs past end.
+     */
+    static bool decode(const uint8_t*& in, const uint8_t* end, std::vector<uint8_t>& out) {
+        uint64_t size = 0;
+        if (!readVarint(in, end, size)) return false;
+        out.resize(static_cast<std::size_t>(size));
+        if (size == 0) return true;
+
+        uint32_t frequencies[256];
+        uint32_t cumulative[257];
+        for (uint32_t& frequency : frequencies) {
+            uint64_t value = 0;
+            if (!readVarint(in, end, value) || value > scale) return false;
+            frequency = static_cast<uint32_t>(value);
+        }
+        buildCumulative(frequencies, cumulative);
+        if (cumulative[256] != scale) return false;
+
+        uint8_t symbols[scale];
+        for (uint32_t symbol = 0; symbol < 256; symbol++) {
+            std::fill(symbols + cumulative[symbol], symbols + cumulative[symbol + 1], static_cast<uint8_t>(symbol));
+        }
+
+        uint64_t byteCount = 0;
+        if (!readVarint(in, end, byteCount) || byteCount < 4 || byteCount > static_cast<uint64_t>(end - in)) return false;
+        const uint8_t* bytes = in;
+        const uint8_t* bytesEnd = in + byteCount;
+        in = bytesEnd;
+
+        uint32_t state = (uint32_t(bytes[0]) << 24) | (uint32_t(bytes[1]) << 16) | (uint32_t(bytes[2]) << 8) | bytes[3];
+        bytes += 4;
+        for (std::size_t i = 0; i < out.size(); i++) {
+            const uint32_t slot = state & (scale - 1);
+            const uint8_t symbol = symbols[slot];
+            out[i] = symbol;
+            state = frequencies[symbol] * (state >> scaleBits) + slot - cumulative[symbol];
+            while (state < lowerBound) {
+                if (bytes == bytesEnd) return false;
+                state = (state << 8) | *bytes++;
+            }
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief Counts the bytes and scales the counts to sum to scale, keeping every present byte at least 1.
+     */
+    static void buildFrequencies(const uint8_t* data, std::size_t size, uint32_t* frequencies) {
+        uint64_t counts[256] = {};
+        for (std::size_t i = 0; i < size; i++) counts[data[i]]++;
+
+        uint32_t total = 0;
+        int largest = 0;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            frequencies[symbol] = 0;
+            if (counts[symbol] == 0) continue;
+            frequencies[symbol] = std::max<uint32_t>(1, static_cast<uint32_t>(counts[symbol] * scale / size));
+            total += frequencies[symbol];
+            if (frequencies[symbol] > frequencies[largest]) largest = symbol;
+        }
+
+        // Rounding leaves the sum a little off; the most frequent byte absorbs the difference
+        if (total < scale) {
+            frequencies[largest] += scale - total;
+        }
+        while (total > scale) {
+            for (int symbol = 0; symbol < 256 && total > scale; symbol++) {
+                if (frequencies[symbol] > 1 && frequencies[symbol] * 2 >= frequencies[largest]) {
+                    frequencies[symbol]--;
+                    total--;
+                }
+            }
+        }
+    }
+
+    static void buildCumulative(const uint32_t* frequencies, uint32_t* cumulative) {
+        cumulative[0] = 0;
+        for (int symbol = 0; symbol < 256; symbol++) {
+            cumulative[symbol + 1] = cumulative[symbol] + frequencies[symbol];
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,298 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Parallel.h"
+
+/**
+ * @class FrameArena
+ * @brief Bump allocator for memory that lives until the end of a frame.
+ *
+ * Allocation moves a cursor through a list of blocks and never frees
+ * anything; reset rewinds the cursor to the first block and keeps every
+ * block, so once the arena has grown to a frame's peak, later frames of the
+ * same size make no heap allocation at all. Not thread-safe: parallel phases
+ * give every thread its own arena through ThreadArenas.
+ */
+class FrameArena {
+public:
+    static constexpr std::size_t blockAlignment = 64;           /* Alignment of every block, the largest alignment served */
+    static constexpr std::size_t defaultBlockSize = 64 * 1024;  /* Size of the first block */
+
+    explicit FrameArena(std::size_t firstBlockSize = defaultBlockSize)
+        : blockSize(std::max<std::size_t>(firstBlockSize, blockAlignment)) {
+    }
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    FrameArena(FrameArena&& other) noexcept
+        : blocks(std::move(other.blocks)), blockSize(other.blockSize), current(other.current), used(other.used),
+          allocatedBytes(other.allocatedBytes), peakBytes(other.peakBytes) {
+        other.blocks.clear();
+        other.current = 0;
+        other.used = 0;
+        other.allocatedBytes = 0;
+    }
+
+    FrameArena& operator=(FrameArena&& other) noexcept {
+        if (this != &other) {
+            release();
+            blocks = std::move(other.blocks);
+            blockSize = other.blockSize;
+            current = other.current;
+            used = other.used;
+            allocatedBytes = other.allocatedBytes;
+            peakBytes = other.peakBytes;
+            other.blocks.clear();
+            other.current = 0;
+            other.used = 0;
+            other.allocatedBytes = 0;
+        }
+        return *this;
+    }
+
+    ~FrameArena() {
+        release();
+    }
+
+    /**
+     * @brief Allocates memory that stays valid until the next reset.
+     *
+     * @param size Number of bytes.
+     * @param alignment Power of two, at most blockAlignment.
+     * @return The memory; never null.
+     */
+    void* allocate(std::size_t size, std::size_t alignment = alignof(std::max_align_t)) {
+        alignment = std::min(alignment, blockAlignment);
+        allocatedBytes += size;
+        peakBytes = std::max(peakBytes, allocatedBytes);
+
+        if (current < blocks.size()) {
+            const std::size_t offset = (used + alignment - 1) & ~(alignment - 1);
+            if (offset + size <= blocks[current].size) {
+                used = offset + size;
+                return blocks[current].memory + offset;
+            }
+        }
+        return allocateFromNextBlock(size);
+    }
+
+    /**
+     * @brief Releases everything allocated since the last reset, keeping the memory for the next frame.
+     *
+     * If the blocks were added to since the last reset, or hold less than
+     * minBytes, they are replaced by one block with room for twice the larger
+     * of the peak and minBytes, so later frames of about the same size fit in
+     * the first block and a slowly growing frame adds blocks geometrically
+     * less often. The capacity never shrinks.
+     *
+     * @param minBytes Bytes a frame should be able to allocate without adding a block.
+     */
+    void reset(std::size_t minBytes = 0) {
+        const std::size_t capacity = getCapacity();
+        if (blocks.size() > 1 || capacity < minBytes) {
+            const std::size_t size = std::max(capacity, 2 * std::max(peakBytes, minBytes));
+            release();
+            addBlock((size + blockAlignment - 1) & ~(blockAlignment - 1));
+        }
+        current = 0;
+        used = 0;
+        allocatedBytes = 0;
+    }
+
+    /**
+     * @brief Gets the number of bytes allocated since the last reset.
+     */
+    std::size_t getAllocatedBytes() const { return allocatedBytes; }
+
+    /**
+     * @brief Gets the most bytes allocated between two resets.
+     */
+    std::size_t getPeakBytes() const { return peakBytes; }
+
+    /**
+     * @brief Gets the total size of the blocks the arena holds.
+     */
+    std::size_t getCapacity() const {
+        std::size_t capacity = 0;
+        for (const Block& block : blocks) capacity += block.size;
+        return capacity;
+    }
+
+private:
+    /**
+     * @struct Block
+     * @brief One heap allocation the arena hands out memory from.
+     */
+    struct Block {
+        unsigned char* memory; /* Start of the block, blockAlignment-aligned */
+        std::size_t size;      /* Bytes in the block */
+    };
+
+    /**
+     * @brief Moves on to the first later block with room for size bytes, adding one if none has.
+     */
+    void* allocateFromNextBlock(std::size_t size) {
+        std::size_t next = blocks.empty() ? 0 : current + 1;
+        while (next < blocks.size() && blocks[next].size < size) next++;
+
+        if (next == blocks.size()) {
+            // Double the block size, so a growing frame adds few blocks
+            if (!blocks.empty()) blockSize = blocks.back().size * 2;
+            addBlock(std::max(blockSize, (size + blockAlignment - 1) & ~(blockAlignment - 1)));
+        }
+
+        current = next;
+        used = size;
+        return blocks[current].memory;
+    }
+
+    void addBlock(std::size_t size) {
+        Block block;
+        block.memory = static_cast<unsigned char*>(::operator new(size, std::align_val_t(blockAlignment)));
+        block.size = size;
+        blocks.push_back(block);
+    }
+
+    void release() {
+        for (const Block& block : blocks) {
+            ::operator delete(block.memory, std::align_val_t(blockAlignment));
+        }
+        blocks.clear();
+    }
+
+    std::vector<Block> blocks;      /* Blocks in the order they are used */
+    std::size_t blockSize;          /* Size of the next block to add */
+    std::size_t current = 0;        /* Block allocations are taken from */
+    std::size_t used = 0;           /* Bytes of the current block handed out */
+    std::size_t allocatedBytes = 0; /* Bytes requested since the last reset */
+    std::size_t peakBytes = 0;      /* Most bytes requested between two resets */
+};
+
+/**
+ * @class ArenaAllocator
+ * @brief STL allocator that takes its memory from a FrameArena.
+ *
+ * Deallocation does nothing; the memory returns to the arena when it is
+ * reset, so a container must be destroyed or cleared before that. An
+ * allocator without an arena falls back to the heap, so a default-constructed
+ * container behaves like an ordinary one until an arena-backed one is moved
+ * into it.
+ */
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+    using propagate_on_container_copy_assignment = std::true_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(FrameArena& frameArena) noexcept : arena(&frameArena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.getArena()) {}
+
+    T* allocate(std::size_t n) {
+        if (arena == nullptr) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* pointer, std::size_t) noexcept {
+        if (arena == nullptr) ::operator delete(pointer);
+    }
+
+    FrameArena* getArena() const { return arena; }
+
+private:
+    FrameArena* arena = nullptr; /* Arena memory is taken from, null for the heap */
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.getArena() == b.getArena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) {
+    return a.getArena() != b.getArena();
+}
+
+/**
+ * @brief Vector whose storage comes from a FrameArena.
+ */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+/**
+ * @brief Makes room for at least count elements, with half again as much when the vector has to grow.
+ *
+ * A per-step buffer whose size creeps up, such as a contact list, would
+ * otherwise reallocate every time the size reaches a new high. The capacity
+ * never shrinks.
+ */
+template <typename Vector>
+void reserveWithHeadroom(Vector& vector, std::size_t count) {
+    if (count > vector.capacity()) vector.reserve(count + count / 2);
+}
+
+/**
+ * @class ThreadArenas
+ * @brief One FrameArena per job system thread, for allocations made inside parallel loops.
+ *
+ * Each thread allocates from its own arena, so the arenas need no locks. The
+ * owner resets all of them at the start of its frame, while none of its
+ * parallel loops are running; memory taken during a frame may be handed to
+ * other threads and stays valid until then. A set of arenas belongs to one
+ * owner, e.g. a solver, which must not be used from two threads at once:
+ * every thread outside the job system shares the first arena.
+ */
+class ThreadArenas {
+public:
+    /**
+     * @brief Releases everything allocated in the last frame and matches the arenas to the thread count.
+     */
+    void reset() {
+        const unsigned int threads = getWorkerCount();
+        while (arenas.size() < threads) arenas.emplace_back();
+        // Any thread may take the largest share of a frame's work, so every arena is sized for the largest peak
+        const std::size_t peak = getPeakBytes();
+        for (PaddedArena& padded : arenas) padded.arena.reset(peak);
+    }
+
+    /**
+     * @brief Gets the arena of the calling thread. The arenas must have been reset since the thread count last changed.
+     */
+    FrameArena& get() {
+        return arenas[getWorkerIndex()].arena;
+    }
+
+    /**
+     * @brief Gets the most bytes any one thread allocated in a frame.
+     */
+    std::size_t getPeakBytes() const {
+        std::size_t peak = 0;
+        for (const PaddedArena& padded : arenas) peak = std::max(peak, padded.arena.getPeakBytes());
+        return peak;
+    }
+
+private:
+    /**
+     * @struct PaddedArena
+     * @brief Keeps every thread's arena cursor on its own cache line.
+     */
+    struct alignas(64) PaddedArena {
+        FrameArena arena;
+    };
+
+    std::vector<PaddedArena> arenas; /* Arena of each job system thread */
+};
+
+#endif
@@ -0,0 +1,190 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+#include <cstdint>
+#include <iostream>
+#include "FrameWriter.h"
+
+/**
+ * @class FrameCapture
+ * @brief Offscreen framebuffer whose frames are read back asynchronously and handed to a FrameWriter.
+ *
+ * Frames are rendered into a color renderbuffer of a fixed size, independent
+ * of any window. capture copies the frame into the next of a ring of pixel
+ * pack buffers, which returns without waiting for the GPU; the buffer is only
+ * mapped pboCount frames later, when the ring comes back to it, by which time
+ * the copy has normally completed, so rendering, readback and the writer
+ * thread's encoding overlap.
+ */
+class FrameCapture {
+public:
+    static constexpr unsigned int pboCount = 3; /* Readbacks in flight */
+
+    /**
+     * @struct CaptureStats
+     * @brief Readbacks done so far.
+     */
+    struct CaptureStats {
+        uint64_t readbacks = 0; /* Frames copied into a pack buffer */
+        uint64_t stalls = 0;    /* Maps that had to wait for their copy to complete */
+    };
+
+    /**
+     * @brief Creates the framebuffer and the pack buffers. Requires a current GL context.
+     *
+     * @param frameWidth Width of the frames in pixels.
+     * @param frameHeight Height of the frames in pixels.
+     * @param frameWriter Receives the read back frames; nullptr renders without reading back.
+     */
+    FrameCapture(int frameWidth, int frameHeight, FrameWriter* frameWriter)
+        : width(frameWidth), height(frameHeight), writer(frameWriter) {
+        glGenRenderbuffers(1, &colorBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+        complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+        if (!complete) {
+            std::cerr << "ERROR::FRAME_CAPTURE::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        if (writer) {
+            glGenBuffers(pboCount, PBOs);
+            for (unsigned int i = 0; i < pboCount; i++) {
+                glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[i]);
+                glBufferData(GL_PIXEL_PACK_BUFFER, getFrameSize(), nullptr, GL_STREAM_READ);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    FrameCapture(const FrameCapture&) = delete;
+    FrameCapture& operator=(const FrameCapture&) = delete;
+
+    ~FrameCapture() {
+        cleanup();
+    }
+
+    bool isComplete() const { return complete; }
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const CaptureStats& getStats() const { return stats; }
+
+    /**
+     * @brief Makes the offscreen framebuffer the render target.
+     */
+    void bind() {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, width, height);
+    }
+
+    /**
+     * @brief Starts the readback of the frame just rendered and hands the oldest finished readback to the writer.
+     */
+    void capture() {
+        if (!writer) return;
+
+        const unsigned int slot = static_cast<unsigned int>(frameCount % pboCount);
+        // The slot is reused, so the frame it holds must be handed over first
+        if (frameCount >= pboCount) {
+            deliver(slot);
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[slot]);
+        // Into a pack buffer, glReadPixels only queues the copy
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        frameIndices[slot] = frameCount;
+        frameCount++;
+        stats.readbacks++;
+    }
+
+    /**
+     * @brief Hands every readback still in flight to the writer, oldest first.
+     */
+    void finish() {
+        if (!writer) return;
+        const uint64_t first = frameCount > pboCount ? frameCount - pboCount : 0;
+        for (uint64_t frame = first; frame < frameCount; frame++) {
+            const unsigned int slot = static_cast<unsigned int>(frame % pboCount);
+            if (fences[slot]) deliver(slot);
+        }
+    }
+
+    /**
+     * @brief Deletes the framebuffer and the pack buffers. Requires the GL context to still be current.
+     */
+    void cleanup() {
+        for (unsigned int i = 0; i < pboCount; i++) {
+            if (fences[i]) {
+                glDeleteSync(fences[i]);
+                fences[i] = nullptr;
+            }
+        }
+        if (PBOs[0]) {
+            glDeleteBuffers(pboCount, PBOs);
+            for (unsigned int i = 0; i < pboCount; i++) PBOs[i] = 0;
+        }
+        if (FBO) {
+            glDeleteFramebuffers(1, &FBO);
+            FBO = 0;
+        }
+        if (colorBuffer) {
+            glDeleteRenderbuffers(1, &colorBuffer);
+            colorBuffer = 0;
+        }
+    }
+
+private:
+    GLsizeiptr getFrameSize() const {
+        return static_cast<GLsizeiptr>(width) * height * 4;
+    }
+
+    /**
+     * @brief Waits for the readback in a slot, maps it and passes the pixels to the writer.
+     */
+    void deliver(unsigned int slot) {
+        GLenum result = glClientWaitSync(fences[slot], 0, 0);
+        if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED) {
+            stats.stalls++;
+            do {
+                result = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+            } while (result == GL_TIMEOUT_EXPIRED);
+        }
+        glDeleteSync(fences[slot]);
+        fences[slot] = nullptr;
+
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, PBOs[slot]);
+        const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, getFrameSize(), GL_MAP_READ_BIT);
+        if (pixels) {
+            writer->submit(pixels, frameIndices[slot]);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+        }
+        else {
+            std::cerr << "ERROR::FRAME_CAPTURE::MAP_FAILED" << std::endl;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    int width;                            /* Frame width in pixels */
+    int height;                           /* Frame height in pixels */
+    FrameWriter* writer;                  /* Receives the read back frames, may be nullptr */
+    unsigned int FBO = 0;                 /* Offscreen framebuffer */
+    unsigned int colorBuffer = 0;         /* RGBA8 color attachment */
+    bool complete = false;                /* Framebuffer can be rendered to */
+    unsigned int PBOs[pboCount] = {};     /* Ring of pixel pack buffers */
+    GLsync fences[pboCount] = {};         /* Completion of each buffer's copy, nullptr when delivered */
+    uint64_t frameIndices[pboCount] = {}; /* Frame held by each buffer */
+    uint64_t frameCount = 0;              /* Frames captured so far */
+    CaptureStats stats;                   /* Readbacks done so far */
+};
+
+#endif
@@ -0,0 +1,274 @@
+#ifndef FRAME_PROFILER_H
+#define FRAME_PROFILER_H
+
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "AllocationCounter.h"
+
+/**
+ * @class FrameProfiler
+ * @brief Measures the CPU and GPU time of each phase of a frame and keeps rolling statistics.
+ *
+ * Each phase is timed on the CPU with a steady clock and on the GPU with a
+ * GL_TIME_ELAPSED query. Queries alternate between two sets, and a set is read
+ * back when its turn comes round again, only if its results are available, so
+ * the profiler never waits for the GPU; a result that is still pending is
+ * dropped instead.
+ * GL_TIME_ELAPSED queries cannot overlap, so phases must not be nested.
+ *
+ * The last sampleCount samples of every phase are kept, and report prints
+ * their minimum, average and 99th percentile. When heap allocations are
+ * counted, the number made during each frame, on any thread, is kept too.
+ */
+class FrameProfiler {
+public:
+    static constexpr std::size_t sampleCount = 240; /* Samples kept per phase and clock */
+    static constexpr unsigned int querySets = 2;    /* Frames of GPU queries in flight */
+
+    /**
+     * @struct Statistics
+     * @brief Summary of the samples kept for one phase and clock, in milliseconds.
+     */
+    struct Statistics {
+        double min = 0.0;        /* Shortest sample */
+        double average = 0.0;    /* Mean of the samples */
+        double p99 = 0.0;        /* 99th percentile */
+        std::size_t samples = 0; /* Number of samples summarized */
+    };
+
+    /**
+     * @class ScopedPhase
+     * @brief Times a phase from construction to destruction.
+     */
+    class ScopedPhase {
+    public:
+        ScopedPhase(FrameProfiler& frameProfiler, int phaseIndex)
+            : profiler(frameProfiler), phase(phaseIndex) {
+            profiler.beginPhase(phase);
+        }
+
+        ~ScopedPhase() {
+            profiler.endPhase(phase);
+        }
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    private:
+        FrameProfiler& profiler; /* Profiler the phase belongs to */
+        int phase;               /* Index of the phase */
+    };
+
+    FrameProfiler() = default;
+    FrameProfiler(const FrameProfiler&) = delete;
+    FrameProfiler& operator=(const FrameProfiler&) = delete;
+
+    ~FrameProfiler() {
+        cleanup();
+    }
+
+    /**
+     * @brief Registers a phase. Requires a current GL context.
+     *
+     * @param name: Name printed in the report.
+     * @param gpuTimed: Whether the phase also gets GPU timer queries.
+     * @return Index of the phase.
+     */
+    int addPhase(const std::string& name, bool gpuTimed = true) {
+        Phase phase;
+        phase.name = name;
+        phase.gpuTimed = gpuTimed;
+        if (gpuTimed) {
+            glGenQueries(querySets, phase.queries);
+        }
+        phases.push_back(phase);
+        return static_cast<int>(phases.size()) - 1;
+    }
+
+    /**
+     * @brief Starts a frame: records the previous frame's duration and reads back the finished GPU queries.
+     */
+    void beginFrame() {
+        const auto now = std::chrono::steady_clock::now();
+        if (frameCount > 0) {
+            addSample(frameSamples, std::chrono::duration<double, std::milli>(now - frameStart).count());
+        }
+        frameStart = now;
+        const uint64_t allocations = getAllocationCount();
+        if (frameCount > 0 && isCountingAllocations()) {
+            addSample(allocationSamples, static_cast<double>(allocations - frameAllocations));
+        }
+        frameAllocations = allocations;
+        frameCount++;
+        querySet = static_cast<unsigned int>(frameCount % querySets);
+
+        // The current set was issued querySets frames ago; read it before it is reused
+        for (Phase& phase : phases) {
+            if (!phase.gpuTimed || !phase.issued[querySet]) continue;
+            phase.issued[querySet] = false;
+
+            GLint available = 0;
+            glGetQueryObjectiv(phase.queries[querySet], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                droppedQueries++;
+                continue;
+            }
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(phase.queries[querySet], GL_QUERY_RESULT, &elapsed);
+            addSample(phase.gpuSamples, elapsed / 1e6);
+        }
+    }
+
+    /**
+     * @brief Starts timing a phase.
+     *
+     * @param phaseIndex: Index returned by addPhase.
+     */
+    void beginPhase(int phaseIndex) {
+        Phase& phase = phases[phaseIndex];
+        phase.cpuStart = std::chrono::steady_clock::now();
+        if (phase.gpuTimed) {
+            glBeginQuery(GL_TIME_ELAPSED, phase.queries[querySet]);
+        }
+    }
+
+    /**
+     * @brief Stops timing a phase.
+     *
+     * @param phaseIndex: Index returned by addPhase.
+     */
+    void endPhase(int phaseIndex) {
+        Phase& phase = phases[phaseIndex];
+        if (phase.gpuTimed) {
+            glEndQuery(GL_TIME_ELAPSED);
+            phase.issued[querySet] = true;
+        }
+        addSample(phase.cpuSamples, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - phase.cpuStart).count());
+    }
+
+    /**
+     * @brief Adds a CPU sample measured elsewhere, e.g. on another thread.
+     *
+     * @param phaseIndex: Index returned by addPhase.
+     * @param milliseconds: Duration of the phase.
+     */
+    void addCpuSample(int phaseIndex, double milliseconds) {
+        addSample(phases[phaseIndex].cpuSamples, milliseconds);
+    }
+
+    Statistics getCpuStatistics(int phaseIndex) const { return summarize(phases[phaseIndex].cpuSamples); }
+    Statistics getGpuStatistics(int phaseIndex) const { return summarize(phases[phaseIndex].gpuSamples); }
+    Statistics getFrameStatistics() const { return summarize(frameSamples); }
+    Statistics getAllocationStatistics() const { return summarize(allocationSamples); }
+    uint64_t getDroppedQueryCount() const { return droppedQueries; }
+
+    /**
+     * @brief Prints the statistics of every phase.
+     *
+     * @param out: Stream to print to.
+     */
+    void report(std::ostream& out) const {
+        const std::ios_base::fmtflags flags = out.flags();
+        const std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(3);
+        out << "Frame profile (ms over the last " << sampleCount << " samples: min / avg / p99)\n";
+        printLine(out, "frame", "cpu", getFrameStatistics());
+        for (const Phase& phase : phases) {
+            printLine(out, phase.name, "cpu", summarize(phase.cpuSamples));
+            if (phase.gpuTimed) {
+                printLine(out, phase.name, "gpu", summarize(phase.gpuSamples));
+            }
+        }
+        if (isCountingAllocations()) {
+            const Statistics allocations = getAllocationStatistics();
+            out << std::setprecision(1) << "  heap allocations per frame: " << allocations.min << " / " << allocations.average
+                << " / " << allocations.p99 << std::setprecision(3) << "\n";
+        }
+        out << "  dropped GPU queries: " << droppedQueries << std::endl;
+        out.flags(flags);
+        out.precision(precision);
+    }
+
+    /**
+     * @brief Deletes the query objects. Requires the GL context to still be current.
+     */
+    void cleanup() {
+        for (Phase& phase : phases) {
+            if (phase.gpuTimed) {
+                glDeleteQueries(querySets, phase.queries);
+            }
+        }
+        phases.clear();
+    }
+
+private:
+    /**
+     * @struct SampleRing
+     * @brief The most recent samples of one phase and clock.
+     */
+    struct SampleRing {
+        std::vector<double> values; /* Samples in milliseconds, oldest overwritten first */
+        std::size_t next = 0;       /* Slot the next sample overwrites once full */
+    };
+
+    /**
+     * @struct Phase
+     * @brief Timers and samples of one phase.
+     */
+    struct Phase {
+        std::string name;                               /* Name printed in the report */
+        bool gpuTimed = true;                           /* Has GPU timer queries */
+        GLuint queries[querySets] = {};                 /* GL_TIME_ELAPSED query of each set */
+        bool issued[querySets] = {};                    /* Query of each set awaits its result */
+        std::chrono::steady_clock::time_point cpuStart; /* Start of the running CPU timer */
+        SampleRing cpuSamples;                          /* CPU durations */
+        SampleRing gpuSamples;                          /* GPU durations */
+    };
+
+    static void addSample(SampleRing& ring, double value) {
+        if (ring.values.size() < sampleCount) {
+            ring.values.push_back(value);
+            return;
+        }
+        ring.values[ring.next] = value;
+        ring.next = (ring.next + 1) % sampleCount;
+    }
+
+    static Statistics summarize(const SampleRing& ring) {
+        Statistics statistics;
+        statistics.samples = ring.values.size();
+        if (ring.values.empty()) return statistics;
+
+        std::vector<double> sorted(ring.values);
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0.0;
+        for (double value : sorted) sum += value;
+        statistics.min = sorted.front();
+        statistics.average = sum / sorted.size();
+        statistics.p99 = sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)];
+        return statistics;
+    }
+
+    static void printLine(std::ostream& out, const std::string& name, const char* clock, const Statistics& statistics) {
+        out << "  " << std::left << std::setw(10) << name << std::right << " " << clock << " "
+            << std::setw(8) << statistics.min << " / " << std::setw(8) << statistics.average << " / "
+            << std::setw(8) << statistics.p99 << "\n";
+    }
+
+    std::vector<Phase> phases;                        /* Registered phases */
+    SampleRing frameSamples;                          /* Durations of whole frames */
+    std::chrono::steady_clock::time_point frameStart; /* Start of the current frame */
+    uint64_t frameCount = 0;                          /* Frames begun so far */
+    SampleRing allocationSamples;                     /* Heap allocations made during whole frames */
+    uint64_t frameAllocations = 0;                    /* Allocation count at the start of the current frame */
+    unsigned int querySet = 0;                        /* Query set used by the current frame */
+    uint64_t droppedQueries = 0;                      /* GPU results that were not ready in time */
+};
+
+#endif
@@ -0,0 +1,393 @@
+#ifndef FRAME_WRITER_H
+#define FRAME_WRITER_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Checksum.h"
+#include "FrameArena.h"
+
+/**
+ * @brief File format of written frames.
+ */
+enum class FrameFormat {
+    None, /* Frames are discarded */
+    Ppm,  /* One binary PPM file per frame */
+    Png,  /* One uncompressed PNG file per frame */
+    Raw   /* One stream of rgb24 frames, e.g. for ffmpeg -f rawvideo */
+};
+
+/**
+ * @class FrameWriter
+ * @brief Encodes and writes rendered frames on a background thread.
+ *
+ * Frames are handed over as bottom-up RGBA rows, as glReadPixels returns them,
+ * and are flipped, converted to RGB and written on the writer thread, so the
+ * render loop only pays for one copy. The queue holds at most queueCapacity
+ * frames; when the writer falls behind, submit waits for a free slot rather
+ * than dropping frames, and the waits are counted so a run shows whether the
+ * disk or the encoder was the bottleneck.
+ *
+ * PPM and PNG frames go to one file each, named by formatting the output path
+ * with the frame number (e.g. "frames/frame_%05d.png"). A path that is not such
+ * a pattern is turned into one by makeFramePattern, so it never reaches
+ * snprintf as is. Raw frames are appended to one file, or to standard output if
+ * the path is "-".
+ */
+class FrameWriter {
+public:
+    /**
+     * @struct WriterStats
+     * @brief Work done by the writer so far.
+     */
+    struct WriterStats {
+        uint64_t frames = 0;     /* Frames written */
+        uint64_t bytes = 0;      /* Bytes written */
+        uint64_t queueWaits = 0; /* Submits that waited for the writer */
+        bool failed = false;     /* A write failed; later frames are discarded */
+    };
+
+    /**
+     * @brief Opens the output and starts the writer thread.
+     *
+     * @param frameFormat Format of the written frames.
+     * @param outputPath File name pattern for PPM and PNG, file name or "-" for raw.
+     * @param frameWidth Width of the frames in pixels.
+     * @param frameHeight Height of the frames in pixels.
+     * @param queueCapacity Frames that may wait to be written.
+     */
+    FrameWriter(FrameFormat frameFormat, const std::string& outputPath, int frameWidth, int frameHeight, std::size_t queueCapacity = 4)
+        : format(frameFormat), path(outputPath), width(frameWidth), height(frameHeight), capacity(std::max<std::size_t>(queueCapacity, 1)) {
+        if (format == FrameFormat::Ppm || format == FrameFormat::Png) {
+            path = makeFramePattern(path);
+        }
+        // A frame is queued, written or being copied by submit; none of them allocates once every slot has its buffer
+        frames.resize(capacity);
+        freeBuffers.reserve(capacity + 2);
+        if (format == FrameFormat::Raw) {
+            stream = path == "-" ? stdout : std::fopen(path.c_str(), "wb");
+            if (!stream) {
+                std::cerr << "ERROR::FRAME_WRITER::OPEN_FAILED " << path << std::endl;
+                stats.failed = true;
+            }
+        }
+        if (format != FrameFormat::None) {
+            thread = std::thread([this]() { run(); });
+        }
+    }
+
+    FrameWriter(const FrameWriter&) = delete;
+    FrameWriter& operator=(const FrameWriter&) = delete;
+
+    ~FrameWriter() {
+        close();
+    }
+
+    /**
+     * @brief Queues a frame for writing, waiting if the queue is full.
+     *
+     * @param rgba Bottom-up RGBA rows of width * height pixels; copied before returning.
+     * @param frameIndex Number of the frame, used in the file name.
+     */
+    void submit(const void* rgba, uint64_t frameIndex) {
+        if (format == FrameFormat::None) return;
+
+        std::vector<uint8_t> pixels;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (queued >= capacity) {
+                stats.queueWaits++;
+                notFull.wait(lock, [this]() { return queued < capacity; });
+            }
+            // Reuse the storage of a written frame instead of allocating a new one
+            if (!freeBuffers.empty()) {
+                pixels = std::move(freeBuffers.back());
+                freeBuffers.pop_back();
+            }
+        }
+        pixels.resize(static_cast<std::size_t>(width) * height * 4);
+        std::memcpy(pixels.data(), rgba, pixels.size());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            Frame& frame = frames[(first + queued) % capacity];
+            frame.index = frameIndex;
+            frame.pixels = std::move(pixels);
+            queued++;
+        }
+        notEmpty.notify_one();
+    }
+
+    /**
+     * @brief Writes the queued frames, stops the writer thread and closes the output.
+     */
+    void close() {
+        if (thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closing = true;
+            }
+            notEmpty.notify_one();
+            thread.join();
+        }
+        if (stream && stream != stdout) {
+            std::fclose(stream);
+        }
+        else if (stream) {
+            std::fflush(stream);
+        }
+        stream = nullptr;
+    }
+
+    WriterStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    /**
+     * @brief Tells whether a file name pattern can be formatted with one frame number.
+     *
+     * The pattern must hold exactly one int conversion, %d or %i with optional
+     * flags, width and precision, and no other '%' except "%%".
+     */
+    static bool isFramePattern(const std::string& pattern) {
+        const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+        const auto isFlag = [](char c) { return c == '-' || c == '+' || c == ' ' || c == '#' || c == '0'; };
+        int conversions = 0;
+        for (std::size_t i = 0; i < pattern.size(); i++) {
+            if (pattern[i] != '%') continue;
+            std::size_t j = i + 1;
+            if (j < pattern.size() && pattern[j] == '%') {
+                i = j;
+                continue;
+            }
+            while (j < pattern.size() && isFlag(pattern[j])) j++;
+            while (j < pattern.size() && isDigit(pattern[j])) j++;
+            if (j < pattern.size() && pattern[j] == '.') {
+                j++;
+                while (j < pattern.size() && isDigit(pattern[j])) j++;
+            }
+            if (j >= pattern.size() || (pattern[j] != 'd' && pattern[j] != 'i')) return false;
+            conversions++;
+            i = j;
+        }
+        return conversions == 1;
+    }
+
+    /**
+     * @brief Turns an output path into a file name pattern with one frame number.
+     *
+     * A valid pattern is returned unchanged. Otherwise every '%' is escaped and
+     * "_%05d" is inserted before the extension, so "out.png" becomes
+     * "out_%05d.png".
+     */
+    static std::string makeFramePattern(const std::string& outputPath) {
+        if (isFramePattern(outputPath)) return outputPath;
+
+        std::string pattern;
+        for (char c : outputPath) {
+            if (c == '%') pattern += '%';
+            pattern += c;
+        }
+        // The extension starts at the last dot of the file name, not of a directory
+        const std::size_t separator = pattern.find_last_of("/\\");
+        const std::size_t nameStart = separator == std::string::npos ? 0 : separator + 1;
+        std::size_t dot = pattern.rfind('.');
+        if (dot == std::string::npos || dot <= nameStart) dot = pattern.size();
+        pattern.insert(dot, "_%05d");
+        return pattern;
+    }
+
+private:
+    /**
+     * @struct Frame
+     * @brief A frame waiting to be written.
+     */
+    struct Frame {
+        uint64_t index;              /* Frame number */
+        std::vector<uint8_t> pixels; /* Bottom-up RGBA rows */
+    };
+
+    /**
+     * @brief Body of the writer thread.
+     */
+    void run() {
+        std::vector<uint8_t> rgb;
+        std::vector<uint8_t> encoded;
+        FrameArena arena;
+        char framePath[1024];
+        while (true) {
+            Frame frame;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                notEmpty.wait(lock, [this]() { return closing || queued > 0; });
+                if (queued == 0) return;
+                frame = std::move(frames[first]);
+                first = (first + 1) % capacity;
+                queued--;
+            }
+            notFull.notify_one();
+
+            arena.reset();
+            convertToRgb(frame.pixels, rgb);
+            std::size_t written = 0;
+            bool ok = !stats.failed;
+            if (ok) {
+                if (format == FrameFormat::Raw) {
+                    ok = std::fwrite(rgb.data(), 1, rgb.size(), stream) == rgb.size();
+                    written = rgb.size();
+                }
+                else {
+                    if (format == FrameFormat::Png) encodePng(rgb, encoded, arena);
+                    else encodePpm(rgb, encoded);
+                    getFramePath(frame.index, framePath, sizeof(framePath));
+                    ok = writeFile(framePath, encoded);
+                    written = encoded.size();
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            if (ok) {
+                stats.frames++;
+                stats.bytes += written;
+            }
+            else if (!stats.failed) {
+                std::cerr << "ERROR::FRAME_WRITER::WRITE_FAILED frame " << frame.index << std::endl;
+                stats.failed = true;
+            }
+            freeBuffers.push_back(std::move(frame.pixels));
+        }
+    }
+
+    /**
+     * @brief Flips bottom-up RGBA rows into top-down RGB rows.
+     */
+    void convertToRgb(const std::vector<uint8_t>& rgba, std::vector<uint8_t>& rgb) const {
+        rgb.resize(static_cast<std::size_t>(width) * height * 3);
+        for (int row = 0; row < height; row++) {
+            const uint8_t* source = &rgba[static_cast<std::size_t>(height - 1 - row) * width * 4];
+            uint8_t* destination = &rgb[static_cast<std::size_t>(row) * width * 3];
+            for (int x = 0; x < width; x++) {
+                destination[x * 3 + 0] = source[x * 4 + 0];
+                destination[x * 3 + 1] = source[x * 4 + 1];
+                destination[x * 3 + 2] = source[x * 4 + 2];
+            }
+        }
+    }
+
+    void encodePpm(const std::vector<uint8_t>& rgb, std::vector<uint8_t>& out) const {
+        const std::string header = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+        out.assign(header.begin(), header.end());
+        out.insert(out.end(), rgb.begin(), rgb.end());
+    }
+
+    /**
+     * @brief Encodes an RGB image as a PNG with stored (uncompressed) deflate blocks.
+     *
+     * Compression would cost far more than the disk bandwidth it saves for
+     * frames that are re-encoded to video afterwards anyway. The scanlines and
+     * the zlib stream are assembled in the writer's frame arena.
+     */
+    void encodePng(const std::vector<uint8_t>& rgb, std::vector<uint8_t>& out, FrameArena& arena) const {
+        static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        out.assign(signature, signature + 8);
+
+        uint8_t header[13];
+        putBigEndian(header, static_cast<uint32_t>(width));
+        putBigEndian(header + 4, static_cast<uint32_t>(height));
+        header[8] = 8;  // Bits per channel
+        header[9] = 2;  // Truecolor
+        header[10] = 0; // Deflate
+        header[11] = 0; // Adaptive filtering
+        header[12] = 0; // Not interlaced
+        appendChunk(out, "IHDR", header, sizeof(header));
+
+        // Every row starts with filter type 0 (none)
+        const std::size_t rowSize = static_cast<std::size_t>(width) * 3 + 1;
+        ArenaVector<uint8_t> scanlines(rowSize * height, 0, ArenaAllocator<uint8_t>(arena));
+        for (int row = 0; row < height; row++) {
+            scanlines[row * rowSize] = 0;
+            std::memcpy(&scanlines[row * rowSize + 1], &rgb[static_cast<std::size_t>(row) * width * 3], rowSize - 1);
+        }
+
+        // zlib stream of stored blocks of at most 65535 bytes
+        const std::size_t maxBlock = 65535;
+        ArenaVector<uint8_t> zlib{ ArenaAllocator<uint8_t>(arena) };
+        zlib.reserve(scanlines.size() + scanlines.size() / maxBlock * 5 + 11);
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+        std::size_t offset = 0;
+        do {
+            const std::size_t block = std::min(maxBlock, scanlines.size() - offset);
+            const bool last = offset + block == scanlines.size();
+            zlib.push_back(last ? 1 : 0);
+            zlib.push_back(static_cast<uint8_t>(block & 0xff));
+            zlib.push_back(static_cast<uint8_t>(block >> 8));
+            zlib.push_back(static_cast<uint8_t>(~block & 0xff));
+            zlib.push_back(static_cast<uint8_t>((~block >> 8) & 0xff));
+            zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + block);
+            offset += block;
+        } while (offset < scanlines.size());
+        uint8_t adler[4];
+        putBigEndian(adler, updateAdler32(1, scanlines.data(), scanlines.size()));
+        zlib.insert(zlib.end(), adler, adler + 4);
+
+        appendChunk(out, "IDAT", zlib.data(), zlib.size());
+        appendChunk(out, "IEND", nullptr, 0);
+    }
+
+    static void putBigEndian(uint8_t* out, uint32_t value) {
+        out[0] = static_cast<uint8_t>(value >> 24);
+        out[1] = static_cast<uint8_t>(value >> 16);
+        out[2] = static_cast<uint8_t>(value >> 8);
+        out[3] = static_cast<uint8_t>(value);
+    }
+
+    static void appendChunk(std::vector<uint8_t>& out, const char* type, const uint8_t* data, std::size_t size) {
+        uint8_t field[4];
+        putBigEndian(field, static_cast<uint32_t>(size));
+        out.insert(out.end(), field, field + 4);
+        const std::size_t typeOffset = out.size();
+        out.insert(out.end(), type, type + 4);
+        if (size > 0) out.insert(out.end(), data, data + size);
+        // The CRC covers the type and the data
+        putBigEndian(field, updateCrc32(0, &out[typeOffset], size + 4));
+        out.insert(out.end(), field, field + 4);
+    }
+
+    void getFramePath(uint64_t frameIndex, char* name, std::size_t size) const {
+        std::snprintf(name, size, path.c_str(), static_cast<int>(frameIndex));
+    }
+
+    static bool writeFile(const char* fileName, const std::vector<uint8_t>& data) {
+        FILE* file = std::fopen(fileName, "wb");
+        if (!file) return false;
+        const bool ok = std::fwrite(data.data(), 1, data.size(), file) == data.size();
+        return std::fclose(file) == 0 && ok;
+    }
+
+    FrameFormat format;                            /* Format of the written frames */
+    std::string path;                              /* Output file or file name pattern */
+    int width;                                     /* Frame width in pixels */
+    int height;                                    /* Frame height in pixels */
+    std::size_t capacity;                          /* Frames that may wait to be written */
+    FILE* stream = nullptr;                        /* Raw output stream */
+    std::thread thread;                            /* The writer thread */
+    std::mutex mutex;                              /* Guards the queue, the free buffers and the stats */
+    std::condition_variable notEmpty;              /* Signalled when a frame is queued or the writer closes */
+    std::condition_variable notFull;               /* Signalled when the writer takes a frame */
+    std::vector<Frame> frames;                     /* Ring of frames waiting to be written */
+    std::size_t first = 0;                         /* Slot of the oldest queued frame */
+    std::size_t queued = 0;                        /* Frames waiting to be written */
+    std::vector<std::vector<uint8_t>> freeBuffers; /* Pixel storage of written frames, reused by submit */
+    bool closing = false;                          /* Set to stop the writer once the queue is empty */
+    WriterStats stats;                             /* Work done so far */
+};
+
+#endif
@@ -0,0 +1,112 @@
+#ifndef GRAVITY_SOLVER_H
+#define GRAVITY_SOLVER_H
+
+#include <cmath>
+#include <vector>
+#include "BallSystem.h"
+#include "BarnesHutTree.h"
+#include "Parallel.h"
+
+/**
+ * @brief How mutual gravitation between balls is evaluated.
+ */
+enum class GravityMode {
+    Off,      // No mutual gravitation
+    Direct,   // Exact O(N^2) pairwise sum
+    BarnesHut // Quadtree approximation controlled by theta
+};
+
+/**
+ * @class GravitySolver
+ * @brief Applies mutual gravitational attraction between all balls.
+ *
+ * Each ball's mass is its radius squared. Accelerations are computed from the
+ * positions at the start of the step and applied to the velocities before
+ * integration.
+ */
+class GravitySolver {
+public:
+    GravityMode mode = GravityMode::Off; /* Evaluation method */
+    float theta = 0.5f;                  /* Barnes-Hut opening angle */
+    float gravitationalConstant = 1.0f;  /* Gravitational constant G */
+    float softening = 0.01f;             /* Softening length that keeps close encounters finite */
+
+    /**
+     * @brief Computes accelerations and adds them to the ball velocities.
+     *
+     * @param balls System to update.
+     * @param deltaTime Time step for the physics update.
+     */
+    void apply(BallSystem& balls, float deltaTime) {
+        if (mode == GravityMode::Off || balls.size() < 2) return;
+
+        computeAccelerations(balls);
+        float* vx = balls.vx.data();
+        float* vy = balls.vy.data();
+        for (std::size_t i = 0; i < balls.size(); i++) {
+            vx[i] += ax[i] * deltaTime;
+            vy[i] += ay[i] * deltaTime;
+        }
+    }
+
+    /**
+     * @brief Computes the acceleration of every ball with the current mode.
+     *
+     * @param balls System to evaluate.
+     */
+    void computeAccelerations(const BallSystem& balls) {
+        ax.assign(balls.size(), 0.0f);
+        ay.assign(balls.size(), 0.0f);
+
+        if (mode == GravityMode::Direct) {
+            parallelFor(0, balls.size(), 256, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t i = begin; i < end; i++) {
+                    glm::vec2 acceleration = directAcceleration(balls, i, gravitationalConstant, softening);
+                    ax[i] = acceleration.x;
+                    ay[i] = acceleration.y;
+                }
+            });
+        }
+        else if (mode == GravityMode::BarnesHut) {
+            tree.build(balls);
+            tree.computeAccelerations(theta, gravitationalConstant, softening, ax.data(), ay.data());
+        }
+    }
+
+    /**
+     * @brief Exact acceleration of one ball, summed over every other ball.
+     *
+     * @param balls System that owns the balls.
+     * @param i Index of the ball.
+     * @param gravitationalConstant Gravitational constant G.
+     * @param softening Softening length.
+     * @return Acceleration of the ball.
+     */
+    static glm::vec2 directAcceleration(const BallSystem& balls, std::size_t i, float gravitationalConstant, float softening) {
+        const float px = balls.x[i];
+        const float py = balls.y[i];
+        const float softening2 = softening * softening;
+        float sumX = 0.0f, sumY = 0.0f;
+        for (std::size_t j = 0; j < balls.size(); j++) {
+            if (j == i) continue;
+            const float dx = balls.x[j] - px;
+            const float dy = balls.y[j] - py;
+            const float invR = 1.0f / std::sqrt(dx * dx + dy * dy + softening2);
+            const float factor = balls.radius[j] * balls.radius[j] * invR * invR * invR;
+            sumX += dx * factor;
+            sumY += dy * factor;
+        }
+        return glm::vec2(sumX * gravitationalConstant, sumY * gravitationalConstant);
+    }
+
+    const std::vector<float>& getAccelerationX() const { return ax; }
+    const std::vector<float>& getAccelerationY() const { return ay; }
+    const BarnesHutTree& getTree() const { return tree; }
+
+private:
+    BarnesHutTree tree;    /* Quadtree reused between steps */
+    std::vector<float> ax; /* Acceleration x of each ball */
+    std::vector<float> ay; /* Acceleration y of each ball */
+};
+
+#endif
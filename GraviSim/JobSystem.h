@@ -0,0 +1,298 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @class JobSystem
+ * @brief Fixed pool of worker threads that share work through per-thread work-stealing deques.
+ *
+ * parallelFor pushes one job for the whole range; whoever runs a job keeps
+ * splitting it in half, pushing the upper half onto its own deque, until it is
+ * no larger than the grain. Owners pop from the back of their deque (most
+ * recently split, still in cache) while idle threads steal from the front of
+ * other deques (the largest remaining pieces). The thread that calls
+ * parallelFor works on its own deque until the whole range is done, so nested
+ * calls from inside a job are allowed.
+ */
+class JobSystem {
+public:
+    /**
+     * @brief Creates a job system.
+     *
+     * @param threadCount Total number of threads working on a parallelFor, including the caller.
+     */
+    explicit JobSystem(unsigned int threadCount) {
+        start(threadCount);
+    }
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    ~JobSystem() {
+        stop();
+    }
+
+    /**
+     * @brief Gets the process-wide job system used by the simulation.
+     */
+    static JobSystem& instance() {
+        static JobSystem system(getDefaultThreadCount());
+        return system;
+    }
+
+    /**
+     * @brief Gets the number of hardware threads.
+     */
+    static unsigned int getDefaultThreadCount() {
+        unsigned int count = std::thread::hardware_concurrency();
+        return count == 0 ? 1 : count;
+    }
+
+    /**
+     * @brief Restarts the pool with a different number of threads. Must not be called while jobs are running.
+     *
+     * @param count Total number of threads, including the caller; 0 selects the hardware thread count.
+     */
+    void setThreadCount(unsigned int count) {
+        if (count == 0) count = getDefaultThreadCount();
+        if (count == threadCount) return;
+        stop();
+        start(count);
+    }
+
+    unsigned int getThreadCount() const { return threadCount; }
+
+    /**
+     * @brief Gets the index of the calling thread's deque, in [0, threadCount); threads outside the pool share 0.
+     */
+    unsigned int getCurrentThread() const { return currentQueue(); }
+
+    /**
+     * @brief Runs body over [begin, end) split into pieces of at most grain indices, and waits for completion.
+     *
+     * @param begin First index.
+     * @param end One past the last index.
+     * @param grain Maximum number of indices per piece.
+     * @param body Callable invoked as body(pieceBegin, pieceEnd), possibly from several threads at once.
+     */
+    template <typename Body>
+    void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body&& body) {
+        if (end <= begin) return;
+        if (grain == 0) grain = 1;
+        if (threadCount == 1 || end - begin <= grain) {
+            body(begin, end);
+            return;
+        }
+
+        using BodyType = typename std::remove_reference<Body>::type;
+        std::atomic<std::size_t> remaining(end - begin);
+        Job job{};
+        job.run = [](void* context, std::size_t jobBegin, std::size_t jobEnd) {
+            (*static_cast<BodyType*>(context))(jobBegin, jobEnd);
+        };
+        job.context = const_cast<void*>(static_cast<const void*>(&body));
+        job.begin = begin;
+        job.end = end;
+        job.grain = grain;
+        job.remaining = &remaining;
+
+        const unsigned int self = currentQueue();
+        execute(job, self);
+
+        // Help with any outstanding pieces until the whole range is done
+        while (remaining.load(std::memory_order_acquire) != 0) {
+            if (!runOne(self)) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    /**
+     * @struct Job
+     * @brief A range of a parallelFor body waiting to be run.
+     */
+    struct Job {
+        void (*run)(void*, std::size_t, std::size_t); /* Type-erased body */
+        void* context;                                /* Body object */
+        std::size_t begin;                            /* First index */
+        std::size_t end;                              /* One past the last index */
+        std::size_t grain;                            /* Split ranges larger than this */
+        std::atomic<std::size_t>* remaining;          /* Indices of the parallelFor not yet run */
+    };
+
+    /**
+     * @struct WorkQueue
+     * @brief Deque owned by one thread and stolen from by the others.
+     *
+     * A ring buffer that only grows, so pushing and popping jobs stops
+     * allocating once it has reached the deepest split of the run.
+     */
+    struct WorkQueue {
+        std::mutex mutex;
+        std::vector<Job> ring = std::vector<Job>(64); /* Job slots, a power of two */
+        std::size_t head = 0;                         /* Slot of the front job */
+        std::size_t count = 0;                        /* Jobs in the queue */
+
+        void pushBack(const Job& job) {
+            if (count == ring.size()) {
+                std::vector<Job> grown(ring.size() * 2);
+                for (std::size_t i = 0; i < count; i++) grown[i] = ring[(head + i) & (ring.size() - 1)];
+                ring.swap(grown);
+                head = 0;
+            }
+            ring[(head + count) & (ring.size() - 1)] = job;
+            count++;
+        }
+
+        Job popBack() {
+            count--;
+            return ring[(head + count) & (ring.size() - 1)];
+        }
+
+        Job popFront() {
+            const Job job = ring[head];
+            head = (head + 1) & (ring.size() - 1);
+            count--;
+            return job;
+        }
+    };
+
+    /**
+     * @struct ThreadBinding
+     * @brief Identifies the job system and deque a worker thread belongs to.
+     */
+    struct ThreadBinding {
+        const JobSystem* system = nullptr;
+        unsigned int queue = 0;
+    };
+
+    static ThreadBinding& binding() {
+        static thread_local ThreadBinding threadBinding;
+        return threadBinding;
+    }
+
+    /**
+     * @brief Gets the deque of the calling thread; threads outside the pool share deque 0.
+     */
+    unsigned int currentQueue() const {
+        const ThreadBinding& threadBinding = binding();
+        return threadBinding.system == this ? threadBinding.queue : 0;
+    }
+
+    void start(unsigned int count) {
+        threadCount = count == 0 ? 1 : count;
+        running.store(true);
+        queues.clear();
+        for (unsigned int i = 0; i < threadCount; i++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        // Deque 0 belongs to whichever thread calls parallelFor
+        for (unsigned int i = 1; i < threadCount; i++) {
+            workers.emplace_back([this, i]() { workerLoop(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            running.store(false);
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+    }
+
+    void workerLoop(unsigned int index) {
+        binding() = { this, index };
+        while (running.load(std::memory_order_acquire)) {
+            if (runOne(index)) continue;
+
+            // Nothing to do: sleep until new jobs are pushed
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(1), [this]() {
+                return queuedJobs.load(std::memory_order_acquire) > 0 || !running.load(std::memory_order_acquire);
+            });
+        }
+    }
+
+    void push(unsigned int queue, const Job& job) {
+        {
+            std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+            queues[queue]->pushBack(job);
+        }
+        queuedJobs.fetch_add(1, std::memory_order_release);
+        wake.notify_one();
+    }
+
+    /**
+     * @brief Pops a job from the own deque, or steals one from another, and runs it.
+     *
+     * @return True if a job was run.
+     */
+    bool runOne(unsigned int self) {
+        Job job;
+        if (popBack(self, job)) {
+            execute(job, self);
+            return true;
+        }
+        for (unsigned int offset = 1; offset < threadCount; offset++) {
+            if (stealFront((self + offset) % threadCount, job)) {
+                execute(job, self);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool popBack(unsigned int queue, Job& job) {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        if (queues[queue]->count == 0) return false;
+        job = queues[queue]->popBack();
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool stealFront(unsigned int queue, Job& job) {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        if (queues[queue]->count == 0) return false;
+        job = queues[queue]->popFront();
+        queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Splits a job down to its grain, leaving the upper halves for others, then runs the rest.
+     */
+    void execute(Job job, unsigned int self) {
+        while (job.end - job.begin > job.grain) {
+            Job upper = job;
+            upper.begin = job.begin + (job.end - job.begin) / 2;
+            job.end = upper.begin;
+            push(self, upper);
+        }
+        job.run(job.context, job.begin, job.end);
+        job.remaining->fetch_sub(job.end - job.begin, std::memory_order_release);
+    }
+
+    unsigned int threadCount = 1;                   /* Threads working on a parallelFor, including the caller */
+    std::vector<std::unique_ptr<WorkQueue>> queues; /* One deque per thread */
+    std::vector<std::thread> workers;               /* Background threads, one per deque except deque 0 */
+    std::atomic<bool> running{ false };             /* Cleared to shut the workers down */
+    std::atomic<int> queuedJobs{ 0 };               /* Jobs waiting in any deque */
+    std::mutex sleepMutex;                          /* Guards sleeping workers */
+    std::condition_variable wake;                   /* Signalled when jobs are pushed */
+};
+
+#endif
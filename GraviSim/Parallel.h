@@ -0,0 +1,44 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <utility>
+#include "JobSystem.h"
+
+/**
+ * @brief Gets the number of threads the simulation's parallel loops run on.
+ */
+inline unsigned int getWorkerCount() {
+    return JobSystem::instance().getThreadCount();
+}
+
+/**
+ * @brief Sets the number of threads the simulation's parallel loops run on.
+ *
+ * @param count Number of threads including the caller; 0 selects the hardware thread count.
+ */
+inline void setWorkerCount(unsigned int count) {
+    JobSystem::instance().setThreadCount(count);
+}
+
+/**
+ * @brief Gets the index of the calling thread in the job system, 0 for threads outside it.
+ */
+inline unsigned int getWorkerIndex() {
+    return JobSystem::instance().getCurrentThread();
+}
+
+/**
+ * @brief Runs body over [begin, end) on the shared job system and waits for it.
+ *
+ * @param begin First index.
+ * @param end One past the last index.
+ * @param grain Maximum number of indices handed to body at once.
+ * @param body Callable invoked as body(chunkBegin, chunkEnd).
+ */
+template <typename Body>
+void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, Body&& body) {
+    JobSystem::instance().parallelFor(begin, end, grain, std::forward<Body>(body));
+}
+
+#endif
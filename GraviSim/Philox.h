@@ -0,0 +1,93 @@
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <cstdint>
+
+/**
+ * @class Philox4x32
+ * @brief Counter-based random number generator Philox4x32-10 (Salmon et al., "Parallel random numbers: as easy as 1, 2, 3").
+ *
+ * Each output block is a pure function of a 128-bit counter and a 64-bit
+ * key, so any stream can start anywhere without generating the numbers
+ * before it: giving every item its own counter makes the numbers an item
+ * draws independent of which thread draws them and in which order.
+ *
+ * The generator hands out the four words of a block one after another and
+ * moves to the next block by incrementing the third counter word; the first
+ * two words select the stream, the key is the seed.
+ */
+class Philox4x32 {
+public:
+    /**
+     * @brief Starts a stream.
+     *
+     * @param seed Key shared by all streams of one run.
+     * @param stream Index of the stream, e.g. of the item it is drawn for.
+     */
+    Philox4x32(uint64_t seed, uint64_t stream)
+        : key{ static_cast<uint32_t>(seed), static_cast<uint32_t>(seed >> 32) },
+          counter{ static_cast<uint32_t>(stream), static_cast<uint32_t>(stream >> 32), 0, 0 } {
+    }
+
+    /**
+     * @brief Gets the next 32 random bits of the stream.
+     */
+    uint32_t next() {
+        if (used == 4) {
+            generate(counter, key, block);
+            counter[2]++;
+            used = 0;
+        }
+        return block[used++];
+    }
+
+    /**
+     * @brief Gets a uniform float in [0, 1), with 24 random bits.
+     */
+    float uniform() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    /**
+     * @brief Gets a uniform float in [min, max).
+     */
+    float uniform(float min, float max) {
+        return min + (max - min) * uniform();
+    }
+
+    /**
+     * @brief Computes one output block: ten rounds of multiplications by the Philox constants.
+     *
+     * @param input Counter of the block.
+     * @param seedKey Key of the stream.
+     * @param output Receives the four random words.
+     */
+    static void generate(const uint32_t* input, const uint32_t* seedKey, uint32_t* output) {
+        uint32_t c0 = input[0], c1 = input[1], c2 = input[2], c3 = input[3];
+        uint32_t k0 = seedKey[0], k1 = seedKey[1];
+        for (int round = 0; round < 10; round++) {
+            const uint64_t product0 = static_cast<uint64_t>(0xD2511F53u) * c0;
+            const uint64_t product1 = static_cast<uint64_t>(0xCD9E8D57u) * c2;
+            const uint32_t next0 = static_cast<uint32_t>(product1 >> 32) ^ c1 ^ k0;
+            const uint32_t next2 = static_cast<uint32_t>(product0 >> 32) ^ c3 ^ k1;
+            c1 = static_cast<uint32_t>(product1);
+            c3 = static_cast<uint32_t>(product0);
+            c0 = next0;
+            c2 = next2;
+            k0 += 0x9E3779B9u;
+            k1 += 0xBB67AE85u;
+        }
+        output[0] = c0;
+        output[1] = c1;
+        output[2] = c2;
+        output[3] = c3;
+    }
+
+private:
+    uint32_t key[2];       /* The seed */
+    uint32_t counter[4];   /* Stream index, then the index of the next block */
+    uint32_t block[4];     /* Last generated block */
+    unsigned int used = 4; /* Words of the block already handed out */
+};
+
+#endif
@@ -0,0 +1,214 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "Shader.h"
+
+/**
+ * @class RenderQueue
+ * @brief Collects the draws of a frame, sorts them by state and issues them with as few state changes as possible.
+ *
+ * Every draw item records its program, VAO, line width and the uniform values
+ * it needs, so the queue is free to reorder items: flush sorts them by layer,
+ * program, VAO and line width, then issues glUseProgram, glBindVertexArray and
+ * glLineWidth only when the value actually changes. Items of equal state keep
+ * their submission order, and a higher layer is always drawn on top of a lower one.
+ */
+class RenderQueue {
+public:
+    /**
+     * @struct RenderStats
+     * @brief GL calls issued by one flush.
+     */
+    struct RenderStats {
+        unsigned int items = 0;            /* Draw items submitted */
+        unsigned int draws = 0;            /* Draw calls issued */
+        unsigned int programSwitches = 0;  /* glUseProgram calls */
+        unsigned int vaoBinds = 0;         /* glBindVertexArray calls */
+        unsigned int lineWidthChanges = 0; /* glLineWidth calls */
+        unsigned int uniformUploads = 0;   /* glUniform calls */
+    };
+
+    /**
+     * @brief Submits a draw of a shape.
+     *
+     * Uniforms and the line width set afterwards apply to this item.
+     *
+     * @param program: Shader program to draw with.
+     * @param VAO: Vertex array object of the shape.
+     * @param mode: OpenGL drawing mode.
+     * @param count: Number of vertices, or of indices if indexed.
+     * @param indexed: Whether the shape is drawn from its element buffer.
+     * @param instanceCount: Number of instances, 0 for a plain draw.
+     * @param layer: Draw order group, higher layers are drawn on top.
+     */
+    void submit(unsigned int program, unsigned int VAO, GLenum mode, unsigned int count, bool indexed,
+        unsigned int instanceCount = 0, unsigned int layer = 0) {
+        DrawItem item{};
+        item.program = program;
+        item.VAO = VAO;
+        item.mode = mode;
+        item.count = count;
+        item.indexed = indexed;
+        item.instanceCount = instanceCount;
+        item.layer = layer;
+        item.lineWidth = isLineMode(mode) ? 1.0f : 0.0f;
+        item.firstUniform = static_cast<unsigned int>(uniforms.size());
+        item.sequence = static_cast<unsigned int>(items.size());
+        items.push_back(item);
+    }
+
+    /**
+     * @brief Sets the line width of the last submitted item; ignored for non-line items.
+     */
+    void setLineWidth(float width) {
+        if (items.empty() || !isLineMode(items.back().mode)) return;
+        items.back().lineWidth = width;
+    }
+
+    /**
+     * @brief Sets a uniform of the last submitted item.
+     */
+    void setUniform(UniformHandle<float> uniform, float value) {
+        addUniform(uniform.location, 1, &value);
+    }
+
+    void setUniform(UniformHandle<glm::vec3> uniform, const glm::vec3& value) {
+        addUniform(uniform.location, 3, &value[0]);
+    }
+
+    /**
+     * @brief Sorts the submitted items by state, issues them and empties the queue.
+     *
+     * The GL state is not assumed to be known between flushes, so the first item
+     * always sets its program, VAO and line width. The VAO is unbound at the end.
+     */
+    void flush() {
+        stats = RenderStats();
+        stats.items = static_cast<unsigned int>(items.size());
+
+        for (DrawItem& item : items) item.key = makeKey(item);
+        std::sort(items.begin(), items.end(), [](const DrawItem& a, const DrawItem& b) {
+            return a.key != b.key ? a.key < b.key : a.sequence < b.sequence;
+        });
+
+        bool first = true;
+        unsigned int program = 0, VAO = 0;
+        float lineWidth = 0.0f;
+        for (const DrawItem& item : items) {
+            if (first || item.program != program) {
+                glUseProgram(item.program);
+                program = item.program;
+                stats.programSwitches++;
+            }
+            if (first || item.VAO != VAO) {
+                glBindVertexArray(item.VAO);
+                VAO = item.VAO;
+                stats.vaoBinds++;
+            }
+            // The line width only matters to line items, so fills never change it
+            if (item.lineWidth > 0.0f && item.lineWidth != lineWidth) {
+                glLineWidth(item.lineWidth);
+                lineWidth = item.lineWidth;
+                stats.lineWidthChanges++;
+            }
+            first = false;
+
+            for (unsigned int i = item.firstUniform; i < item.firstUniform + item.uniformCount; i++) {
+                const UniformValue& uniform = uniforms[i];
+                if (uniform.components == 1) glUniform1f(uniform.location, uniform.value[0]);
+                else glUniform3fv(uniform.location, 1, uniform.value);
+                stats.uniformUploads++;
+            }
+
+            if (item.instanceCount > 0) {
+                if (item.indexed) glDrawElementsInstanced(item.mode, item.count, GL_UNSIGNED_INT, 0, item.instanceCount);
+                else glDrawArraysInstanced(item.mode, 0, item.count, item.instanceCount);
+            }
+            else {
+                if (item.indexed) glDrawElements(item.mode, item.count, GL_UNSIGNED_INT, 0);
+                else glDrawArrays(item.mode, 0, item.count);
+            }
+            stats.draws++;
+        }
+        if (!items.empty()) {
+            glBindVertexArray(0); // Unbind VAO
+        }
+
+        items.clear();
+        uniforms.clear();
+    }
+
+    /**
+     * @brief Gets the calls issued by the last flush.
+     */
+    const RenderStats& getStats() const { return stats; }
+
+private:
+    /**
+     * @struct DrawItem
+     * @brief One draw call and the state it needs.
+     */
+    struct DrawItem {
+        uint64_t key;               /* Sort key built from the state at flush */
+        unsigned int sequence;      /* Submission order, keeps equal-state items stable */
+        unsigned int layer;         /* Draw order group */
+        unsigned int program;       /* Shader program */
+        unsigned int VAO;           /* Vertex array object */
+        GLenum mode;                /* OpenGL drawing mode */
+        unsigned int count;         /* Vertices or indices to draw */
+        bool indexed;               /* Draw from the element buffer */
+        unsigned int instanceCount; /* Instances to draw, 0 for a plain draw */
+        float lineWidth;            /* Line width, 0 for items that are not lines */
+        unsigned int firstUniform;  /* First uniform value of the item */
+        unsigned int uniformCount;  /* Number of uniform values of the item */
+    };
+
+    /**
+     * @struct UniformValue
+     * @brief A uniform value recorded for a draw item.
+     */
+    struct UniformValue {
+        int location;   /* Uniform location in the item's program */
+        int components; /* 1 for float, 3 for vec3 */
+        float value[3]; /* Components of the value */
+    };
+
+    static bool isLineMode(GLenum mode) {
+        return mode == GL_LINES || mode == GL_LINE_STRIP || mode == GL_LINE_LOOP;
+    }
+
+    /**
+     * @brief Packs layer, program, VAO and line width into a key, most significant first.
+     *
+     * GL names beyond 16 bits share key bits with others; that only costs some
+     * state changes, as flush compares the real values before skipping a call.
+     */
+    static uint64_t makeKey(const DrawItem& item) {
+        const uint64_t lineWidth = static_cast<uint64_t>(std::min(item.lineWidth * 16.0f, 65535.0f));
+        return (static_cast<uint64_t>(std::min(item.layer, 0xffffu)) << 48)
+            | (static_cast<uint64_t>(item.program & 0xffffu) << 32)
+            | (static_cast<uint64_t>(item.VAO & 0xffffu) << 16)
+            | lineWidth;
+    }
+
+    void addUniform(int location, int components, const float* value) {
+        if (items.empty()) return;
+        UniformValue uniform{};
+        uniform.location = location;
+        uniform.components = components;
+        for (int i = 0; i < components; i++) uniform.value[i] = value[i];
+        uniforms.push_back(uniform);
+        items.back().uniformCount++;
+    }
+
+    std::vector<DrawItem> items;        /* Items submitted since the last flush */
+    std::vector<UniformValue> uniforms; /* Uniform values of the submitted items */
+    RenderStats stats;                  /* Calls issued by the last flush */
+};
+
+#endif
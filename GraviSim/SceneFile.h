@@ -0,0 +1,501 @@
+#ifndef SCENE_FILE_H
+#define SCENE_FILE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "BallSystem.h"
+#include "Checksum.h"
+#include "Parallel.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------------------------
+// SCENE FILE FORMAT (version 1, little-endian)
+//
+//   SceneFileHeader    64 bytes
+//   SceneFileSection   32 bytes per section
+//   section data       one BallSystem column per
+//                      section, each starting on a
+//                      64-byte boundary
+//
+// The columns are stored exactly as BallSystem
+// holds them in memory, so a mapped file is used
+// in place and a load is a plain copy. Every
+// section carries the CRC-32 of its data and the
+// header the CRC-32 of itself and the section
+// table; the header also records the file size,
+// so a truncated file is rejected on open.
+// -----------------------------------------------
+
+/**
+ * @brief Identifies the BallSystem column stored in a section.
+ */
+enum class SceneSection : uint32_t {
+    PositionX = 0,
+    PositionY = 1,
+    VelocityX = 2,
+    VelocityY = 3,
+    Radius = 4,
+    ColorR = 5,
+    ColorG = 6,
+    ColorB = 7,
+    Sleeping = 8,
+    SleepTimer = 9,
+    IslandNext = 10,
+    Count = 11
+};
+
+/**
+ * @struct SceneFileHeader
+ * @brief Fixed-size start of a scene file.
+ */
+struct SceneFileHeader {
+    char magic[8];           /* "GRVSCENE" */
+    uint32_t version;        /* Format version, sceneFileVersion */
+    uint32_t headerSize;     /* Bytes of this header plus the section table */
+    uint64_t fileSize;       /* Bytes of the whole file */
+    uint64_t ballCount;      /* Balls in every section */
+    uint32_t sectionCount;   /* Entries in the section table */
+    uint32_t headerCrc;      /* CRC-32 of header and section table, computed with this field zero */
+    float gravity;           /* BallSystem::Material::gravity */
+    float damping;           /* BallSystem::Material::damping */
+    float velocityThreshold; /* BallSystem::Material::velocityThreshold */
+    int32_t segments;        /* BallSystem::Material::segments */
+    uint8_t reserved[8];     /* Zero */
+};
+
+/**
+ * @struct SceneFileSection
+ * @brief Section table entry locating one column in a scene file.
+ */
+struct SceneFileSection {
+    uint32_t id;          /* SceneSection stored in the section */
+    uint32_t elementSize; /* Bytes per ball */
+    uint64_t offset;      /* Start of the data from the start of the file, a multiple of sceneSectionAlignment */
+    uint64_t size;        /* Bytes of data, ballCount * elementSize */
+    uint32_t crc;         /* CRC-32 of the data */
+    uint32_t reserved;    /* Zero */
+};
+
+static_assert(sizeof(SceneFileHeader) == 64, "SceneFileHeader must match the file layout");
+static_assert(sizeof(SceneFileSection) == 32, "SceneFileSection must match the file layout");
+
+constexpr uint32_t sceneFileVersion = 1;       /* Version written by saveScene */
+constexpr uint64_t sceneSectionAlignment = 64; /* Alignment of section data, matches AlignedArray */
+
+/**
+ * @struct SceneColumn
+ * @brief One BallSystem column as stored in a section.
+ */
+struct SceneColumn {
+    SceneSection id;      /* Section of the column */
+    uint32_t elementSize; /* Bytes per ball */
+    void* data;           /* First element of the column */
+};
+
+/**
+ * @brief Lists the columns of a ball system in section order.
+ *
+ * @param balls System whose columns are listed.
+ * @param columns Receives SceneSection::Count columns.
+ */
+inline void getSceneColumns(BallSystem& balls, SceneColumn* columns) {
+    columns[0] = { SceneSection::PositionX, sizeof(float), balls.x.data() };
+    columns[1] = { SceneSection::PositionY, sizeof(float), balls.y.data() };
+    columns[2] = { SceneSection::VelocityX, sizeof(float), balls.vx.data() };
+    columns[3] = { SceneSection::VelocityY, sizeof(float), balls.vy.data() };
+    columns[4] = { SceneSection::Radius, sizeof(float), balls.radius.data() };
+    columns[5] = { SceneSection::ColorR, sizeof(float), balls.colorR.data() };
+    columns[6] = { SceneSection::ColorG, sizeof(float), balls.colorG.data() };
+    columns[7] = { SceneSection::ColorB, sizeof(float), balls.colorB.data() };
+    columns[8] = { SceneSection::Sleeping, sizeof(uint8_t), balls.sleeping.data() };
+    columns[9] = { SceneSection::SleepTimer, sizeof(float), balls.sleepTimer.data() };
+    columns[10] = { SceneSection::IslandNext, sizeof(uint32_t), balls.islandNext.data() };
+}
+
+/**
+ * @brief Checks that the host stores integers and floats little-endian, as the format does.
+ */
+inline bool isLittleEndianHost() {
+    const uint32_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+/**
+ * @brief Computes the CRC-32 of a header and its section table, with the header's CRC field taken as zero.
+ */
+inline uint32_t computeSceneHeaderCrc(const SceneFileHeader& header, const SceneFileSection* sections) {
+    SceneFileHeader copy = header;
+    copy.headerCrc = 0;
+    uint32_t crc = updateCrc32(0, &copy, sizeof(copy));
+    return updateCrc32(crc, sections, sizeof(SceneFileSection) * header.sectionCount);
+}
+
+/**
+ * @brief Computes the CRC-32 of many buffers at once, one buffer per job.
+ *
+ * @param buffers Start of each buffer.
+ * @param sizes Bytes of each buffer.
+ * @param crcs Receives the CRC-32 of each buffer.
+ * @param count Number of buffers.
+ */
+inline void computeCrcs(const void* const* buffers, const uint64_t* sizes, uint32_t* crcs, std::size_t count) {
+    parallelFor(0, count, 1, [buffers, sizes, crcs](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            crcs[i] = updateCrc32(0, buffers[i], static_cast<std::size_t>(sizes[i]));
+        }
+    });
+}
+
+/**
+ * @brief Writes a ball system to a scene file in one call.
+ *
+ * @param balls System to write.
+ * @param path File to create or overwrite.
+ * @return False if the file could not be written.
+ */
+inline bool saveScene(const BallSystem& balls, const std::string& path) {
+    if (!isLittleEndianHost()) {
+        std::cerr << "ERROR::SCENE_FILE::BIG_ENDIAN_HOST" << std::endl;
+        return false;
+    }
+
+    const std::size_t sectionCount = static_cast<std::size_t>(SceneSection::Count);
+    SceneColumn columns[sectionCount];
+    getSceneColumns(const_cast<BallSystem&>(balls), columns);
+
+    // Lay the sections out back to back on aligned offsets
+    SceneFileHeader header{};
+    SceneFileSection sections[sectionCount] = {};
+    std::memcpy(header.magic, "GRVSCENE", 8);
+    header.version = sceneFileVersion;
+    header.headerSize = static_cast<uint32_t>(sizeof(SceneFileHeader) + sizeof(sections));
+    header.ballCount = balls.size();
+    header.sectionCount = static_cast<uint32_t>(sectionCount);
+    header.gravity = balls.material.gravity;
+    header.damping = balls.material.damping;
+    header.velocityThreshold = balls.material.velocityThreshold;
+    header.segments = balls.material.segments;
+
+    const void* buffers[sectionCount];
+    uint64_t sizes[sectionCount];
+    uint32_t crcs[sectionCount];
+    uint64_t offset = header.headerSize;
+    for (std::size_t i = 0; i < sectionCount; i++) {
+        offset = (offset + sceneSectionAlignment - 1) / sceneSectionAlignment * sceneSectionAlignment;
+        sections[i].id = static_cast<uint32_t>(columns[i].id);
+        sections[i].elementSize = columns[i].elementSize;
+        sections[i].offset = offset;
+        sections[i].size = header.ballCount * columns[i].elementSize;
+        buffers[i] = columns[i].data;
+        sizes[i] = sections[i].size;
+        offset += sections[i].size;
+    }
+    header.fileSize = offset;
+
+    computeCrcs(buffers, sizes, crcs, sectionCount);
+    for (std::size_t i = 0; i < sectionCount; i++) {
+        sections[i].crc = crcs[i];
+    }
+    header.headerCrc = computeSceneHeaderCrc(header, sections);
+
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "ERROR::SCENE_FILE::OPEN_FAILED " << path << std::endl;
+        return false;
+    }
+    static const uint8_t padding[sceneSectionAlignment] = {};
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1
+        && std::fwrite(sections, sizeof(sections), 1, file) == 1;
+    uint64_t written = header.headerSize;
+    for (std::size_t i = 0; i < sectionCount && ok; i++) {
+        const std::size_t gap = static_cast<std::size_t>(sections[i].offset - written);
+        ok = (gap == 0 || std::fwrite(padding, 1, gap, file) == gap)
+            && (sizes[i] == 0 || std::fwrite(buffers[i], 1, static_cast<std::size_t>(sizes[i]), file) == sizes[i]);
+        written = sections[i].offset + sections[i].size;
+    }
+    ok = std::fclose(file) == 0 && ok;
+    if (!ok) {
+        std::cerr << "ERROR::SCENE_FILE::WRITE_FAILED " << path << std::endl;
+    }
+    return ok;
+}
+
+/**
+ * @class MappedScene
+ * @brief Read-only memory mapping of a scene file whose columns are used in place.
+ *
+ * open maps the file and validates the header and section table, which takes
+ * the same time for any ball count; the data is paged in on first access.
+ * verify checks the section CRCs, and copyTo restores a BallSystem from the
+ * mapping with one copy per column.
+ */
+class MappedScene {
+public:
+    MappedScene() = default;
+    MappedScene(const MappedScene&) = delete;
+    MappedScene& operator=(const MappedScene&) = delete;
+
+    ~MappedScene() {
+        close();
+    }
+
+    /**
+     * @brief Maps a scene file and validates its header and section table.
+     *
+     * @param path File to map.
+     * @return False if the file cannot be mapped or is not a valid scene file.
+     */
+    bool open(const std::string& path) {
+        close();
+        if (!isLittleEndianHost()) {
+            std::cerr << "ERROR::SCENE_FILE::BIG_ENDIAN_HOST" << std::endl;
+            return false;
+        }
+        if (!map(path)) {
+            std::cerr << "ERROR::SCENE_FILE::MAP_FAILED " << path << std::endl;
+            close();
+            return false;
+        }
+        if (!validate()) {
+            std::cerr << "ERROR::SCENE_FILE::INVALID " << path << std::endl;
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Unmaps the file.
+     */
+    void close() {
+#ifdef _WIN32
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (view) munmap(const_cast<uint8_t*>(view), mappedSize);
+#endif
+        view = nullptr;
+        mappedSize = 0;
+        header = nullptr;
+        sections = nullptr;
+    }
+
+    bool isOpen() const { return header != nullptr; }
+    std::size_t size() const { return header ? static_cast<std::size_t>(header->ballCount) : 0; }
+    uint64_t getFileSize() const { return mappedSize; }
+
+    /**
+     * @brief Gets the shared parameters stored in the header.
+     */
+    BallSystem::Material getMaterial() const {
+        BallSystem::Material material;
+        material.gravity = header->gravity;
+        material.damping = header->damping;
+        material.velocityThreshold = header->velocityThreshold;
+        material.segments = header->segments;
+        return material;
+    }
+
+    /**
+     * @brief Gets the mapped data of a section, aligned to sceneSectionAlignment.
+     *
+     * @param id Section to get.
+     * @return First element of the column, or nullptr if the section is missing.
+     */
+    const void* getSection(SceneSection id) const {
+        const SceneFileSection* section = findSection(id);
+        return section ? view + section->offset : nullptr;
+    }
+
+    const float* getX() const { return static_cast<const float*>(getSection(SceneSection::PositionX)); }
+    const float* getY() const { return static_cast<const float*>(getSection(SceneSection::PositionY)); }
+    const float* getVx() const { return static_cast<const float*>(getSection(SceneSection::VelocityX)); }
+    const float* getVy() const { return static_cast<const float*>(getSection(SceneSection::VelocityY)); }
+    const float* getRadius() const { return static_cast<const float*>(getSection(SceneSection::Radius)); }
+
+    /**
+     * @brief Checks the CRC-32 of every section, one section per job.
+     *
+     * @return False if any section's data does not match its CRC.
+     */
+    bool verify() const {
+        const std::size_t sectionCount = header->sectionCount;
+        std::vector<const void*> buffers(sectionCount);
+        std::vector<uint64_t> sizes(sectionCount);
+        std::vector<uint32_t> crcs(sectionCount);
+        for (std::size_t i = 0; i < sectionCount; i++) {
+            buffers[i] = view + sections[i].offset;
+            sizes[i] = sections[i].size;
+        }
+        computeCrcs(buffers.data(), sizes.data(), crcs.data(), sectionCount);
+        for (std::size_t i = 0; i < sectionCount; i++) {
+            if (crcs[i] != sections[i].crc) {
+                std::cerr << "ERROR::SCENE_FILE::CHECKSUM_MISMATCH section " << sections[i].id << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Replaces the balls and material of a system with the mapped scene, one column per job.
+     *
+     * @param balls System to restore into.
+     */
+    void copyTo(BallSystem& balls) const {
+        balls.material = getMaterial();
+        parallelFor(0, static_cast<std::size_t>(SceneSection::Count), 1, [this, &balls](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                switch (static_cast<SceneSection>(i)) {
+                case SceneSection::PositionX: copyColumn(balls.x, SceneSection::PositionX); break;
+                case SceneSection::PositionY: copyColumn(balls.y, SceneSection::PositionY); break;
+                case SceneSection::VelocityX: copyColumn(balls.vx, SceneSection::VelocityX); break;
+                case SceneSection::VelocityY: copyColumn(balls.vy, SceneSection::VelocityY); break;
+                case SceneSection::Radius: copyColumn(balls.radius, SceneSection::Radius); break;
+                case SceneSection::ColorR: copyColumn(balls.colorR, SceneSection::ColorR); break;
+                case SceneSection::ColorG: copyColumn(balls.colorG, SceneSection::ColorG); break;
+                case SceneSection::ColorB: copyColumn(balls.colorB, SceneSection::ColorB); break;
+                case SceneSection::Sleeping: copyColumn(balls.sleeping, SceneSection::Sleeping); break;
+                case SceneSection::SleepTimer: copyColumn(balls.sleepTimer, SceneSection::SleepTimer); break;
+                case SceneSection::IslandNext: copyColumn(balls.islandNext, SceneSection::IslandNext); break;
+                default: break;
+                }
+            }
+        });
+    }
+
+private:
+    /**
+     * @brief Maps the whole file read-only.
+     */
+    bool map(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) return false;
+        mappedSize = static_cast<std::size_t>(fileSize.QuadPart);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) return false;
+        view = static_cast<const uint8_t*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        return view != nullptr;
+#else
+        const int descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) return false;
+        struct stat status;
+        if (fstat(descriptor, &status) != 0 || status.st_size == 0) {
+            ::close(descriptor);
+            return false;
+        }
+        mappedSize = static_cast<std::size_t>(status.st_size);
+        void* address = mmap(nullptr, mappedSize, PROT_READ, MAP_SHARED, descriptor, 0);
+        ::close(descriptor);
+        if (address == MAP_FAILED) {
+            mappedSize = 0;
+            return false;
+        }
+        view = static_cast<const uint8_t*>(address);
+        return true;
+#endif
+    }
+
+    /**
+     * @brief Checks the header, the section table and that every section lies inside the file.
+     */
+    bool validate() {
+        if (mappedSize < sizeof(SceneFileHeader)) return false;
+        const SceneFileHeader* candidate = reinterpret_cast<const SceneFileHeader*>(view);
+        if (std::memcmp(candidate->magic, "GRVSCENE", 8) != 0 || candidate->version != sceneFileVersion) return false;
+        // A file cut short, or with garbage appended, no longer matches the recorded size
+        if (candidate->fileSize != mappedSize) return false;
+        if (candidate->headerSize != sizeof(SceneFileHeader) + sizeof(SceneFileSection) * uint64_t(candidate->sectionCount)
+            || candidate->headerSize > mappedSize) return false;
+        const SceneFileSection* table = reinterpret_cast<const SceneFileSection*>(view + sizeof(SceneFileHeader));
+        if (computeSceneHeaderCrc(*candidate, table) != candidate->headerCrc) return false;
+
+        // Bounding the ball count by the data bytes first keeps ballCount * elementSize from overflowing
+        const uint64_t dataSize = mappedSize - candidate->headerSize;
+        for (uint32_t i = 0; i < candidate->sectionCount; i++) {
+            const SceneFileSection& section = table[i];
+            if (section.offset % sceneSectionAlignment != 0 || section.offset < candidate->headerSize
+                || (section.elementSize != 0 && candidate->ballCount > dataSize / section.elementSize)
+                || section.size != candidate->ballCount * section.elementSize
+                || section.size > mappedSize || section.offset > mappedSize - section.size) return false;
+        }
+        header = candidate;
+        sections = table;
+
+        // Every column of a BallSystem must be present with its element size
+        BallSystem probe;
+        SceneColumn columns[static_cast<std::size_t>(SceneSection::Count)];
+        getSceneColumns(probe, columns);
+        for (const SceneColumn& column : columns) {
+            const SceneFileSection* section = findSection(column.id);
+            if (!section || section->elementSize != column.elementSize) {
+                header = nullptr;
+                sections = nullptr;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    void copyColumn(AlignedArray<T>& column, SceneSection id) const {
+        column.assign(static_cast<const T*>(getSection(id)), size());
+    }
+
+    const SceneFileSection* findSection(SceneSection id) const {
+        for (uint32_t i = 0; i < header->sectionCount; i++) {
+            if (sections[i].id == static_cast<uint32_t>(id)) return &sections[i];
+        }
+        return nullptr;
+    }
+
+    const uint8_t* view = nullptr;              /* Start of the mapped file */
+    std::size_t mappedSize = 0;                 /* Bytes mapped */
+    const SceneFileHeader* header = nullptr;    /* Validated header, nullptr while closed */
+    const SceneFileSection* sections = nullptr; /* Validated section table */
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;         /* Open file */
+    HANDLE mapping = nullptr;                   /* File mapping object */
+#endif
+};
+
+/**
+ * @brief Restores a ball system from a scene file.
+ *
+ * @param path File to read.
+ * @param balls System to restore into; unchanged on failure.
+ * @param verifyChecksums Whether to check the section CRCs before restoring.
+ * @return False if the file is missing, truncated, corrupt or not a scene file.
+ */
+inline bool loadScene(const std::string& path, BallSystem& balls, bool verifyChecksums = true) {
+    MappedScene scene;
+    if (!scene.open(path)) return false;
+    if (verifyChecksums && !scene.verify()) return false;
+    scene.copyTo(balls);
+    return true;
+}
+
+#endif
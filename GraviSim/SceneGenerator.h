@@ -0,0 +1,175 @@
+#ifndef SCENE_GENERATOR_H
+#define SCENE_GENERATOR_H
+
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "BallSystem.h"
+#include "Parallel.h"
+#include "Philox.h"
+
+/**
+ * @brief How the balls of a generated scene are placed.
+ */
+enum class SceneDistribution {
+    Box,     /* Uniform in a square */
+    Disc,    /* Uniform in a circle */
+    Plummer, /* Plummer sphere projected onto the plane, with velocities of its equilibrium */
+    Lattice  /* Square grid, one ball per cell */
+};
+
+/**
+ * @struct SceneSettings
+ * @brief Describes a generated scene.
+ */
+struct SceneSettings {
+    SceneDistribution distribution = SceneDistribution::Box; /* Placement of the balls */
+    std::size_t ballCount = 10000;                           /* Number of balls */
+    float minRadius = 0.002f;                                /* Smallest ball radius */
+    float maxRadius = 0.005f;                                /* Largest ball radius */
+    float extent = 1.0f;                                     /* Half size of the box or grid, radius of the disc or of the Plummer cutoff */
+    float speed = 0.5f;                                      /* Largest velocity component; velocity scale of the Plummer sphere */
+    uint64_t seed = 1;                                       /* Same seed, same scene, whatever the thread count */
+};
+
+inline const char* getSceneDistributionName(SceneDistribution distribution) {
+    switch (distribution) {
+    case SceneDistribution::Box: return "box";
+    case SceneDistribution::Disc: return "disc";
+    case SceneDistribution::Plummer: return "plummer";
+    case SceneDistribution::Lattice: return "lattice";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief Looks up a distribution by the name getSceneDistributionName gives it.
+ *
+ * @return False if the name is unknown.
+ */
+inline bool parseSceneDistribution(const std::string& name, SceneDistribution& distribution) {
+    const SceneDistribution distributions[] = { SceneDistribution::Box, SceneDistribution::Disc, SceneDistribution::Plummer, SceneDistribution::Lattice };
+    for (SceneDistribution candidate : distributions) {
+        if (name == getSceneDistributionName(candidate)) {
+            distribution = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Draws a point uniformly from the unit sphere's surface and projects it onto the plane.
+ */
+inline glm::vec2 drawProjectedDirection(Philox4x32& rng) {
+    const float z = rng.uniform(-1.0f, 1.0f);
+    const float angle = rng.uniform() * 2.0f * glm::pi<float>();
+    const float planar = std::sqrt(std::max(1.0f - z * z, 0.0f));
+    return glm::vec2(planar * std::cos(angle), planar * std::sin(angle));
+}
+
+/**
+ * @brief Draws a position and velocity from a Plummer sphere (Aarseth, Henon and Wielen 1974), projected onto the plane.
+ *
+ * Radii beyond the cutoff are drawn again. Velocities are drawn from the
+ * distribution function by rejection, in units where the gravitational
+ * constant, the total mass and the scale radius are 1, then scaled by speed.
+ *
+ * @param rng Stream of the ball.
+ * @param scaleRadius Plummer radius a.
+ * @param cutoff Largest distance from the center.
+ * @param speed Velocity scale.
+ * @param position Receives the position.
+ * @param velocity Receives the velocity.
+ */
+inline void drawPlummer(Philox4x32& rng, float scaleRadius, float cutoff, float speed, glm::vec2& position, glm::vec2& velocity) {
+    // A ball as large as the cutoff can only sit at the center
+    float r = 0.0f;
+    while (cutoff > 0.0f) {
+        // Inverting the cumulative mass M(r) = r^3 / (1 + r^2)^(3/2); zero would put the ball at infinity
+        const float mass = std::max(rng.uniform(), 1e-7f);
+        r = 1.0f / std::sqrt(std::pow(mass, -2.0f / 3.0f) - 1.0f);
+        if (r * scaleRadius <= cutoff) break;
+    }
+    position = drawProjectedDirection(rng) * (r * scaleRadius);
+
+    // Speed as a fraction q of the local escape speed, with density q^2 (1 - q^2)^(7/2), at most 0.1
+    float q = 0.0f;
+    float density = 0.0f;
+    do {
+        q = rng.uniform();
+        density = q * q * std::pow(1.0f - q * q, 3.5f);
+    } while (rng.uniform() * 0.1f >= density);
+    const float escapeSpeed = std::sqrt(2.0f) * std::pow(1.0f + r * r, -0.25f);
+    velocity = drawProjectedDirection(rng) * (q * escapeSpeed * speed);
+}
+
+/**
+ * @brief Fills a system with generated balls, in parallel.
+ *
+ * Every ball draws from its own Philox stream, keyed by the seed and counted
+ * by the ball's index, so a ball's position, velocity, radius and color do
+ * not depend on which worker generates it: the scene is the same for any
+ * thread count. The columns are written once, by the worker that generates
+ * the ball, without being initialized first.
+ *
+ * @param balls System to fill; existing balls are removed.
+ * @param settings Distribution, size and seed of the scene.
+ */
+inline void generateScene(BallSystem& balls, const SceneSettings& settings) {
+    const std::size_t count = settings.ballCount;
+    balls.resizeForOverwrite(count);
+
+    const float extent = std::min(std::max(settings.extent, 0.0f), 1.0f);
+    const std::size_t side = std::max<std::size_t>(1, static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(count)))));
+    const float spacing = 2.0f * extent / side;
+
+    parallelFor(0, count, 16384, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; i++) {
+            Philox4x32 rng(settings.seed, i);
+            float r = rng.uniform(settings.minRadius, settings.maxRadius);
+            glm::vec2 position(0.0f);
+            glm::vec2 velocity(rng.uniform(-settings.speed, settings.speed), rng.uniform(-settings.speed, settings.speed));
+
+            switch (settings.distribution) {
+            case SceneDistribution::Box: {
+                const float half = std::max(extent - r, 0.0f);
+                position = glm::vec2(rng.uniform(-half, half), rng.uniform(-half, half));
+                break;
+            }
+            case SceneDistribution::Disc: {
+                const float distance = std::max(extent - r, 0.0f) * std::sqrt(rng.uniform());
+                const float angle = rng.uniform() * 2.0f * glm::pi<float>();
+                position = glm::vec2(distance * std::cos(angle), distance * std::sin(angle));
+                break;
+            }
+            case SceneDistribution::Plummer:
+                // With the scale radius a fifth of the cutoff, the cutoff keeps about 94% of the sphere's mass
+                drawPlummer(rng, 0.2f * extent, std::max(extent - r, 0.0f), settings.speed, position, velocity);
+                break;
+            case SceneDistribution::Lattice:
+                // Balls never overlap their neighbors
+                r = std::min(r, 0.5f * spacing);
+                position = glm::vec2(-extent + (i % side + 0.5f) * spacing, -extent + (i / side + 0.5f) * spacing);
+                break;
+            }
+
+            balls.x[i] = position.x;
+            balls.y[i] = position.y;
+            balls.vx[i] = velocity.x;
+            balls.vy[i] = velocity.y;
+            balls.radius[i] = r;
+            balls.colorR[i] = rng.uniform();
+            balls.colorG[i] = rng.uniform();
+            balls.colorB[i] = rng.uniform();
+            balls.sleeping[i] = 0;
+            balls.sleepTimer[i] = 0.0f;
+            balls.islandNext[i] = static_cast<uint32_t>(i);
+        }
+    });
+}
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef SCENE_RENDERER_H
+#define SCENE_RENDERER_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "RenderQueue.h"
+#include "Shader.h"
+#include "ShapeManager.h"
+#include "SimulationThread.h"
+
+/**
+ * @class SceneRenderer
+ * @brief Draws the balls and their direction lines of a simulation snapshot into the current framebuffer.
+ *
+ * A frame is drawn in three steps: upload streams the snapshot's per-ball data
+ * into the instance buffer, submit queues the draws and flush issues them. Other
+ * draws, such as the pull line of the window, can be added to getQueue() between
+ * submit and flush; those that must cover the scene go on overlayLayer. The
+ * queue orders draws within a layer by GL state, so anything drawn on top of
+ * something else needs a higher layer. The shaders are loaded relative to the
+ * working directory.
+ */
+class SceneRenderer {
+public:
+    static constexpr unsigned int ballLayer = 0;      /* Circles */
+    static constexpr unsigned int directionLayer = 1; /* Direction lines, drawn over the circles */
+    static constexpr unsigned int overlayLayer = 2;   /* Draws added by the caller, drawn over the whole scene */
+
+    bool instanced = true;      /* Draw all circles with one instanced call instead of one call per ball */
+    bool impostors = true;      /* Quad impostors instead of triangle fans */
+    float velocityScale = 0.1f; /* Direction lines show the distance covered in this many seconds */
+
+    /**
+     * @brief Loads the shaders and creates the meshes and the instance buffer. Requires a current GL context.
+     *
+     * @param segments Number of segments of the triangle fan circles.
+     * @param ballCount Number of balls to size the instance buffer for; it grows if needed.
+     */
+    SceneRenderer(int segments, std::size_t ballCount)
+        : circleShader("vertexShader.vert", "fragmentShader.frag"),
+          impostorShader("vertexShaderImpostor.vert", "fragmentShaderImpostor.frag"),
+          instancedShader("vertexShaderInstanced.vert", "fragmentShaderInstanced.frag"),
+          instancedImpostorShader("vertexShaderImpostorInstanced.vert", "fragmentShaderImpostor.frag"),
+          directionShader("vertexShaderDirection.vert", "fragmentShaderInstanced.frag") {
+        // Resolve the per-ball uniforms once instead of by name for every ball
+        positionUniform = circleShader.getUniform<glm::vec3>("position");
+        radiusUniform = circleShader.getUniform<float>("radius");
+        colorUniform = circleShader.getUniform<glm::vec3>("color");
+        impostorPositionUniform = impostorShader.getUniform<glm::vec3>("position");
+        impostorRadiusUniform = impostorShader.getUniform<float>("radius");
+        impostorColorUniform = impostorShader.getUniform<glm::vec3>("color");
+        velocityScaleUniform = directionShader.getUniform<float>("velocityScale");
+
+        // Impostor edges are blended with the background
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // Unit line along +x, turned along and scaled by the ball velocity in the shader
+        const float directionLineVertices[] = { 0.0f, 0.0f, 1.0f, 0.0f };
+        directionLineIndex = shapes.createShape(directionLineVertices, sizeof(directionLineVertices));
+        shapes.addAttribute(directionLineIndex, 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+
+        // One unit circle per segment count, shared by every ball and scaled by the radius in the shader
+        circleIndex = shapes.getCircleMesh(segments);
+        // One unit quad per ball for impostor circles: 4 vertices instead of segments + 2
+        quadIndex = shapes.getQuadMesh();
+
+        // Per-instance data: position (2 floats), radius (1 float), color (3 floats), velocity (2 floats)
+        // Rewritten every frame, so it streams through a ring instead of reallocating
+        instanceBufferIndex = shapes.createStreamingBuffer(static_cast<unsigned int>(ballCount * instanceStride));
+        shapes.addInstanceAttribute(circleIndex, instanceBufferIndex, 1, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)0);
+        shapes.addInstanceAttribute(circleIndex, instanceBufferIndex, 2, 1, GL_FLOAT, GL_FALSE, instanceStride, (void*)(2 * sizeof(float)));
+        shapes.addInstanceAttribute(circleIndex, instanceBufferIndex, 3, 3, GL_FLOAT, GL_FALSE, instanceStride, (void*)(3 * sizeof(float)));
+        shapes.addInstanceAttribute(quadIndex, instanceBufferIndex, 1, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)0);
+        shapes.addInstanceAttribute(quadIndex, instanceBufferIndex, 2, 1, GL_FLOAT, GL_FALSE, instanceStride, (void*)(2 * sizeof(float)));
+        shapes.addInstanceAttribute(quadIndex, instanceBufferIndex, 3, 3, GL_FLOAT, GL_FALSE, instanceStride, (void*)(3 * sizeof(float)));
+        shapes.addInstanceAttribute(directionLineIndex, instanceBufferIndex, 1, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)0);
+        shapes.addInstanceAttribute(directionLineIndex, instanceBufferIndex, 4, 2, GL_FLOAT, GL_FALSE, instanceStride, (void*)(6 * sizeof(float)));
+    }
+
+    /**
+     * @brief Streams the per-ball data of a snapshot into the instance buffer.
+     *
+     * @param snapshot State to draw.
+     */
+    void upload(const SimulationSnapshot& snapshot) {
+        ballCount = snapshot.size();
+        instanceData.resize(ballCount * instanceFloats);
+        for (std::size_t i = 0; i < ballCount; i++) {
+            float* instance = &instanceData[i * instanceFloats];
+            instance[0] = snapshot.x[i];
+            instance[1] = snapshot.y[i];
+            instance[2] = snapshot.radius[i];
+            instance[3] = snapshot.colorR[i];
+            instance[4] = snapshot.colorG[i];
+            instance[5] = snapshot.colorB[i];
+            instance[6] = snapshot.vx[i];
+            instance[7] = snapshot.vy[i];
+        }
+        shapes.updateInstanceBuffer(instanceBufferIndex, instanceData.data(), static_cast<unsigned int>(instanceData.size() * sizeof(float)));
+    }
+
+    /**
+     * @brief Queues the circles and direction lines of the snapshot passed to the last upload.
+     *
+     * @param snapshot The snapshot passed to upload; read for the per-ball draws.
+     */
+    void submit(const SimulationSnapshot& snapshot) {
+        if (ballCount == 0) return;
+
+        if (instanced) {
+            // Draw all circles with one call
+            if (impostors) {
+                shapes.submitShapeInstanced(queue, instancedImpostorShader.ID, quadIndex, sizeof(float) * 2, static_cast<unsigned int>(ballCount), GL_TRIANGLE_STRIP, ballLayer);
+            }
+            else {
+                shapes.submitShapeInstanced(queue, instancedShader.ID, circleIndex, sizeof(float) * 3, static_cast<unsigned int>(ballCount), GL_TRIANGLE_FAN, ballLayer);
+            }
+        }
+        else {
+            for (std::size_t i = 0; i < ballCount; i++) {
+                const glm::vec3 position(snapshot.x[i], snapshot.y[i], 0.0f);
+                const glm::vec3 color(snapshot.colorR[i], snapshot.colorG[i], snapshot.colorB[i]);
+                if (impostors) {
+                    shapes.submitShape(queue, impostorShader.ID, quadIndex, sizeof(float) * 2, GL_TRIANGLE_STRIP, ballLayer);
+                    queue.setUniform(impostorPositionUniform, position);
+                    queue.setUniform(impostorRadiusUniform, snapshot.radius[i]);
+                    queue.setUniform(impostorColorUniform, color);
+                }
+                else {
+                    shapes.submitShape(queue, circleShader.ID, circleIndex, sizeof(float) * 3, GL_TRIANGLE_FAN, ballLayer);
+                    queue.setUniform(positionUniform, position);
+                    queue.setUniform(radiusUniform, snapshot.radius[i]);
+                    queue.setUniform(colorUniform, color);
+                }
+            }
+        }
+
+        // Draw every direction line with one call, on its own layer so it stays above the circles
+        shapes.submitShapeInstanced(queue, directionShader.ID, directionLineIndex, sizeof(float) * 2, static_cast<unsigned int>(ballCount), GL_LINES, directionLayer);
+        queue.setUniform(velocityScaleUniform, velocityScale);
+        queue.setLineWidth(2.0f);
+    }
+
+    /**
+     * @brief Issues the queued draws and reserves the uploaded instance data until they complete.
+     */
+    void flush() {
+        queue.flush();
+        shapes.fenceInstanceBuffer(instanceBufferIndex);
+    }
+
+    RenderQueue& getQueue() { return queue; }
+    const RenderQueue::RenderStats& getRenderStats() const { return queue.getStats(); }
+    const ShapeManager::UploadStats& getUploadStats() const { return shapes.getUploadStats(); }
+    void resetUploadStats() { shapes.resetUploadStats(); }
+
+    /**
+     * @brief Deletes the meshes and buffers. Requires the GL context to still be current.
+     */
+    void cleanup() {
+        shapes.cleanup();
+    }
+
+private:
+    static constexpr unsigned int instanceFloats = 8;                             /* Floats per ball in the instance buffer */
+    static constexpr unsigned int instanceStride = instanceFloats * sizeof(float); /* Bytes per ball in the instance buffer */
+
+    Shader circleShader;                              /* Triangle fan circles, one draw per ball */
+    Shader impostorShader;                            /* Quad impostors, one draw per ball */
+    Shader instancedShader;                           /* Instanced triangle fan circles */
+    Shader instancedImpostorShader;                   /* Instanced quad impostors */
+    Shader directionShader;                           /* Instanced velocity direction lines */
+    UniformHandle<glm::vec3> positionUniform;         /* Ball position of circleShader */
+    UniformHandle<float> radiusUniform;               /* Ball radius of circleShader */
+    UniformHandle<glm::vec3> colorUniform;            /* Ball color of circleShader */
+    UniformHandle<glm::vec3> impostorPositionUniform; /* Ball position of impostorShader */
+    UniformHandle<float> impostorRadiusUniform;       /* Ball radius of impostorShader */
+    UniformHandle<glm::vec3> impostorColorUniform;    /* Ball color of impostorShader */
+    UniformHandle<float> velocityScaleUniform;        /* Line length scale of directionShader */
+    ShapeManager shapes;                              /* Meshes and the instance buffer */
+    int directionLineIndex = -1;                      /* Unit direction line */
+    int circleIndex = -1;                             /* Unit triangle fan circle */
+    int quadIndex = -1;                               /* Unit impostor quad */
+    int instanceBufferIndex = -1;                     /* Streaming per-ball data */
+    std::vector<float> instanceData;                  /* Per-ball data packed for upload */
+    std::size_t ballCount = 0;                        /* Balls in the last upload */
+    RenderQueue queue;                                /* Draws of the current frame */
+};
+
+#endif
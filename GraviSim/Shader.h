@@ -6,8 +6,42 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <unordered_map>
+#include <vector>
 #include <glm/glm.hpp>
 
+/**
+ * @brief Location of a uniform of type T, resolved once and set through Shader::set.
+ */
+template <typename T>
+struct UniformHandle
+{
+    int location = -1; // -1 if the uniform is not active; setting it is then ignored by GL
+};
+
+/**
+ * @brief Maps a C++ uniform type to the GL types it may be assigned to.
+ */
+template <typename T> struct UniformType;
+template <> struct UniformType<bool> { static bool matches(GLenum type) { return type == GL_BOOL; } };
+template <> struct UniformType<int> { static bool matches(GLenum type) { return type == GL_INT || type == GL_SAMPLER_2D; } };
+template <> struct UniformType<float> { static bool matches(GLenum type) { return type == GL_FLOAT; } };
+template <> struct UniformType<glm::vec2> { static bool matches(GLenum type) { return type == GL_FLOAT_VEC2; } };
+template <> struct UniformType<glm::vec3> { static bool matches(GLenum type) { return type == GL_FLOAT_VEC3; } };
+template <> struct UniformType<glm::vec4> { static bool matches(GLenum type) { return type == GL_FLOAT_VEC4; } };
+template <> struct UniformType<glm::mat2> { static bool matches(GLenum type) { return type == GL_FLOAT_MAT2; } };
+template <> struct UniformType<glm::mat3> { static bool matches(GLenum type) { return type == GL_FLOAT_MAT3; } };
+template <> struct UniformType<glm::mat4> { static bool matches(GLenum type) { return type == GL_FLOAT_MAT4; } };
+
+/**
+ * @class Shader
+ * @brief Compiles and links a shader program and sets its uniforms.
+ *
+ * Every active uniform's location is read once after linking, so the setters
+ * never ask the driver to look a name up. Hot code can go one step further and
+ * resolve a typed UniformHandle once, then set it without any string lookup.
+ * Driver lookups are counted so a frame can check that it made none.
+ */
 class Shader
 {
 public:
@@ -72,6 +106,8 @@ public:
         // Delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
+        // 3. Cache the location of every active uniform
+        cacheUniforms();
     }
 
     /**
@@ -82,6 +118,60 @@ public:
         glUseProgram(ID);
     }
 
+    /**
+     * @brief Gets the location of a uniform from the cache.
+     *
+     * @param name Name of the uniform variable.
+     * @return Location of the uniform, or -1 if it is not active in the program.
+     */
+    int getUniformLocation(const std::string& name) const
+    {
+        auto cached = uniforms.find(name);
+        if (cached != uniforms.end())
+            return cached->second.location;
+
+        // Not active (optimized out or misspelled): ask the driver once and remember the answer
+        int location = glGetUniformLocation(ID, name.c_str());
+        uniformLookupCount++;
+        uniforms[name] = { location, GL_NONE };
+        return location;
+    }
+
+    /**
+     * @brief Resolves a typed handle to a uniform, reporting a type mismatch with the program.
+     *
+     * @param name Name of the uniform variable.
+     * @return Handle to pass to set().
+     */
+    template <typename T>
+    UniformHandle<T> getUniform(const std::string& name) const
+    {
+        UniformHandle<T> handle;
+        handle.location = getUniformLocation(name);
+        const UniformInfo& info = uniforms[name];
+        if (info.type != GL_NONE && !UniformType<T>::matches(info.type))
+        {
+            std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name << std::endl;
+        }
+        return handle;
+    }
+
+    void set(UniformHandle<bool> uniform, bool value) const { glUniform1i(uniform.location, (int)value); }
+    void set(UniformHandle<int> uniform, int value) const { glUniform1i(uniform.location, value); }
+    void set(UniformHandle<float> uniform, float value) const { glUniform1f(uniform.location, value); }
+    void set(UniformHandle<glm::vec2> uniform, const glm::vec2& value) const { glUniform2fv(uniform.location, 1, &value[0]); }
+    void set(UniformHandle<glm::vec3> uniform, const glm::vec3& value) const { glUniform3fv(uniform.location, 1, &value[0]); }
+    void set(UniformHandle<glm::vec4> uniform, const glm::vec4& value) const { glUniform4fv(uniform.location, 1, &value[0]); }
+    void set(UniformHandle<glm::mat2> uniform, const glm::mat2& mat) const { glUniformMatrix2fv(uniform.location, 1, GL_FALSE, &mat[0][0]); }
+    void set(UniformHandle<glm::mat3> uniform, const glm::mat3& mat) const { glUniformMatrix3fv(uniform.location, 1, GL_FALSE, &mat[0][0]); }
+    void set(UniformHandle<glm::mat4> uniform, const glm::mat4& mat) const { glUniformMatrix4fv(uniform.location, 1, GL_FALSE, &mat[0][0]); }
+
+    /**
+     * @brief Gets the number of glGetUniformLocation calls made by all shaders since the last reset.
+     */
+    static unsigned int getUniformLookupCount() { return uniformLookupCount; }
+    static void resetUniformLookupCount() { uniformLookupCount = 0; }
+
     /**
      * @brief Sets a boolean uniform in the shader.
      *
@@ -90,7 +180,7 @@ public:
      */
     void setBool(const std::string& name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glUniform1i(getUniformLocation(name), (int)value);
     }
 
     /**
@@ -101,7 +191,7 @@ public:
      */
     void setInt(const std::string& name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1i(getUniformLocation(name), value);
     }
 
     /**
@@ -112,7 +202,7 @@ public:
      */
     void setFloat(const std::string& name, float value) const
     {
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
+        glUniform1f(getUniformLocation(name), value);
     }
 
     /**
@@ -123,7 +213,7 @@ public:
      */
     void setVec2(const std::string& name, const glm::vec2& value) const
     {
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform2fv(getUniformLocation(name), 1, &value[0]);
     }
 
     /**
@@ -135,7 +225,7 @@ public:
      */
     void setVec2(const std::string& name, float x, float y) const
     {
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y);
+        glUniform2f(getUniformLocation(name), x, y);
     }
 
     /**
@@ -146,7 +236,7 @@ public:
      */
     void setVec3(const std::string& name, const glm::vec3& value) const
     {
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform3fv(getUniformLocation(name), 1, &value[0]);
     }
 
     /**
@@ -159,7 +249,7 @@ public:
      */
     void setVec3(const std::string& name, float x, float y, float z) const
     {
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+        glUniform3f(getUniformLocation(name), x, y, z);
     }
 
     /**
@@ -170,7 +260,7 @@ public:
      */
     void setVec4(const std::string& name, const glm::vec4& value) const
     {
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]);
+        glUniform4fv(getUniformLocation(name), 1, &value[0]);
     }
 
     /**
@@ -184,7 +274,7 @@ public:
      */
     void setVec4(const std::string& name, float x, float y, float z, float w) const
     {
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w);
+        glUniform4f(getUniformLocation(name), x, y, z, w);
     }
 
     /**
@@ -195,7 +285,7 @@ public:
      */
     void setMat2(const std::string& name, const glm::mat2& mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     /**
@@ -206,7 +296,7 @@ public:
      */
     void setMat3(const std::string& name, const glm::mat3& mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
     /**
@@ -217,10 +307,50 @@ public:
      */
     void setMat4(const std::string& name, const glm::mat4& mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &mat[0][0]);
     }
 
 private:
+    /**
+     * @struct UniformInfo
+     * @brief Location and GL type of an active uniform.
+     */
+    struct UniformInfo
+    {
+        int location; // Location in the program, -1 if not active
+        GLenum type;  // GL type reported by glGetActiveUniform, GL_NONE if unknown
+    };
+
+    mutable std::unordered_map<std::string, UniformInfo> uniforms; // Uniforms by name
+    inline static unsigned int uniformLookupCount = 0;             // Driver lookups since the last reset
+
+    /**
+     * @brief Reads the name, type and location of every active uniform of the linked program.
+     */
+    void cacheUniforms()
+    {
+        int count = 0;
+        int maxLength = 0;
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+        std::vector<char> name(maxLength + 1);
+        for (int i = 0; i < count; i++)
+        {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = GL_NONE;
+            glGetActiveUniform(ID, i, static_cast<GLsizei>(name.size()), &length, &size, &type, name.data());
+            std::string uniformName(name.data(), length);
+            UniformInfo info = { glGetUniformLocation(ID, uniformName.c_str()), type };
+            uniformLookupCount++;
+            uniforms[uniformName] = info;
+            // Arrays are reported as "name[0]"; also accept the plain name
+            const std::size_t bracket = uniformName.find('[');
+            if (bracket != std::string::npos)
+                uniforms[uniformName.substr(0, bracket)] = info;
+        }
+    }
+
     /**
      * @brief Checks for shader compilation or linking errors.
      *
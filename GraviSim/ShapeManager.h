@@ -2,15 +2,48 @@
 #define SHAPE_MANAGER_H
 
 #include <glad/glad.h>
+#include <glm/gtc/constants.hpp>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <map>
 #include <vector>
 #include <iostream>
+#include "RenderQueue.h"
+
+// Buffer storage is core only from GL 4.4; the bundled glad targets 3.3, so the entry point is loaded by hand
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
 
 /**
  * @class ShapeManager
  * @brief Manages the creation, rendering, and cleanup of shapes using OpenGL VAOs, VBOs, and EBOs.
+ *
+ * Shapes can also be drawn instanced: per-instance data lives in separate
+ * instance buffers owned by the manager, which any number of shapes can read
+ * through attributes with a divisor.
+ *
+ * Circle meshes are cached by segment count: every ball with the same
+ * resolution shares one unit circle, scaled by its radius in the shader.
+ * Impostor circles instead share one unit quad and cut the circle out in the
+ * fragment shader.
+ *
+ * Instance data rewritten every frame should use a streaming buffer: a ring of
+ * streamSections sections, each written while the GPU may still be reading the
+ * others. With GL_ARB_buffer_storage the ring is persistently mapped and every
+ * section is guarded by a fence; otherwise it is written through unsynchronized
+ * mappings and orphaned whenever the ring wraps. Either way an upload does not
+ * wait for the GPU unless it is more than streamSections - 1 frames behind.
  */
 class ShapeManager {
 public:
+    static constexpr unsigned int streamSections = 3; /* Sections in the ring of a streaming buffer */
+
     /**
      * @struct Shape
      * @brief Represents a shape with its OpenGL buffers and vertex/index counts.
@@ -21,6 +54,32 @@ public:
         unsigned int EBO;         /* Element Buffer Object */
         unsigned int vertexCount; /* Number of vertices */
         unsigned int indexCount;  /* Number of indices */
+        GLenum usage;             /* Usage hint of the vertex buffer */
+    };
+
+    /**
+     * @struct InstanceBuffer
+     * @brief A buffer of per-instance attributes and its allocated size.
+     */
+    struct InstanceBuffer {
+        unsigned int VBO;              /* Vertex Buffer Object holding the instance data */
+        unsigned int capacity;         /* Allocated size in bytes, per section for streaming buffers */
+        GLenum usage;                  /* Usage hint used when the buffer is (re)allocated */
+        bool streaming;                /* Ring of streamSections sections */
+        bool persistent;               /* Ring is persistently mapped */
+        void* mapped;                  /* Start of the persistent mapping */
+        unsigned int section;          /* Section written by the last update */
+        GLsync fences[streamSections]; /* Draws still reading each section */
+    };
+
+    /**
+     * @struct UploadStats
+     * @brief Data uploaded through the manager since the last reset.
+     */
+    struct UploadStats {
+        std::size_t bytes = 0;    /* Bytes written to buffers */
+        unsigned int uploads = 0; /* Number of buffer updates */
+        unsigned int stalls = 0;  /* Streaming updates that had to wait for the GPU */
     };
 
     /**
@@ -48,6 +107,7 @@ public:
         glBindVertexArray(shape.VAO);
         glBindBuffer(GL_ARRAY_BUFFER, shape.VBO);
         glBufferData(GL_ARRAY_BUFFER, vertexCount, vertices, mode);
+        shape.usage = mode;
 
         // Generate EBO if needed
         if (indices != nullptr) {
@@ -64,6 +124,70 @@ public:
         return shapes.size() - 1; // Return the index of the created shape
     }
 
+    /**
+     * @brief Gets the unit circle mesh with the given number of segments, creating it on first use.
+     *
+     * The mesh is a triangle fan of 3-float positions with its attribute at location 0.
+     *
+     * @param segments: Number of segments used to approximate the circle.
+     * @return Index of the mesh in the internal shape list.
+     */
+    int getCircleMesh(int segments) {
+        auto cached = circleMeshes.find(segments);
+        if (cached != circleMeshes.end()) {
+            return cached->second;
+        }
+
+        std::vector<float> vertices;
+        generateCircleVertices(vertices, 1.0f, segments);
+        int shapeIndex = createShape(vertices.data(), vertices.size() * sizeof(float));
+        addAttribute(shapeIndex, 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        circleMeshes[segments] = shapeIndex;
+        return shapeIndex;
+    }
+
+    /**
+     * @brief Gets the unit quad covering [-1, 1] on both axes, creating it on first use.
+     *
+     * The mesh is a triangle strip of 2-float positions with its attribute at location 0.
+     *
+     * @return Index of the mesh in the internal shape list.
+     */
+    int getQuadMesh() {
+        if (quadMesh >= 0) {
+            return quadMesh;
+        }
+
+        const float vertices[] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f };
+        quadMesh = createShape(vertices, sizeof(vertices));
+        addAttribute(quadMesh, 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+        return quadMesh;
+    }
+
+    /**
+     * @brief Generates a triangle fan approximating a circle around the origin.
+     *
+     * @param circleVertices: Vector to store generated vertex data.
+     * @param radius: Radius of the circle.
+     * @param segments: Number of segments used to approximate the circle.
+     */
+    static void generateCircleVertices(std::vector<float>& circleVertices, float radius, int segments) {
+        circleVertices.reserve(circleVertices.size() + 3 * (segments + 2));
+
+        // Center position of the circle
+        circleVertices.push_back(0.0f);
+        circleVertices.push_back(0.0f);
+        circleVertices.push_back(0.0f);
+
+        // Generate circle vertices
+        for (int i = 0; i <= segments; i++) {
+            float angle = (2.0f * glm::pi<float>() * i) / segments;
+            circleVertices.push_back(radius * cos(angle));
+            circleVertices.push_back(radius * sin(angle));
+            circleVertices.push_back(0.0f);
+        }
+    }
+
     /**
      * @brief Adds an attribute to a shape's VAO.
      *
@@ -93,6 +217,199 @@ public:
         glBindVertexArray(0); // Unbind VAO
     }
 
+    /**
+     * @brief Creates a buffer for per-instance attributes.
+     *
+     * @param dataSize: Initial size of the buffer in bytes.
+     * @param usage: Usage hint, GL_STREAM_DRAW for data rewritten every frame.
+     * @return Index of the created buffer in the internal instance buffer list.
+     */
+    int createInstanceBuffer(unsigned int dataSize, GLenum usage = GL_STREAM_DRAW) {
+        InstanceBuffer buffer{};
+        buffer.capacity = dataSize;
+        buffer.usage = usage;
+
+        glGenBuffers(1, &buffer.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        glBufferData(GL_ARRAY_BUFFER, dataSize, nullptr, usage);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        instanceBuffers.push_back(buffer);
+        return instanceBuffers.size() - 1;
+    }
+
+    /**
+     * @brief Loads glBufferStorage if the context supports GL 4.4 or GL_ARB_buffer_storage.
+     *
+     * Without it, streaming buffers fall back to unsynchronized mappings and orphaning.
+     *
+     * @param load: Function returning the address of a GL entry point, e.g. glfwGetProcAddress.
+     */
+    static void loadBufferStorage(GLADloadproc load) {
+        GLint major = 0, minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        bool supported = major > 4 || (major == 4 && minor >= 4);
+
+        GLint extensionCount = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+        for (GLint i = 0; i < extensionCount && !supported; i++) {
+            const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+            supported = extension != nullptr && std::strcmp(extension, "GL_ARB_buffer_storage") == 0;
+        }
+
+        bufferStorage = supported ? reinterpret_cast<BufferStorageProc>(load("glBufferStorage")) : nullptr;
+    }
+
+    static bool hasBufferStorage() { return bufferStorage != nullptr; }
+
+    /**
+     * @brief Creates a streaming buffer for per-instance attributes rewritten every frame.
+     *
+     * The buffer is a ring of streamSections sections; each update writes the
+     * next section and points the buffer's attributes at it. Call
+     * fenceInstanceBuffer after the draws that read an update.
+     *
+     * @param sectionSize: Initial size of one section in bytes.
+     * @return Index of the created buffer in the internal instance buffer list.
+     */
+    int createStreamingBuffer(unsigned int sectionSize) {
+        InstanceBuffer buffer{};
+        buffer.capacity = sectionSize;
+        buffer.usage = GL_STREAM_DRAW;
+        buffer.streaming = true;
+        allocateStreamingStorage(buffer);
+
+        instanceBuffers.push_back(buffer);
+        return instanceBuffers.size() - 1;
+    }
+
+    /**
+     * @brief Adds an attribute read from an instance buffer to a shape's VAO.
+     *
+     * @param shapeIndex: Index of the shape in the internal list.
+     * @param bufferIndex: Index of the instance buffer.
+     * @param index: Layout location of the attribute.
+     * @param size: Number of components per instance attribute (e.g., 2 for vec2).
+     * @param type: Data type of each component (e.g., GL_FLOAT).
+     * @param normalized: Whether fixed-point data values should be normalized (GL_TRUE or GL_FALSE).
+     * @param stride: Byte offset between consecutive instances.
+     * @param offset: Pointer offset to the first component of the first instance.
+     * @param divisor: Number of instances that share one value, 1 advances the attribute every instance.
+     */
+    void addInstanceAttribute(int shapeIndex,
+        int bufferIndex,
+        unsigned int index,
+        int size,
+        GLenum type,
+        GLboolean normalized,
+        unsigned int stride,
+        void* offset,
+        unsigned int divisor = 1) {
+        if (shapeIndex < 0 || shapeIndex >= shapes.size()) {
+            std::cerr << "Error: Invalid shape index.\n";
+            return;
+        }
+        if (bufferIndex < 0 || bufferIndex >= instanceBuffers.size()) {
+            std::cerr << "Error: Invalid instance buffer index.\n";
+            return;
+        }
+
+        glBindVertexArray(shapes[shapeIndex].VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceBuffers[bufferIndex].VBO);
+        glEnableVertexAttribArray(index);
+        glVertexAttribPointer(index, size, type, normalized, stride, offset);
+        glVertexAttribDivisor(index, divisor);
+        glBindVertexArray(0); // Unbind VAO
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        // Streaming buffers move their data every frame, so the pointer is re-issued with the section offset
+        instanceAttributes.push_back({ shapeIndex, bufferIndex, index, size, type, normalized, stride, reinterpret_cast<uintptr_t>(offset) });
+    }
+
+    /**
+     * @brief Replaces the contents of an instance buffer, growing it if needed.
+     *
+     * The old storage is orphaned first, so the upload never waits for draws
+     * that still read last frame's data. Streaming buffers write the next
+     * section of their ring instead.
+     *
+     * @param bufferIndex: Index of the instance buffer.
+     * @param data: Pointer to the new instance data.
+     * @param dataSize: Size of the data in bytes.
+     */
+    void updateInstanceBuffer(int bufferIndex, const void* data, unsigned int dataSize) {
+        if (bufferIndex < 0 || bufferIndex >= instanceBuffers.size()) {
+            std::cerr << "Error: Invalid instance buffer index.\n";
+            return;
+        }
+
+        InstanceBuffer& buffer = instanceBuffers[bufferIndex];
+        uploadStats.bytes += dataSize;
+        uploadStats.uploads++;
+        if (buffer.streaming) {
+            updateStreamingBuffer(bufferIndex, data, dataSize);
+            return;
+        }
+
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        if (dataSize > buffer.capacity) {
+            buffer.capacity = dataSize + dataSize / 2;
+        }
+        glBufferData(GL_ARRAY_BUFFER, buffer.capacity, nullptr, buffer.usage);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, dataSize, data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    /**
+     * @brief Marks the section written by the last update as in use until the draws issued so far complete.
+     *
+     * Only persistently mapped buffers need the fence; for others this does nothing.
+     *
+     * @param bufferIndex: Index of the instance buffer.
+     */
+    void fenceInstanceBuffer(int bufferIndex) {
+        if (bufferIndex < 0 || bufferIndex >= instanceBuffers.size()) {
+            std::cerr << "Error: Invalid instance buffer index.\n";
+            return;
+        }
+
+        InstanceBuffer& buffer = instanceBuffers[bufferIndex];
+        if (!buffer.persistent) return;
+        if (buffer.fences[buffer.section]) {
+            glDeleteSync(buffer.fences[buffer.section]);
+        }
+        buffer.fences[buffer.section] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    const UploadStats& getUploadStats() const { return uploadStats; }
+    void resetUploadStats() { uploadStats = UploadStats(); }
+
+    /**
+     * @brief Renders many instances of a shape with a single draw call.
+     *
+     * @param shapeIndex: Index of the shape in the internal list.
+     * @param constant: Number of floats per vertex.
+     * @param instanceCount: Number of instances to draw.
+     * @param mode: OpenGL drawing mode
+     */
+    void renderShapeInstanced(int shapeIndex, int constant, unsigned int instanceCount, GLenum mode = GL_TRIANGLES) {
+        if (shapeIndex < 0 || shapeIndex >= shapes.size()) {
+            std::cerr << "Error: Invalid shape index.\n";
+            return;
+        }
+        if (instanceCount == 0) return;
+
+        glBindVertexArray(shapes[shapeIndex].VAO);
+        if (shapes[shapeIndex].indexCount > 0) {
+            glDrawElementsInstanced(mode, shapes[shapeIndex].indexCount, GL_UNSIGNED_INT, 0, instanceCount);
+        }
+        else {
+            glDrawArraysInstanced(mode, 0, shapes[shapeIndex].vertexCount / constant, instanceCount);
+        }
+        glBindVertexArray(0); // Unbind VAO
+    }
+
     /**
      * @brief Renders a shape by its index.
      *
@@ -115,18 +432,74 @@ public:
         glBindVertexArray(0); // Unbind VAO
     }
 
+    /**
+     * @brief Submits a draw of a shape to a render queue instead of drawing it right away.
+     *
+     * @param queue: Queue that issues the draw at its next flush.
+     * @param program: Shader program to draw with.
+     * @param shapeIndex: Index of the shape in the internal list.
+     * @param constant: Number of floats per vertex.
+     * @param mode: OpenGL drawing mode
+     * @param layer: Draw order group, higher layers are drawn on top.
+     */
+    void submitShape(RenderQueue& queue, unsigned int program, int shapeIndex, int constant, GLenum mode = GL_TRIANGLES, unsigned int layer = 0) const {
+        submitShapeInstanced(queue, program, shapeIndex, constant, 0, mode, layer);
+    }
+
+    /**
+     * @brief Submits an instanced draw of a shape to a render queue.
+     *
+     * @param queue: Queue that issues the draw at its next flush.
+     * @param program: Shader program to draw with.
+     * @param shapeIndex: Index of the shape in the internal list.
+     * @param constant: Number of floats per vertex.
+     * @param instanceCount: Number of instances to draw, 0 for a plain draw.
+     * @param mode: OpenGL drawing mode
+     * @param layer: Draw order group, higher layers are drawn on top.
+     */
+    void submitShapeInstanced(RenderQueue& queue, unsigned int program, int shapeIndex, int constant,
+        unsigned int instanceCount, GLenum mode = GL_TRIANGLES, unsigned int layer = 0) const {
+        if (shapeIndex < 0 || shapeIndex >= shapes.size()) {
+            std::cerr << "Error: Invalid shape index.\n";
+            return;
+        }
+
+        const Shape& shape = shapes[shapeIndex];
+        if (shape.indexCount > 0) {
+            queue.submit(program, shape.VAO, mode, shape.indexCount, true, instanceCount, layer);
+        }
+        else {
+            queue.submit(program, shape.VAO, mode, shape.vertexCount / constant, false, instanceCount, layer);
+        }
+    }
+
+    /**
+     * @brief Replaces the vertices of a shape.
+     *
+     * Rewriting the whole buffer orphans the old storage first, so the upload
+     * does not wait for draws that still read the previous vertices.
+     *
+     * @param shapeIndex: Index of the shape in the internal list.
+     * @param newVertices: Pointer to the new vertex data.
+     * @param dataSize: Size of the data in bytes.
+     */
     void updateBuffer(int shapeIndex, const float* newVertices, unsigned int dataSize) {
         if (shapeIndex < 0 || shapeIndex >= shapes.size()) {
             std::cerr << "Error: Invalid shape index.\n";
             return;
         }
         glBindBuffer(GL_ARRAY_BUFFER, shapes[shapeIndex].VBO);
+        if (dataSize >= shapes[shapeIndex].vertexCount) {
+            glBufferData(GL_ARRAY_BUFFER, shapes[shapeIndex].vertexCount, nullptr, shapes[shapeIndex].usage);
+        }
         glBufferSubData(GL_ARRAY_BUFFER, 0, dataSize, newVertices);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
+        uploadStats.bytes += dataSize;
+        uploadStats.uploads++;
     }
 
     /**
-     * @brief Cleans up all shapes by deleting their VAOs, VBOs, and EBOs.
+     * @brief Cleans up all shapes by deleting their VAOs, VBOs, and EBOs, and the instance buffers.
      */
     void cleanup() {
         for (const Shape& shape : shapes) {
@@ -137,6 +510,14 @@ public:
             }
         }
         shapes.clear();
+        circleMeshes.clear();
+        quadMesh = -1;
+        for (InstanceBuffer& buffer : instanceBuffers) {
+            if (buffer.streaming) releaseStreamingStorage(buffer);
+            else glDeleteBuffers(1, &buffer.VBO);
+        }
+        instanceBuffers.clear();
+        instanceAttributes.clear();
     }
 
     /**
@@ -188,7 +569,145 @@ public:
     }
 
 private:
-    std::vector<Shape> shapes; /* Internal list of shapes managed by ShapeManager */
+    /**
+     * @struct InstanceAttribute
+     * @brief Layout of an attribute read from an instance buffer, kept to re-point it at streaming sections.
+     */
+    struct InstanceAttribute {
+        int shapeIndex;       /* Shape whose VAO reads the attribute */
+        int bufferIndex;      /* Instance buffer the attribute reads */
+        unsigned int index;   /* Layout location */
+        int size;             /* Components per instance */
+        GLenum type;          /* Component type */
+        GLboolean normalized; /* Normalize fixed-point values */
+        unsigned int stride;  /* Bytes between consecutive instances */
+        uintptr_t offset;     /* Offset of the first instance within a section */
+    };
+
+    /**
+     * @brief Creates the storage of a streaming buffer for its current section capacity.
+     *
+     * @param buffer: Streaming buffer to allocate.
+     */
+    void allocateStreamingStorage(InstanceBuffer& buffer) {
+        // Keep every section start aligned for attribute offsets and mapping
+        buffer.capacity = (buffer.capacity + 255u) & ~255u;
+        buffer.section = streamSections - 1;
+        buffer.persistent = bufferStorage != nullptr;
+        buffer.mapped = nullptr;
+        for (GLsync& fence : buffer.fences) fence = nullptr;
+
+        const GLsizeiptr size = static_cast<GLsizeiptr>(buffer.capacity) * streamSections;
+        glGenBuffers(1, &buffer.VBO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        if (buffer.persistent) {
+            const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_ARRAY_BUFFER, size, nullptr, flags);
+            buffer.mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, flags);
+            if (buffer.mapped == nullptr) {
+                std::cerr << "ERROR::SHAPE_MANAGER::PERSISTENT_MAP_FAILED" << std::endl;
+                glDeleteBuffers(1, &buffer.VBO);
+                glGenBuffers(1, &buffer.VBO);
+                glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+                buffer.persistent = false;
+            }
+        }
+        if (!buffer.persistent) {
+            glBufferData(GL_ARRAY_BUFFER, size, nullptr, buffer.usage);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    /**
+     * @brief Deletes the fences, mapping and storage of a streaming buffer.
+     *
+     * @param buffer: Streaming buffer to release.
+     */
+    void releaseStreamingStorage(InstanceBuffer& buffer) {
+        for (GLsync& fence : buffer.fences) {
+            if (fence) glDeleteSync(fence);
+            fence = nullptr;
+        }
+        if (buffer.mapped) {
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+            glUnmapBuffer(GL_ARRAY_BUFFER);
+            glBindBuffer(GL_ARRAY_BUFFER, 0);
+            buffer.mapped = nullptr;
+        }
+        glDeleteBuffers(1, &buffer.VBO);
+    }
+
+    /**
+     * @brief Writes data to the next section of a streaming buffer and points its attributes at it.
+     *
+     * @param bufferIndex: Index of the streaming buffer.
+     * @param data: Pointer to the new instance data.
+     * @param dataSize: Size of the data in bytes.
+     */
+    void updateStreamingBuffer(int bufferIndex, const void* data, unsigned int dataSize) {
+        InstanceBuffer& buffer = instanceBuffers[bufferIndex];
+        if (dataSize == 0) return;
+
+        // A larger section needs new storage; draws still reading the old buffer keep it alive
+        if (dataSize > buffer.capacity) {
+            releaseStreamingStorage(buffer);
+            buffer.capacity = dataSize + dataSize / 2;
+            allocateStreamingStorage(buffer);
+        }
+
+        buffer.section = (buffer.section + 1) % streamSections;
+        const uintptr_t sectionOffset = static_cast<uintptr_t>(buffer.section) * buffer.capacity;
+
+        if (buffer.persistent) {
+            // Wait only if the GPU has not finished the draws of streamSections frames ago
+            GLsync& fence = buffer.fences[buffer.section];
+            if (fence) {
+                if (glClientWaitSync(fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                    uploadStats.stalls++;
+                    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {}
+                }
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+            std::memcpy(static_cast<char*>(buffer.mapped) + sectionOffset, data, dataSize);
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+        }
+        else {
+            // Orphan when the ring wraps, so unsynchronized writes never touch storage the GPU may still read
+            glBindBuffer(GL_ARRAY_BUFFER, buffer.VBO);
+            if (buffer.section == 0) {
+                glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(buffer.capacity) * streamSections, nullptr, buffer.usage);
+            }
+            void* section = glMapBufferRange(GL_ARRAY_BUFFER, sectionOffset, dataSize,
+                GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+            if (section) {
+                std::memcpy(section, data, dataSize);
+                glUnmapBuffer(GL_ARRAY_BUFFER);
+            }
+            else {
+                glBufferSubData(GL_ARRAY_BUFFER, sectionOffset, dataSize, data);
+            }
+        }
+
+        // GL 3.3 has no base instance, so the attributes are re-pointed at the section instead
+        for (const InstanceAttribute& attribute : instanceAttributes) {
+            if (attribute.bufferIndex != bufferIndex) continue;
+            glBindVertexArray(shapes[attribute.shapeIndex].VAO);
+            glVertexAttribPointer(attribute.index, attribute.size, attribute.type, attribute.normalized,
+                attribute.stride, reinterpret_cast<void*>(attribute.offset + sectionOffset));
+        }
+        glBindVertexArray(0); // Unbind VAO
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    inline static BufferStorageProc bufferStorage = nullptr; /* glBufferStorage, null when unsupported */
+
+    std::vector<Shape> shapes;                         /* Internal list of shapes managed by ShapeManager */
+    std::vector<InstanceBuffer> instanceBuffers;       /* Per-instance attribute buffers shared by the shapes */
+    std::vector<InstanceAttribute> instanceAttributes; /* Attributes read from the instance buffers */
+    std::map<int, int> circleMeshes;                   /* Unit circle shape index for each segment count */
+    int quadMesh = -1;                                 /* Unit quad shape index, -1 until first used */
+    UploadStats uploadStats;                           /* Data uploaded since the last reset */
 };
 
 #endif
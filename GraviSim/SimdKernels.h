@@ -0,0 +1,195 @@
+#ifndef SIMD_KERNELS_H
+#define SIMD_KERNELS_H
+
+#include <cstddef>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define GRAVISIM_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX intrinsics in any function; GCC and Clang need the target enabled per function
+#if defined(GRAVISIM_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GRAVISIM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define GRAVISIM_TARGET_AVX2
+#endif
+
+/**
+ * @brief Instruction sets the ball kernels can run on.
+ */
+enum class SimdLevel {
+    Scalar, // One ball at a time
+    SSE2,   // Four balls per instruction
+    AVX2    // Eight balls per instruction
+};
+
+/**
+ * @brief Detects the widest instruction set supported by the CPU and the OS.
+ */
+inline SimdLevel detectSimdLevel() {
+#if defined(GRAVISIM_X86)
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    if (maxLeaf >= 7) {
+        __cpuid(info, 1);
+        const bool osxsave = (info[2] & (1 << 27)) != 0;
+        const bool avx = (info[2] & (1 << 28)) != 0;
+        // The OS must save the YMM registers on context switches
+        if (osxsave && avx && (_xgetbv(0) & 6) == 6) {
+            __cpuidex(info, 7, 0);
+            if (info[1] & (1 << 5)) return SimdLevel::AVX2;
+        }
+    }
+    return SimdLevel::SSE2;
+#else
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return SimdLevel::AVX2;
+    return SimdLevel::SSE2;
+#endif
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+/**
+ * @brief Gets the detected instruction set, probing the CPU only once.
+ */
+inline SimdLevel getSimdLevel() {
+    static const SimdLevel level = detectSimdLevel();
+    return level;
+}
+
+/**
+ * @brief Gets a human readable name of an instruction set.
+ */
+inline const char* getSimdLevelName(SimdLevel level) {
+    switch (level) {
+    case SimdLevel::AVX2: return "avx2";
+    case SimdLevel::SSE2: return "sse2";
+    default: return "scalar";
+    }
+}
+
+/*
+ * Vector versions of BallSystem::integrate followed by BallSystem::handleCollisions.
+ * Every branch of the scalar code becomes a mask and a blend, and every
+ * arithmetic step is performed in the same order without fused multiply-adds,
+ * so the results are bit-exact with the scalar kernels. Each function processes
+ * whole vectors from begin and returns the index of the first unprocessed ball;
+ * the caller finishes the tail with the scalar kernels.
+ */
+
+#if defined(GRAVISIM_X86)
+
+inline std::size_t updatePhysicsSSE2(float* x, float* y, float* vx, float* vy, const float* radius,
+    std::size_t begin, std::size_t end, float deltaTime, float damping, float velocityThreshold) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 minusOne = _mm_set1_ps(-1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 dt = _mm_set1_ps(deltaTime);
+    const __m128 damp = _mm_set1_ps(damping);
+    const __m128 negDamp = _mm_set1_ps(-damping);
+    const __m128 threshold = _mm_set1_ps(velocityThreshold);
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+
+    // SSE2 has no blendv: select b where mask is set, a elsewhere
+    auto select = [](__m128 a, __m128 b, __m128 mask) {
+        return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+    };
+
+    std::size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pvx = _mm_loadu_ps(vx + i);
+        __m128 pvy = _mm_loadu_ps(vy + i);
+        const __m128 r = _mm_loadu_ps(radius + i);
+
+        // Update position
+        px = _mm_add_ps(px, _mm_mul_ps(pvx, dt));
+        py = _mm_add_ps(py, _mm_mul_ps(pvy, dt));
+
+        // Collision with left or right wall
+        const __m128 hitX = _mm_or_ps(_mm_cmpge_ps(_mm_add_ps(px, r), one), _mm_cmple_ps(_mm_sub_ps(px, r), minusOne));
+        pvx = select(pvx, _mm_mul_ps(pvx, negDamp), hitX);
+        px = select(px, _mm_min_ps(_mm_max_ps(px, _mm_add_ps(minusOne, r)), _mm_sub_ps(one, r)), hitX);
+        pvx = select(pvx, zero, _mm_and_ps(hitX, _mm_cmplt_ps(_mm_and_ps(pvx, absMask), threshold)));
+
+        // Collision with the ground, otherwise with the ceiling
+        const __m128 ground = _mm_cmple_ps(_mm_sub_ps(py, r), minusOne);
+        const __m128 ceiling = _mm_andnot_ps(ground, _mm_cmpge_ps(_mm_add_ps(py, r), one));
+        const __m128 hitY = _mm_or_ps(ground, ceiling);
+        pvy = select(pvy, _mm_mul_ps(pvy, negDamp), hitY);
+        py = select(py, _mm_add_ps(minusOne, r), ground);
+        py = select(py, _mm_sub_ps(one, r), ceiling);
+        pvx = select(pvx, _mm_mul_ps(pvx, damp), ground);
+        pvy = select(pvy, zero, _mm_and_ps(hitY, _mm_cmplt_ps(_mm_and_ps(pvy, absMask), threshold)));
+        pvx = select(pvx, zero, _mm_and_ps(ground, _mm_cmplt_ps(_mm_and_ps(pvx, absMask), threshold)));
+
+        _mm_storeu_ps(x + i, px);
+        _mm_storeu_ps(y + i, py);
+        _mm_storeu_ps(vx + i, pvx);
+        _mm_storeu_ps(vy + i, pvy);
+    }
+    return i;
+}
+
+GRAVISIM_TARGET_AVX2
+inline std::size_t updatePhysicsAVX2(float* x, float* y, float* vx, float* vy, const float* radius,
+    std::size_t begin, std::size_t end, float deltaTime, float damping, float velocityThreshold) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 minusOne = _mm256_set1_ps(-1.0f);
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 dt = _mm256_set1_ps(deltaTime);
+    const __m256 damp = _mm256_set1_ps(damping);
+    const __m256 negDamp = _mm256_set1_ps(-damping);
+    const __m256 threshold = _mm256_set1_ps(velocityThreshold);
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+
+    std::size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 px = _mm256_loadu_ps(x + i);
+        __m256 py = _mm256_loadu_ps(y + i);
+        __m256 pvx = _mm256_loadu_ps(vx + i);
+        __m256 pvy = _mm256_loadu_ps(vy + i);
+        const __m256 r = _mm256_loadu_ps(radius + i);
+
+        // Update position
+        px = _mm256_add_ps(px, _mm256_mul_ps(pvx, dt));
+        py = _mm256_add_ps(py, _mm256_mul_ps(pvy, dt));
+
+        // Collision with left or right wall
+        const __m256 hitX = _mm256_or_ps(_mm256_cmp_ps(_mm256_add_ps(px, r), one, _CMP_GE_OQ),
+            _mm256_cmp_ps(_mm256_sub_ps(px, r), minusOne, _CMP_LE_OQ));
+        pvx = _mm256_blendv_ps(pvx, _mm256_mul_ps(pvx, negDamp), hitX);
+        px = _mm256_blendv_ps(px, _mm256_min_ps(_mm256_max_ps(px, _mm256_add_ps(minusOne, r)), _mm256_sub_ps(one, r)), hitX);
+        pvx = _mm256_blendv_ps(pvx, zero, _mm256_and_ps(hitX, _mm256_cmp_ps(_mm256_and_ps(pvx, absMask), threshold, _CMP_LT_OQ)));
+
+        // Collision with the ground, otherwise with the ceiling
+        const __m256 ground = _mm256_cmp_ps(_mm256_sub_ps(py, r), minusOne, _CMP_LE_OQ);
+        const __m256 ceiling = _mm256_andnot_ps(ground, _mm256_cmp_ps(_mm256_add_ps(py, r), one, _CMP_GE_OQ));
+        const __m256 hitY = _mm256_or_ps(ground, ceiling);
+        pvy = _mm256_blendv_ps(pvy, _mm256_mul_ps(pvy, negDamp), hitY);
+        py = _mm256_blendv_ps(py, _mm256_add_ps(minusOne, r), ground);
+        py = _mm256_blendv_ps(py, _mm256_sub_ps(one, r), ceiling);
+        pvx = _mm256_blendv_ps(pvx, _mm256_mul_ps(pvx, damp), ground);
+        pvy = _mm256_blendv_ps(pvy, zero, _mm256_and_ps(hitY, _mm256_cmp_ps(_mm256_and_ps(pvy, absMask), threshold, _CMP_LT_OQ)));
+        pvx = _mm256_blendv_ps(pvx, zero, _mm256_and_ps(ground, _mm256_cmp_ps(_mm256_and_ps(pvx, absMask), threshold, _CMP_LT_OQ)));
+
+        _mm256_storeu_ps(x + i, px);
+        _mm256_storeu_ps(y + i, py);
+        _mm256_storeu_ps(vx + i, pvx);
+        _mm256_storeu_ps(vy + i, pvy);
+    }
+    return i;
+}
+
+#endif
+
+#endif
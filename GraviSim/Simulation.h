@@ -0,0 +1,159 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include "AlignedArray.h"
+#include "BallSystem.h"
+#include "BallCollisionSolver.h"
+#include "ContinuousCollisionSolver.h"
+#include "GravitySolver.h"
+#include "SleepSolver.h"
+
+/**
+ * @class Simulation
+ * @brief Owns the balls and the solvers, and advances them in fixed or variable time steps.
+ *
+ * In fixed-timestep mode the frame time is accumulated and consumed in steps
+ * of exactly fixedDeltaTime, at most maxSubsteps per frame, so results do not
+ * depend on the frame rate. Positions before the last step are kept so the
+ * renderer can interpolate between the previous and the current state by the
+ * fraction of a step left in the accumulator.
+ *
+ * Resting islands of balls are put to sleep after each step. Mutual gravity
+ * keeps every ball accelerating, so nothing sleeps while it is enabled.
+ */
+class Simulation {
+public:
+    /**
+     * @struct TimestepSettings
+     * @brief Controls how frame time is turned into physics steps.
+     */
+    struct TimestepSettings {
+        bool fixedTimestep = true;            /* Step in fixed increments instead of the raw frame time */
+        float fixedDeltaTime = 1.0f / 120.0f; /* Length of one fixed step */
+        int maxSubsteps = 8;                  /* Most fixed steps run in one frame */
+        float maxFrameTime = 0.25f;           /* Longer frames (hitches) are clamped to this */
+    };
+
+    BallSystem balls;                              /* Every ball in the simulation */
+    BallCollisionSolver collisionSolver;           /* Ball-ball collisions */
+    ContinuousCollisionSolver ccdSolver;           /* Time of impact for fast balls */
+    GravitySolver gravitySolver;                   /* Mutual gravitation */
+    SleepSolver sleepSolver;                       /* Deactivation of resting balls */
+    TimestepSettings timestep;                     /* Stepping mode */
+    std::function<void(const Simulation&)> onStep; /* Called after every step, e.g. to record it */
+
+    /**
+     * @brief Runs exactly one physics step.
+     *
+     * @param deltaTime Time step for the physics update.
+     */
+    void step(float deltaTime) {
+        gravitySolver.apply(balls, deltaTime);
+        ccdSolver.begin(balls, deltaTime);
+        balls.updatePhysics(deltaTime);
+        ccdSolver.solve(balls, deltaTime, collisionSolver.getBroadphase() != nullptr);
+        collisionSolver.solve(balls);
+        if (gravitySolver.mode == GravityMode::Off) {
+            sleepSolver.update(balls, collisionSolver.getPairs(), deltaTime);
+        }
+        else {
+            sleepSolver.wakeAll(balls);
+        }
+        stepCount++;
+        if (onStep) onStep(*this);
+    }
+
+    /**
+     * @brief Advances the simulation by the time that passed since the last frame.
+     *
+     * @param frameTime Wall time of the last frame in seconds.
+     * @return Number of physics steps that were run.
+     */
+    int advance(float frameTime) {
+        frameTime = std::min(std::max(frameTime, 0.0f), timestep.maxFrameTime);
+
+        if (!timestep.fixedTimestep) {
+            savePreviousState();
+            step(frameTime);
+            accumulator = 0.0f;
+            return 1;
+        }
+
+        const float deltaTime = timestep.fixedDeltaTime;
+        accumulator += frameTime;
+        int substeps = std::min(static_cast<int>(accumulator / deltaTime), timestep.maxSubsteps);
+
+        for (int i = 0; i < substeps; i++) {
+            // Only the state before the last step is needed for interpolation
+            if (i == substeps - 1) savePreviousState();
+            step(deltaTime);
+            accumulator -= deltaTime;
+        }
+
+        // Drop time we could not catch up on instead of spiralling further behind
+        if (accumulator >= deltaTime) {
+            droppedTime += accumulator - std::fmod(accumulator, deltaTime);
+            accumulator = std::fmod(accumulator, deltaTime);
+        }
+        return substeps;
+    }
+
+    /**
+     * @brief Gets how far the rendered state is between the previous and the current step.
+     */
+    float getInterpolationAlpha() const {
+        if (!timestep.fixedTimestep) return 1.0f;
+        return std::min(accumulator / timestep.fixedDeltaTime, 1.0f);
+    }
+
+    /**
+     * @brief Gets the position of a ball interpolated for rendering.
+     *
+     * @param i Index of the ball.
+     */
+    glm::vec2 getRenderPosition(std::size_t i) const {
+        const glm::vec2 current(balls.x[i], balls.y[i]);
+        if (i >= previousX.size()) return current;
+        return glm::mix(glm::vec2(previousX[i], previousY[i]), current, getInterpolationAlpha());
+    }
+
+    /**
+     * @brief Gets the position of a ball before the last step, or its current one if it was added since.
+     *
+     * @param i Index of the ball.
+     */
+    glm::vec2 getPreviousPosition(std::size_t i) const {
+        if (i >= previousX.size()) return glm::vec2(balls.x[i], balls.y[i]);
+        return glm::vec2(previousX[i], previousY[i]);
+    }
+
+    uint64_t getStepCount() const { return stepCount; }
+    float getDroppedTime() const { return droppedTime; }
+    std::size_t getActiveCount() const { return sleepSolver.getActiveCount(); }
+    std::size_t getSleepingCount() const { return sleepSolver.getSleepingCount(); }
+
+private:
+    /**
+     * @brief Copies the current positions so they can be interpolated from.
+     */
+    void savePreviousState() {
+        previousX.resize(balls.size());
+        previousY.resize(balls.size());
+        if (balls.size() == 0) return;
+        std::memcpy(previousX.data(), balls.x.data(), balls.size() * sizeof(float));
+        std::memcpy(previousY.data(), balls.y.data(), balls.size() * sizeof(float));
+    }
+
+    AlignedArray<float> previousX; /* Positions before the last step */
+    AlignedArray<float> previousY;
+    float accumulator = 0.0f;      /* Frame time not yet consumed by fixed steps */
+    float droppedTime = 0.0f;      /* Time discarded because of the substep cap */
+    uint64_t stepCount = 0;        /* Number of steps run so far */
+};
+
+#endif
@@ -0,0 +1,276 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "Simulation.h"
+#include "TripleBuffer.h"
+
+/**
+ * @struct SimulationSnapshot
+ * @brief Copy of everything the renderer needs from one published simulation state.
+ */
+struct SimulationSnapshot {
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<float> x;          /* Interpolated render position x of each ball */
+    std::vector<float> y;          /* Interpolated render position y of each ball */
+    std::vector<float> stateX;     /* Position x of each ball after the last step, kept by captureSteps */
+    std::vector<float> stateY;     /* Position y of each ball after the last step, kept by captureSteps */
+    std::vector<float> previousX;  /* Position x of each ball before the last step, kept by captureSteps */
+    std::vector<float> previousY;  /* Position y of each ball before the last step, kept by captureSteps */
+    std::vector<float> vx;         /* Velocity x of each ball */
+    std::vector<float> vy;         /* Velocity y of each ball */
+    std::vector<float> radius;     /* Radius of each ball */
+    std::vector<float> colorR;     /* Red color channel of each ball */
+    std::vector<float> colorG;     /* Green color channel of each ball */
+    std::vector<float> colorB;     /* Blue color channel of each ball */
+    uint64_t stepCount = 0;        /* Physics steps run when the snapshot was taken */
+    std::size_t activeCount = 0;   /* Awake balls */
+    std::size_t sleepingCount = 0; /* Sleeping balls */
+    double advanceTimeMs = 0.0;    /* CPU time of the advance that produced the snapshot */
+    float stepDuration = 0.0f;     /* Fixed step length interpolate blends over, 0 if x and y are final */
+    Clock::time_point stateTime;   /* Wall time the state after the last step stands for */
+
+    std::size_t size() const { return x.size(); }
+
+    /**
+     * @brief Copies the current render state of a simulation, reusing the vectors' storage.
+     *
+     * @param simulation Simulation to copy; must not be stepped during the copy.
+     */
+    void capture(const Simulation& simulation) {
+        const BallSystem& balls = simulation.balls;
+        const std::size_t count = balls.size();
+
+        x.resize(count);
+        y.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            const glm::vec2 position = simulation.getRenderPosition(i);
+            x[i] = position.x;
+            y[i] = position.y;
+        }
+        vx.assign(balls.vx.data(), balls.vx.data() + count);
+        vy.assign(balls.vy.data(), balls.vy.data() + count);
+        radius.assign(balls.radius.data(), balls.radius.data() + count);
+        colorR.assign(balls.colorR.data(), balls.colorR.data() + count);
+        colorG.assign(balls.colorG.data(), balls.colorG.data() + count);
+        colorB.assign(balls.colorB.data(), balls.colorB.data() + count);
+        stepCount = simulation.getStepCount();
+        activeCount = simulation.getActiveCount();
+        sleepingCount = simulation.getSleepingCount();
+        stepDuration = 0.0f;
+    }
+
+    /**
+     * @brief Copies a simulation like capture, plus the states before and after its last step for interpolate.
+     *
+     * @param simulation Simulation to copy; must not be stepped during the copy.
+     * @param advancedTo Wall time the simulation was last advanced to.
+     */
+    void captureSteps(const Simulation& simulation, Clock::time_point advancedTo) {
+        capture(simulation);
+        if (!simulation.timestep.fixedTimestep) return;
+
+        const std::size_t count = size();
+        const BallSystem& balls = simulation.balls;
+        stateX.assign(balls.x.data(), balls.x.data() + count);
+        stateY.assign(balls.y.data(), balls.y.data() + count);
+        previousX.resize(count);
+        previousY.resize(count);
+        for (std::size_t i = 0; i < count; i++) {
+            const glm::vec2 previous = simulation.getPreviousPosition(i);
+            previousX[i] = previous.x;
+            previousY[i] = previous.y;
+        }
+        // The time left in the accumulator has not been simulated yet
+        stepDuration = simulation.timestep.fixedDeltaTime;
+        const float pending = simulation.getInterpolationAlpha() * stepDuration;
+        stateTime = advancedTo - std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(pending));
+    }
+
+    /**
+     * @brief Blends the positions kept by captureSteps into x and y for the moment the snapshot is drawn.
+     *
+     * Does nothing for snapshots filled by capture alone.
+     *
+     * @param now Wall time of the frame being drawn.
+     */
+    void interpolate(Clock::time_point now) {
+        if (stepDuration <= 0.0f) return;
+        const float alpha = std::min(std::max(std::chrono::duration<float>(now - stateTime).count() / stepDuration, 0.0f), 1.0f);
+        for (std::size_t i = 0; i < size(); i++) {
+            x[i] = previousX[i] + (stateX[i] - previousX[i]) * alpha;
+            y[i] = previousY[i] + (stateY[i] - previousY[i]) * alpha;
+        }
+    }
+
+    /**
+     * @brief Finds the first ball containing a point, at its rendered position.
+     *
+     * @return Index of the ball, or BallSystem::npos if none contains the point.
+     */
+    std::size_t findBallAt(float px, float py) const {
+        for (std::size_t i = 0; i < size(); i++) {
+            float dx = px - x[i];
+            float dy = py - y[i];
+            if ((dx * dx + dy * dy) < (radius[i] * radius[i])) {
+                return i;
+            }
+        }
+        return BallSystem::npos;
+    }
+};
+
+/**
+ * @brief Change to the simulation requested by another thread, run on the simulation thread between steps.
+ */
+using SimulationCommand = std::function<void(Simulation&)>;
+
+/**
+ * @class SimulationThread
+ * @brief Runs a Simulation on its own thread and publishes snapshots of it.
+ *
+ * The thread advances the simulation by the wall time that passed, publishes a
+ * snapshot through a lock-free triple buffer and sleeps until the next fixed
+ * step is due, so a slow frame on the render thread no longer slows the
+ * physics down and a slow step no longer blocks a frame. A snapshot carries
+ * the states before and after the last step and the time they stand for, and
+ * acquireSnapshot blends them for the moment it is called, so motion stays
+ * smooth between the fixed steps. Once started, the
+ * simulation must only be touched through commands, which travel from the
+ * posting thread through a lock-free single-producer ring.
+ */
+class SimulationThread {
+public:
+    explicit SimulationThread(Simulation& sim)
+        : simulation(sim) {
+    }
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    ~SimulationThread() {
+        stop();
+    }
+
+    /**
+     * @brief Publishes a first snapshot and starts stepping on the simulation thread.
+     */
+    void start() {
+        if (running.load()) return;
+        publishSnapshot(std::chrono::steady_clock::now());
+        running.store(true);
+        thread = std::thread([this]() { run(); });
+    }
+
+    /**
+     * @brief Stops the simulation thread and waits for it to finish its current step.
+     */
+    void stop() {
+        if (!running.exchange(false)) return;
+        thread.join();
+    }
+
+    /**
+     * @brief Queues a command for the simulation thread. Only one thread may post commands.
+     *
+     * @param command Change to apply before the next step.
+     * @return False if the queue is full and the command was dropped.
+     */
+    bool post(SimulationCommand command) {
+        const std::size_t tail = commandTail.load(std::memory_order_relaxed);
+        const std::size_t next = (tail + 1) % commandCapacity;
+        if (next == commandHead.load(std::memory_order_acquire)) {
+            std::cerr << "ERROR::SIMULATION_THREAD::COMMAND_QUEUE_FULL" << std::endl;
+            return false;
+        }
+        commands[tail] = std::move(command);
+        commandTail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Gets the latest published snapshot, interpolated for now. Only one thread may read snapshots.
+     *
+     * The snapshot stays unchanged until the next call.
+     */
+    const SimulationSnapshot& acquireSnapshot() {
+        SimulationSnapshot& snapshot = snapshots.acquire();
+        snapshot.interpolate(std::chrono::steady_clock::now());
+        return snapshot;
+    }
+
+private:
+    static constexpr std::size_t commandCapacity = 256; /* Slots in the command ring, one is kept free */
+
+    /**
+     * @brief Body of the simulation thread.
+     */
+    void run() {
+        auto lastTime = std::chrono::steady_clock::now();
+        while (running.load(std::memory_order_acquire)) {
+            runCommands();
+
+            auto now = std::chrono::steady_clock::now();
+            const float frameTime = std::chrono::duration<float>(now - lastTime).count();
+            lastTime = now;
+            const int steps = simulation.advance(frameTime);
+            advanceTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - now).count();
+            if (steps > 0 || !simulation.timestep.fixedTimestep) {
+                publishSnapshot(now);
+            }
+
+            // Sleep until the next fixed step is due; variable steps run at most about once per millisecond
+            float wait = 0.001f;
+            if (simulation.timestep.fixedTimestep) {
+                wait = simulation.timestep.fixedDeltaTime * (1.0f - simulation.getInterpolationAlpha());
+            }
+            std::this_thread::sleep_for(std::chrono::duration<float>(std::max(wait, 0.0f)));
+        }
+        runCommands();
+    }
+
+    /**
+     * @brief Runs every queued command.
+     */
+    void runCommands() {
+        std::size_t head = commandHead.load(std::memory_order_relaxed);
+        while (head != commandTail.load(std::memory_order_acquire)) {
+            SimulationCommand command = std::move(commands[head]);
+            commands[head] = nullptr;
+            head = (head + 1) % commandCapacity;
+            commandHead.store(head, std::memory_order_release);
+            command(simulation);
+        }
+    }
+
+    /**
+     * @brief Copies the simulation's state into the write buffer and publishes it.
+     *
+     * @param advancedTo Wall time the simulation was last advanced to.
+     */
+    void publishSnapshot(std::chrono::steady_clock::time_point advancedTo) {
+        SimulationSnapshot& snapshot = snapshots.getWriteBuffer();
+        snapshot.captureSteps(simulation, advancedTo);
+        snapshot.advanceTimeMs = advanceTimeMs;
+        snapshots.publish();
+    }
+
+    Simulation& simulation;                      /* Simulation owned by the thread while it runs */
+    std::thread thread;                          /* The simulation thread */
+    std::atomic<bool> running{ false };          /* Cleared to stop the thread */
+    TripleBuffer<SimulationSnapshot> snapshots;  /* Published states */
+    SimulationCommand commands[commandCapacity]; /* Ring of queued commands */
+    std::atomic<std::size_t> commandHead{ 0 };   /* Next command to run, advanced by the simulation thread */
+    std::atomic<std::size_t> commandTail{ 0 };   /* Next free slot, advanced by the posting thread */
+    double advanceTimeMs = 0.0;                  /* CPU time of the last advance, simulation thread only */
+};
+
+#endif
@@ -0,0 +1,166 @@
+#ifndef SLEEP_SOLVER_H
+#define SLEEP_SOLVER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include "BallSystem.h"
+#include "Broadphase.h"
+
+/**
+ * @class SleepSolver
+ * @brief Puts islands of resting balls to sleep and wakes them when they are disturbed.
+ *
+ * Every awake ball accumulates the time its speed has stayed below
+ * sleepVelocity. Awake balls connected by contacts form an island, and an
+ * island falls asleep once all of its balls have rested for sleepTime. Sleeping
+ * balls touched by an awake ball only act as static obstacles; a sleeping
+ * island wakes as a whole when an awake ball moving faster than sleepVelocity
+ * hits it, or when a ball of it is moved by hand (BallSystem::wake).
+ */
+class SleepSolver {
+public:
+    bool enabled = true;         /* Let resting balls fall asleep */
+    float sleepVelocity = 0.02f; /* Speed below which a ball counts as resting */
+    float sleepTime = 0.5f;      /* Time an island must rest before it falls asleep */
+
+    /**
+     * @brief Updates rest timers, wakes disturbed islands and puts rested islands to sleep.
+     *
+     * @param balls System to update.
+     * @param pairs Contacts found in this step.
+     * @param deltaTime Length of the step.
+     */
+    void update(BallSystem& balls, const std::vector<BallPair>& pairs, float deltaTime) {
+        if (!enabled) {
+            wakeAll(balls);
+            return;
+        }
+
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        const float sleepVelocity2 = sleepVelocity * sleepVelocity;
+        const float* vx = balls.vx.data();
+        const float* vy = balls.vy.data();
+        uint8_t* sleeping = balls.sleeping.data();
+        float* sleepTimer = balls.sleepTimer.data();
+
+        // Wake the islands hit by a moving ball
+        for (const BallPair& pair : pairs) {
+            if (sleeping[pair.a] == sleeping[pair.b]) continue;
+            const uint32_t mover = sleeping[pair.a] ? pair.b : pair.a;
+            const uint32_t sleeper = sleeping[pair.a] ? pair.a : pair.b;
+            if (vx[mover] * vx[mover] + vy[mover] * vy[mover] > sleepVelocity2) {
+                balls.wake(sleeper);
+            }
+        }
+
+        // Time each ball has been at rest; sleeping balls have no velocity, so the loop needs no branch
+        for (uint32_t i = 0; i < count; i++) {
+            const bool resting = vx[i] * vx[i] + vy[i] * vy[i] <= sleepVelocity2;
+            sleepTimer[i] = resting ? sleepTimer[i] + deltaTime : 0.0f;
+        }
+
+        // Islands of awake balls joined by contacts
+        parent.resize(count);
+        for (uint32_t i = 0; i < count; i++) parent[i] = i;
+        for (const BallPair& pair : pairs) {
+            if (sleeping[pair.a] | sleeping[pair.b]) continue;
+            unite(pair.a, pair.b);
+        }
+
+        // An island has rested as long as its most restless ball; balls without contacts are their own island
+        islandRest.assign(sleepTimer, sleepTimer + count);
+        for (const BallPair& pair : pairs) {
+            if (sleeping[pair.a] | sleeping[pair.b]) continue;
+            const uint32_t root = find(pair.a);
+            islandRest[root] = std::min(islandRest[root], std::min(sleepTimer[pair.a], sleepTimer[pair.b]));
+        }
+
+        // Put rested islands to sleep, linking each island's balls into a ring
+        islandHead.resize(count);
+        islandTail.assign(count, noBall);
+        for (uint32_t i = 0; i < count; i++) {
+            // A ball that has not rested long enough keeps its whole island awake
+            if (sleeping[i] || sleepTimer[i] < sleepTime) continue;
+            const uint32_t root = find(i);
+            if (islandRest[root] < sleepTime) continue;
+
+            sleeping[i] = 1;
+            balls.vx[i] = 0.0f;
+            balls.vy[i] = 0.0f;
+            if (islandTail[root] == noBall) islandHead[root] = i;
+            else balls.islandNext[islandTail[root]] = i;
+            islandTail[root] = i;
+        }
+        for (uint32_t root = 0; root < count; root++) {
+            if (islandTail[root] != noBall) balls.islandNext[islandTail[root]] = islandHead[root];
+        }
+
+        countSleeping(balls);
+    }
+
+    /**
+     * @brief Wakes every ball.
+     *
+     * @param balls System to wake.
+     */
+    void wakeAll(BallSystem& balls) {
+        for (std::size_t i = 0; i < balls.size(); i++) {
+            balls.sleeping[i] = 0;
+            balls.sleepTimer[i] = 0.0f;
+            balls.islandNext[i] = static_cast<uint32_t>(i);
+        }
+        sleepingCount = 0;
+        activeCount = balls.size();
+    }
+
+    std::size_t getSleepingCount() const { return sleepingCount; }
+    std::size_t getActiveCount() const { return activeCount; }
+
+private:
+    static constexpr uint32_t noBall = 0xffffffffu;
+
+    /**
+     * @brief Finds the root of a ball's island, halving the path on the way.
+     */
+    uint32_t find(uint32_t i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    /**
+     * @brief Merges the islands of two balls.
+     */
+    void unite(uint32_t a, uint32_t b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) return;
+        // The lower index becomes the root, which keeps island order independent of pair order
+        if (a < b) parent[b] = a;
+        else parent[a] = b;
+    }
+
+    /**
+     * @brief Recounts the active and sleeping balls.
+     */
+    void countSleeping(const BallSystem& balls) {
+        std::size_t asleep = 0;
+        for (std::size_t i = 0; i < balls.size(); i++) {
+            asleep += balls.sleeping[i];
+        }
+        sleepingCount = asleep;
+        activeCount = balls.size() - asleep;
+    }
+
+    std::vector<uint32_t> parent;     /* Union-find parent of each ball */
+    std::vector<float> islandRest;    /* Shortest rest time in each island, indexed by root */
+    std::vector<uint32_t> islandHead; /* First ball of each island falling asleep, indexed by root */
+    std::vector<uint32_t> islandTail; /* Last ball of each island falling asleep, indexed by root */
+    std::size_t sleepingCount = 0;    /* Sleeping balls after the last update */
+    std::size_t activeCount = 0;      /* Awake balls after the last update */
+};
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef SWEEP_AND_PRUNE_BROADPHASE_H
+#define SWEEP_AND_PRUNE_BROADPHASE_H
+
+#include <algorithm>
+#include <vector>
+#include "Broadphase.h"
+
+/**
+ * @class SweepAndPruneBroadphase
+ * @brief Sorts ball intervals on the x axis and sweeps them to find overlaps.
+ *
+ * The sorted endpoint list is kept between steps and re-sorted with insertion
+ * sort, which is close to O(N) when balls barely move (settled piles). The sweep
+ * then only tests balls whose x intervals overlap, so a coherent scene costs
+ * roughly O(N + overlaps). The number of endpoint swaps is reported in the stats.
+ */
+class SweepAndPruneBroadphase : public Broadphase {
+public:
+    void findPairs(const BallSystem& balls, std::vector<BallPair>& pairs) override {
+        pairs.clear();
+        stats.pairTests = 0;
+        stats.endpointSwaps = 0;
+
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        if (endpoints.size() != 2 * static_cast<std::size_t>(count)) {
+            rebuildEndpoints(balls);
+        }
+        else {
+            updateEndpoints(balls);
+            insertionSort();
+        }
+
+        sweep(balls, pairs);
+        stats.pairsFound = pairs.size();
+    }
+
+    const char* getName() const override { return "sweep-and-prune"; }
+
+private:
+    /**
+     * @struct Endpoint
+     * @brief One end of a ball's x interval.
+     */
+    struct Endpoint {
+        float value;  /* x coordinate of the endpoint */
+        uint32_t key; /* Ball index in the low 31 bits, top bit set for a max endpoint */
+    };
+
+    static constexpr uint32_t maxFlag = 0x80000000u;
+
+    /**
+     * @brief Recreates and fully sorts the endpoint list, used when the ball count changes.
+     */
+    void rebuildEndpoints(const BallSystem& balls) {
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        endpoints.resize(2 * static_cast<std::size_t>(count));
+        for (uint32_t i = 0; i < count; i++) {
+            endpoints[2 * i] = { balls.x[i] - balls.radius[i], i };
+            endpoints[2 * i + 1] = { balls.x[i] + balls.radius[i], i | maxFlag };
+        }
+        std::sort(endpoints.begin(), endpoints.end(), [](const Endpoint& a, const Endpoint& b) {
+            return a.value < b.value;
+        });
+        activeSlot.assign(count, 0);
+    }
+
+    /**
+     * @brief Refreshes endpoint values from the current positions, keeping their order.
+     *
+     * Sleeping balls do not move, so their endpoints are left as they are.
+     */
+    void updateEndpoints(const BallSystem& balls) {
+        for (Endpoint& endpoint : endpoints) {
+            const uint32_t ball = endpoint.key & ~maxFlag;
+            if (balls.sleeping[ball]) continue;
+            endpoint.value = (endpoint.key & maxFlag) ? balls.x[ball] + balls.radius[ball] : balls.x[ball] - balls.radius[ball];
+        }
+    }
+
+    /**
+     * @brief Restores the sort order; nearly linear for a nearly sorted list.
+     */
+    void insertionSort() {
+        std::size_t swaps = 0;
+        for (std::size_t i = 1; i < endpoints.size(); i++) {
+            const Endpoint endpoint = endpoints[i];
+            std::size_t j = i;
+            while (j > 0 && endpoints[j - 1].value > endpoint.value) {
+                endpoints[j] = endpoints[j - 1];
+                j--;
+            }
+            swaps += i - j;
+            endpoints[j] = endpoint;
+        }
+        stats.endpointSwaps = swaps;
+    }
+
+    /**
+     * @brief Walks the endpoints keeping the set of open intervals and tests new intervals against it.
+     */
+    void sweep(const BallSystem& balls, std::vector<BallPair>& pairs) {
+        active.clear();
+        for (const Endpoint& endpoint : endpoints) {
+            const uint32_t ball = endpoint.key & ~maxFlag;
+
+            if (endpoint.key & maxFlag) {
+                // Interval closes: swap-remove it from the active set
+                const uint32_t slot = activeSlot[ball];
+                const uint32_t last = active.back();
+                active[slot] = last;
+                activeSlot[last] = slot;
+                active.pop_back();
+                continue;
+            }
+
+            // Interval opens: everything still active overlaps it on x
+            const float minY = balls.y[ball] - balls.radius[ball];
+            const float maxY = balls.y[ball] + balls.radius[ball];
+            for (uint32_t other : active) {
+                if (balls.y[other] + balls.radius[other] < minY || balls.y[other] - balls.radius[other] > maxY) continue;
+                testPair(balls, ball, other, pairs, stats.pairTests);
+            }
+            activeSlot[ball] = static_cast<uint32_t>(active.size());
+            active.push_back(ball);
+        }
+    }
+
+    std::vector<Endpoint> endpoints;  /* Interval endpoints sorted by x, kept between steps */
+    std::vector<uint32_t> active;     /* Balls whose interval is open during the sweep */
+    std::vector<uint32_t> activeSlot; /* Position of each ball in the active list */
+};
+
+#endif
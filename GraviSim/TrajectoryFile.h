@@ -0,0 +1,310 @@
+#ifndef TRAJECTORY_FILE_H
+#define TRAJECTORY_FILE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Checksum.h"
+#include "EntropyCoder.h"
+
+// -----------------------------------------------
+// TRAJECTORY FILES
+// The positions of every ball at every recorded
+// step, quantized and compressed in chunks that
+// each decode on their own.
+//
+// Layout:
+//   TrajectoryFileHeader
+//   radius, colorR, colorG, colorB    float[ballCount] each, constant over the run
+//   chunks                            TrajectoryChunkHeader, then its payload
+//
+// A chunk payload holds:
+//   frameCount - 1 varints            step of each frame after the first, minus the step before
+//   keyframe low bytes                coded block, the first frame's quantized x then y
+//   keyframe high bytes               coded block
+//   delta low bytes                   coded block, every later frame minus the frame before, zigzagged
+//   delta high bytes                  coded block
+//
+// The index file next to it, named by appending
+// ".idx", holds a TrajectoryIndexHeader and one
+// TrajectoryIndexEntry per chunk, so a reader can
+// seek to any step without scanning the chunks.
+// -----------------------------------------------
+
+constexpr uint32_t trajectoryFileVersion = 1;
+constexpr uint32_t trajectoryChunkMagic = 0x4b484354; /* "TCHK" */
+
+/**
+ * @struct TrajectoryFileHeader
+ * @brief First bytes of a trajectory file.
+ */
+struct TrajectoryFileHeader {
+    char magic[8];           /* "GRVTRAJ\0" */
+    uint32_t version;        /* trajectoryFileVersion */
+    uint32_t headerSize;     /* sizeof(TrajectoryFileHeader) */
+    uint64_t ballCount;      /* Balls in every frame */
+    uint32_t positionBits;   /* Bits per quantized coordinate, 8 to 16 */
+    uint32_t framesPerChunk; /* Frames between keyframes */
+    float deltaTime;         /* Length of one simulation step */
+    uint32_t headerCrc;      /* CRC-32 of the header with this field zeroed */
+    uint32_t reserved[4];
+};
+static_assert(sizeof(TrajectoryFileHeader) == 56, "TrajectoryFileHeader layout changed");
+
+/**
+ * @struct TrajectoryChunkHeader
+ * @brief Precedes each chunk of frames.
+ */
+struct TrajectoryChunkHeader {
+    uint32_t magic;       /* trajectoryChunkMagic */
+    uint32_t frameCount;  /* Frames in the chunk, the first is a keyframe */
+    uint64_t firstStep;   /* Simulation step of the keyframe */
+    uint64_t payloadSize; /* Bytes of coded data after this header */
+    uint32_t payloadCrc;  /* CRC-32 of the payload */
+    uint32_t reserved;
+};
+static_assert(sizeof(TrajectoryChunkHeader) == 32, "TrajectoryChunkHeader layout changed");
+
+/**
+ * @struct TrajectoryIndexHeader
+ * @brief First bytes of a trajectory index file.
+ */
+struct TrajectoryIndexHeader {
+    char magic[8];      /* "GRVTIDX\0" */
+    uint32_t version;   /* trajectoryFileVersion */
+    uint32_t entrySize; /* sizeof(TrajectoryIndexEntry) */
+};
+static_assert(sizeof(TrajectoryIndexHeader) == 16, "TrajectoryIndexHeader layout changed");
+
+/**
+ * @struct TrajectoryIndexEntry
+ * @brief Where one chunk of a trajectory file is and which steps it holds.
+ */
+struct TrajectoryIndexEntry {
+    uint64_t firstStep;  /* Step of the chunk's keyframe */
+    uint64_t lastStep;   /* Step of the chunk's last frame */
+    uint64_t offset;     /* File offset of the chunk header */
+    uint64_t size;       /* Bytes of the chunk, header included */
+    uint32_t frameCount; /* Frames in the chunk */
+    uint32_t reserved;
+};
+static_assert(sizeof(TrajectoryIndexEntry) == 40, "TrajectoryIndexEntry layout changed");
+
+/**
+ * @brief Gets the name of the index file of a trajectory file.
+ */
+inline std::string getTrajectoryIndexPath(const std::string& path) {
+    return path + ".idx";
+}
+
+/**
+ * @brief Computes the header CRC, which covers the header with headerCrc zeroed.
+ */
+inline uint32_t computeTrajectoryHeaderCrc(TrajectoryFileHeader header) {
+    header.headerCrc = 0;
+    return updateCrc32(0, &header, sizeof(header));
+}
+
+/**
+ * @brief Gets the largest quantized value for a number of bits per coordinate.
+ */
+inline uint32_t getQuantizationLevels(uint32_t positionBits) {
+    return (1u << positionBits) - 1;
+}
+
+/**
+ * @brief Maps a coordinate in the [-1, 1] world box to a quantized value, clamping outliers.
+ */
+inline uint16_t quantizePosition(float position, uint32_t levels) {
+    const float unit = (std::min(std::max(position, -1.0f), 1.0f) + 1.0f) * 0.5f;
+    return static_cast<uint16_t>(std::lround(unit * levels));
+}
+
+/**
+ * @brief Maps a quantized value back to a coordinate in the world box.
+ */
+inline float dequantizePosition(uint16_t value, uint32_t levels) {
+    return static_cast<float>(value) / levels * 2.0f - 1.0f;
+}
+
+/**
+ * @brief Maps a difference of quantized values to an unsigned value, small magnitudes first.
+ *
+ * Differences wrap modulo 2^16, so any value can follow any other.
+ */
+inline uint16_t zigzagDelta(uint16_t current, uint16_t previous) {
+    const int16_t delta = static_cast<int16_t>(static_cast<uint16_t>(current - previous));
+    return static_cast<uint16_t>((static_cast<uint16_t>(delta) << 1) ^ static_cast<uint16_t>(delta >> 15));
+}
+
+/**
+ * @brief Applies a zigzagged difference to the previous quantized value.
+ */
+inline uint16_t unzigzagDelta(uint16_t zigzag, uint16_t previous) {
+    const uint16_t delta = static_cast<uint16_t>((zigzag >> 1) ^ (0u - (zigzag & 1u)));
+    return static_cast<uint16_t>(previous + delta);
+}
+
+/**
+ * @class TrajectoryChunkEncoder
+ * @brief Collects quantized frames and codes them into one chunk payload.
+ *
+ * The first frame of a chunk is stored whole, later frames as zigzagged
+ * differences to the frame before. Ball positions change little per step, so
+ * the high bytes of the differences are almost all zero and the low bytes
+ * cluster near zero; each byte plane gets its own entropy coded block.
+ */
+class TrajectoryChunkEncoder {
+public:
+    /**
+     * @brief Starts collecting frames of a number of balls, with room for whole chunks.
+     *
+     * @param ballCount Balls in every frame.
+     * @param framesPerChunk Frames the caller collects before finish; the byte planes are reserved for them.
+     */
+    void reset(std::size_t ballCount, std::size_t framesPerChunk) {
+        valuesPerFrame = ballCount * 2;
+        maxFrames = std::max<std::size_t>(framesPerChunk, 1);
+        previous.assign(valuesPerFrame, 0);
+        keyLow.reserve(valuesPerFrame);
+        keyHigh.reserve(valuesPerFrame);
+        deltaLow.reserve(valuesPerFrame * (maxFrames - 1));
+        deltaHigh.reserve(valuesPerFrame * (maxFrames - 1));
+        steps.reserve(10 * maxFrames);
+        clear();
+    }
+
+    /**
+     * @brief Gets an upper bound on the payload of a chunk of the reserved size, for reserving the buffer finish fills.
+     */
+    std::size_t getMaxPayloadSize() const {
+        const std::size_t deltaBytes = valuesPerFrame * (maxFrames - 1);
+        return 10 * maxFrames + 2 * EntropyCoder::getMaxEncodedSize(valuesPerFrame) + 2 * EntropyCoder::getMaxEncodedSize(deltaBytes);
+    }
+
+    /**
+     * @brief Adds a frame of quantized positions, x of every ball then y of every ball.
+     *
+     * @param values valuesPerFrame quantized coordinates.
+     * @param step Simulation step of the frame.
+     */
+    void addFrame(const uint16_t* values, uint64_t step) {
+        if (frameCount == 0) {
+            firstStep = step;
+            for (std::size_t i = 0; i < valuesPerFrame; i++) {
+                keyLow.push_back(static_cast<uint8_t>(values[i]));
+                keyHigh.push_back(static_cast<uint8_t>(values[i] >> 8));
+            }
+        }
+        else {
+            writeVarint(steps, step - lastStep);
+            for (std::size_t i = 0; i < valuesPerFrame; i++) {
+                const uint16_t zigzag = zigzagDelta(values[i], previous[i]);
+                deltaLow.push_back(static_cast<uint8_t>(zigzag));
+                deltaHigh.push_back(static_cast<uint8_t>(zigzag >> 8));
+            }
+        }
+        std::copy(values, values + valuesPerFrame, previous.begin());
+        lastStep = step;
+        frameCount++;
+    }
+
+    /**
+     * @brief Codes the collected frames and starts a new chunk.
+     *
+     * @param header Receives the chunk header.
+     * @param payload Receives the coded frames, replacing its contents.
+     */
+    void finish(TrajectoryChunkHeader& header, std::vector<uint8_t>& payload) {
+        payload.assign(steps.begin(), steps.end());
+        EntropyCoder::encode(keyLow.data(), keyLow.size(), payload);
+        EntropyCoder::encode(keyHigh.data(), keyHigh.size(), payload);
+        EntropyCoder::encode(deltaLow.data(), deltaLow.size(), payload);
+        EntropyCoder::encode(deltaHigh.data(), deltaHigh.size(), payload);
+
+        header = {};
+        header.magic = trajectoryChunkMagic;
+        header.frameCount = frameCount;
+        header.firstStep = firstStep;
+        header.payloadSize = payload.size();
+        header.payloadCrc = updateCrc32(0, payload.data(), payload.size());
+        clear();
+    }
+
+    uint32_t getFrameCount() const { return frameCount; }
+    uint64_t getLastStep() const { return lastStep; }
+
+private:
+    void clear() {
+        keyLow.clear();
+        keyHigh.clear();
+        deltaLow.clear();
+        deltaHigh.clear();
+        steps.clear();
+        frameCount = 0;
+    }
+
+    std::size_t valuesPerFrame = 0;  /* Quantized coordinates per frame */
+    std::size_t maxFrames = 1;       /* Frames per chunk the buffers are reserved for */
+    std::vector<uint16_t> previous;  /* Last frame added */
+    std::vector<uint8_t> keyLow;     /* Byte planes of the keyframe */
+    std::vector<uint8_t> keyHigh;
+    std::vector<uint8_t> deltaLow;   /* Byte planes of the later frames' differences */
+    std::vector<uint8_t> deltaHigh;
+    std::vector<uint8_t> steps;      /* Step differences as varints */
+    uint32_t frameCount = 0;         /* Frames in the current chunk */
+    uint64_t firstStep = 0;          /* Step of the keyframe */
+    uint64_t lastStep = 0;           /* Step of the last frame added */
+};
+
+/**
+ * @brief Decodes a chunk payload into its frames.
+ *
+ * @param header Header of the chunk.
+ * @param payload The payload, header.payloadSize bytes.
+ * @param ballCount Balls in every frame.
+ * @param steps Receives the simulation step of each frame.
+ * @param values Receives the quantized frames, 2 * ballCount values each, x then y.
+ * @return False if the payload is corrupt or does not match the header.
+ */
+inline bool decodeTrajectoryChunk(const TrajectoryChunkHeader& header, const uint8_t* payload, std::size_t ballCount,
+                                  std::vector<uint64_t>& steps, std::vector<uint16_t>& values) {
+    if (header.magic != trajectoryChunkMagic || header.frameCount == 0) return false;
+    const std::size_t valuesPerFrame = ballCount * 2;
+    const uint8_t* in = payload;
+    const uint8_t* end = payload + header.payloadSize;
+
+    steps.resize(header.frameCount);
+    steps[0] = header.firstStep;
+    for (uint32_t frame = 1; frame < header.frameCount; frame++) {
+        uint64_t stepDelta = 0;
+        if (!readVarint(in, end, stepDelta)) return false;
+        steps[frame] = steps[frame - 1] + stepDelta;
+    }
+
+    std::vector<uint8_t> planes[4];
+    for (std::vector<uint8_t>& plane : planes) {
+        if (!EntropyCoder::decode(in, end, plane)) return false;
+    }
+    const std::size_t deltaCount = valuesPerFrame * (header.frameCount - 1);
+    if (in != end || planes[0].size() != valuesPerFrame || planes[1].size() != valuesPerFrame
+        || planes[2].size() != deltaCount || planes[3].size() != deltaCount) {
+        return false;
+    }
+
+    values.resize(valuesPerFrame * header.frameCount);
+    for (std::size_t i = 0; i < valuesPerFrame; i++) {
+        values[i] = static_cast<uint16_t>(planes[0][i] | (planes[1][i] << 8));
+    }
+    for (std::size_t i = 0; i < deltaCount; i++) {
+        const uint16_t zigzag = static_cast<uint16_t>(planes[2][i] | (planes[3][i] << 8));
+        values[valuesPerFrame + i] = unzigzagDelta(zigzag, values[i]);
+    }
+    return true;
+}
+
+#endif
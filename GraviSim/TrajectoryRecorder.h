@@ -0,0 +1,357 @@
+#ifndef TRAJECTORY_RECORDER_H
+#define TRAJECTORY_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BallSystem.h"
+#include "TrajectoryFile.h"
+
+/**
+ * @brief What the recorder does with a step when its queue is full.
+ */
+enum class RecorderOverflow {
+    Drop, /* Skip the step, so the simulation never waits for the disk */
+    Block /* Wait for a free slot, so no step is lost */
+};
+
+/**
+ * @struct RecorderSettings
+ * @brief Controls the precision, chunking and queueing of a trajectory recording.
+ */
+struct RecorderSettings {
+    uint32_t positionBits = 16;                         /* Bits per quantized coordinate, 8 to 16 */
+    uint32_t framesPerChunk = 64;                       /* Frames between keyframes */
+    std::size_t queueFrames = 64;                       /* Slots in the ring, one is kept free */
+    RecorderOverflow overflow = RecorderOverflow::Drop; /* What a full ring does to a step */
+};
+
+/**
+ * @struct RecorderStats
+ * @brief Work done by a trajectory recorder so far.
+ */
+struct RecorderStats {
+    uint64_t framesRecorded = 0;  /* Frames written to the file */
+    uint64_t framesDropped = 0;   /* Steps skipped because the ring was full or the ball count changed */
+    uint64_t blockedSteps = 0;    /* Steps that waited for a slot */
+    uint64_t chunks = 0;          /* Chunks written */
+    uint64_t rawBytes = 0;        /* Bytes the recorded positions take as floats */
+    uint64_t compressedBytes = 0; /* Bytes written to the trajectory file, headers included */
+    double seconds = 0.0;         /* Wall time since the recording started */
+    bool failed = false;          /* A write failed; later frames are discarded */
+
+    double getCompressionRatio() const {
+        return compressedBytes > 0 ? static_cast<double>(rawBytes) / compressedBytes : 0.0;
+    }
+
+    double getBytesPerSecond() const {
+        return seconds > 0.0 ? compressedBytes / seconds : 0.0;
+    }
+};
+
+/**
+ * @class TrajectoryRecorder
+ * @brief Streams the positions of every ball at every step to a trajectory file.
+ *
+ * record copies the positions into a slot of a lock-free single-producer,
+ * single-consumer ring and returns; quantizing, delta and entropy coding and
+ * writing all happen on the recorder thread, so the step only pays for the
+ * copy. When the recorder thread falls behind and the ring is full, the
+ * overflow policy decides whether the step is dropped or waits for a slot.
+ * Dropped steps leave a gap in the step numbers stored with each frame.
+ *
+ * Each chunk's steps and offset are appended to an index file as it is
+ * written, so a replay can seek without scanning the recording.
+ *
+ * The radius and color of each ball are written once in the file header, so
+ * the ball count must not change while recording; steps with a different
+ * count are dropped.
+ */
+class TrajectoryRecorder {
+public:
+    TrajectoryRecorder() = default;
+    TrajectoryRecorder(const TrajectoryRecorder&) = delete;
+    TrajectoryRecorder& operator=(const TrajectoryRecorder&) = delete;
+
+    ~TrajectoryRecorder() {
+        close();
+    }
+
+    /**
+     * @brief Creates a trajectory file, writes the balls' constant attributes and starts the recorder thread.
+     *
+     * @param path File to write.
+     * @param balls Balls to record; their count is fixed for the recording.
+     * @param deltaTime Length of one simulation step, stored for playback.
+     * @param recorderSettings Precision, chunking and queueing.
+     * @return False if the settings are invalid or the file cannot be written.
+     */
+    bool open(const std::string& path, const BallSystem& balls, float deltaTime, const RecorderSettings& recorderSettings = RecorderSettings()) {
+        close();
+        settings = recorderSettings;
+        if (settings.positionBits < 8 || settings.positionBits > 16 || settings.framesPerChunk == 0 || settings.queueFrames < 2) {
+            std::cerr << "ERROR::TRAJECTORY_RECORDER::INVALID_SETTINGS" << std::endl;
+            return false;
+        }
+
+        file = std::fopen(path.c_str(), "wb");
+        indexFile = std::fopen(getTrajectoryIndexPath(path).c_str(), "wb");
+        if (!file || !indexFile) {
+            std::cerr << "ERROR::TRAJECTORY_RECORDER::OPEN_FAILED " << path << std::endl;
+            closeFiles();
+            return false;
+        }
+
+        ballCount = balls.size();
+        TrajectoryFileHeader header = {};
+        std::memcpy(header.magic, "GRVTRAJ", 8);
+        header.version = trajectoryFileVersion;
+        header.headerSize = sizeof(TrajectoryFileHeader);
+        header.ballCount = ballCount;
+        header.positionBits = settings.positionBits;
+        header.framesPerChunk = settings.framesPerChunk;
+        header.deltaTime = deltaTime;
+        header.headerCrc = computeTrajectoryHeaderCrc(header);
+
+        TrajectoryIndexHeader indexHeader = {};
+        std::memcpy(indexHeader.magic, "GRVTIDX", 8);
+        indexHeader.version = trajectoryFileVersion;
+        indexHeader.entrySize = sizeof(TrajectoryIndexEntry);
+
+        resetStats();
+        bool written = write(&header, sizeof(header));
+        const AlignedArray<float>* attributes[] = { &balls.radius, &balls.colorR, &balls.colorG, &balls.colorB };
+        for (const AlignedArray<float>* attribute : attributes) {
+            written = written && write(attribute->data(), ballCount * sizeof(float));
+        }
+        written = written && writeIndex(&indexHeader, sizeof(indexHeader));
+        if (!written) {
+            closeFiles();
+            return false;
+        }
+
+        slots.resize(settings.queueFrames);
+        for (FrameSlot& slot : slots) {
+            slot.x.resize(ballCount);
+            slot.y.resize(ballCount);
+        }
+        head.store(0);
+        tail.store(0);
+        startTime = std::chrono::steady_clock::now();
+        running.store(true);
+        thread = std::thread([this]() { run(); });
+        return true;
+    }
+
+    /**
+     * @brief Writes the frames still queued, closes the file and stops the recorder thread.
+     */
+    void close() {
+        if (!thread.joinable()) return;
+        running.store(false, std::memory_order_release);
+        thread.join();
+        closeFiles();
+        seconds.store(std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    bool isOpen() const { return thread.joinable(); }
+
+    /**
+     * @brief Queues the balls' current positions. Only one thread may record.
+     *
+     * @param balls Balls to record, with the count the recording was opened with.
+     * @param step Simulation step the positions belong to.
+     * @return False if the step was dropped.
+     */
+    bool record(const BallSystem& balls, uint64_t step) {
+        if (!isOpen()) return false;
+        if (balls.size() != ballCount) {
+            framesDropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        const std::size_t current = tail.load(std::memory_order_relaxed);
+        const std::size_t next = (current + 1) % slots.size();
+        if (next == head.load(std::memory_order_acquire)) {
+            if (settings.overflow == RecorderOverflow::Drop) {
+                framesDropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            blockedSteps.fetch_add(1, std::memory_order_relaxed);
+            while (next == head.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+        }
+
+        FrameSlot& slot = slots[current];
+        slot.step = step;
+        if (ballCount > 0) {
+            std::memcpy(slot.x.data(), balls.x.data(), ballCount * sizeof(float));
+            std::memcpy(slot.y.data(), balls.y.data(), ballCount * sizeof(float));
+        }
+        tail.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Gets the work done so far; the recorder thread may still be adding to it.
+     */
+    RecorderStats getStats() const {
+        RecorderStats stats;
+        stats.framesRecorded = framesRecorded.load(std::memory_order_relaxed);
+        stats.framesDropped = framesDropped.load(std::memory_order_relaxed);
+        stats.blockedSteps = blockedSteps.load(std::memory_order_relaxed);
+        stats.chunks = chunks.load(std::memory_order_relaxed);
+        stats.rawBytes = stats.framesRecorded * ballCount * 2 * sizeof(float);
+        stats.compressedBytes = compressedBytes.load(std::memory_order_relaxed);
+        stats.seconds = isOpen() ? std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count()
+                                 : seconds.load(std::memory_order_relaxed);
+        stats.failed = failed.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    /**
+     * @struct FrameSlot
+     * @brief Positions of one step waiting in the ring.
+     */
+    struct FrameSlot {
+        uint64_t step = 0;    /* Simulation step of the positions */
+        std::vector<float> x; /* Horizontal position of each ball */
+        std::vector<float> y; /* Vertical position of each ball */
+    };
+
+    /**
+     * @brief Body of the recorder thread: codes queued frames until closed, then the rest.
+     */
+    void run() {
+        const uint32_t levels = getQuantizationLevels(settings.positionBits);
+        std::vector<uint16_t> quantized(ballCount * 2);
+        // Every chunk fits the buffers reserved here, so recording a step does not allocate
+        encoder.reset(ballCount, settings.framesPerChunk);
+        payload.reserve(encoder.getMaxPayloadSize());
+
+        while (true) {
+            // Read the flag before the ring, so a frame queued before close is never missed
+            const bool stopping = !running.load(std::memory_order_acquire);
+            std::size_t current = head.load(std::memory_order_relaxed);
+            if (current == tail.load(std::memory_order_acquire)) {
+                if (stopping) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+
+            const FrameSlot& slot = slots[current];
+            for (std::size_t i = 0; i < ballCount; i++) {
+                quantized[i] = quantizePosition(slot.x[i], levels);
+                quantized[ballCount + i] = quantizePosition(slot.y[i], levels);
+            }
+            const uint64_t step = slot.step;
+            head.store((current + 1) % slots.size(), std::memory_order_release);
+
+            encoder.addFrame(quantized.data(), step);
+            if (encoder.getFrameCount() == settings.framesPerChunk) {
+                writeChunk();
+            }
+        }
+        if (encoder.getFrameCount() > 0) {
+            writeChunk();
+        }
+    }
+
+    /**
+     * @brief Codes the frames collected so far and appends them as a chunk.
+     */
+    void writeChunk() {
+        TrajectoryIndexEntry entry = {};
+        entry.lastStep = encoder.getLastStep();
+        entry.offset = compressedBytes.load(std::memory_order_relaxed);
+
+        TrajectoryChunkHeader header;
+        encoder.finish(header, payload);
+        entry.firstStep = header.firstStep;
+        entry.size = sizeof(header) + payload.size();
+        entry.frameCount = header.frameCount;
+        // The index entry follows the chunk, so it never points past the data written
+        if (write(&header, sizeof(header)) && write(payload.data(), payload.size()) && writeIndex(&entry, sizeof(entry))) {
+            framesRecorded.fetch_add(header.frameCount, std::memory_order_relaxed);
+            chunks.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Appends bytes to the file, unless an earlier write failed.
+     */
+    bool write(const void* data, std::size_t size) {
+        if (failed.load(std::memory_order_relaxed)) return false;
+        if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+            std::cerr << "ERROR::TRAJECTORY_RECORDER::WRITE_FAILED" << std::endl;
+            failed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        compressedBytes.fetch_add(size, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Appends bytes to the index file, unless an earlier write failed.
+     */
+    bool writeIndex(const void* data, std::size_t size) {
+        if (failed.load(std::memory_order_relaxed)) return false;
+        if (std::fwrite(data, 1, size, indexFile) != size) {
+            std::cerr << "ERROR::TRAJECTORY_RECORDER::WRITE_FAILED" << std::endl;
+            failed.store(true, std::memory_order_relaxed);
+            return false;
+        }
+        return true;
+    }
+
+    void closeFiles() {
+        if (file) {
+            std::fclose(file);
+            file = nullptr;
+        }
+        if (indexFile) {
+            std::fclose(indexFile);
+            indexFile = nullptr;
+        }
+    }
+
+    void resetStats() {
+        framesRecorded.store(0);
+        framesDropped.store(0);
+        blockedSteps.store(0);
+        chunks.store(0);
+        compressedBytes.store(0);
+        seconds.store(0.0);
+        failed.store(false);
+    }
+
+    RecorderSettings settings;                   /* Settings of the current recording */
+    std::size_t ballCount = 0;                   /* Balls in every frame */
+    std::FILE* file = nullptr;                   /* Trajectory file being written */
+    std::FILE* indexFile = nullptr;              /* Its index of chunks */
+    std::thread thread;                          /* The recorder thread */
+    std::atomic<bool> running{ false };          /* Cleared to finish the recording */
+    std::vector<FrameSlot> slots;                /* Ring of queued frames */
+    std::atomic<std::size_t> head{ 0 };          /* Next frame to code, advanced by the recorder thread */
+    std::atomic<std::size_t> tail{ 0 };          /* Next free slot, advanced by the recording thread */
+    TrajectoryChunkEncoder encoder;              /* Chunk being collected, recorder thread only */
+    std::vector<uint8_t> payload;                /* Coded chunk, recorder thread only */
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<uint64_t> framesRecorded{ 0 };
+    std::atomic<uint64_t> framesDropped{ 0 };
+    std::atomic<uint64_t> blockedSteps{ 0 };
+    std::atomic<uint64_t> chunks{ 0 };
+    std::atomic<uint64_t> compressedBytes{ 0 };
+    std::atomic<double> seconds{ 0.0 };          /* Length of the finished recording */
+    std::atomic<bool> failed{ false };
+};
+
+#endif
@@ -0,0 +1,500 @@
+#ifndef TRAJECTORY_REPLAY_H
+#define TRAJECTORY_REPLAY_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Parallel.h"
+#include "SimulationThread.h"
+#include "TrajectoryFile.h"
+
+/**
+ * @class TrajectoryReplay
+ * @brief Plays a trajectory file back as simulation snapshots, at any speed and from any step.
+ *
+ * The chunk index is read from the index file written with the recording, so
+ * seeking finds the chunk holding a step directly, or by binary search once
+ * dropped steps have shifted the chunks, and then decodes only that chunk:
+ * one keyframe and at most framesPerChunk - 1 deltas. Chunks the index does
+ * not list, e.g. after a crash, are found by scanning the chunk headers that
+ * follow the last indexed chunk.
+ *
+ * A decoder thread reads and decodes the chunks ahead of the playback
+ * position, in the direction of play, into a small cache, so steady playback
+ * never waits for the disk or the entropy decoder; only a seek far away does.
+ * Positions between two recorded frames are interpolated and velocities are
+ * taken from the difference of the two frames, so the direction lines still
+ * render.
+ */
+class TrajectoryReplay {
+public:
+    /**
+     * @struct ReplayStats
+     * @brief Decoding work done so far.
+     */
+    struct ReplayStats {
+        uint64_t chunksDecoded = 0; /* Chunks read and decoded by the decoder thread */
+        uint64_t waits = 0;         /* Chunks the playback needed before they were decoded */
+        double waitMs = 0.0;        /* Time the playback spent waiting for them */
+        double decodeMs = 0.0;      /* Time the decoder thread spent reading and decoding */
+    };
+
+    float speed = 1.0f;  /* Recorded steps played per step of wall time; negative plays backwards */
+    bool paused = false; /* Keep the playback position */
+
+    TrajectoryReplay() = default;
+    TrajectoryReplay(const TrajectoryReplay&) = delete;
+    TrajectoryReplay& operator=(const TrajectoryReplay&) = delete;
+
+    ~TrajectoryReplay() {
+        close();
+    }
+
+    /**
+     * @brief Opens a trajectory file and its index, and starts the decoder thread.
+     *
+     * @param path Trajectory file to play.
+     * @param prefetchChunks Chunks decoded ahead of the playback position.
+     * @return False if the file is missing, invalid or holds no frames.
+     */
+    bool open(const std::string& path, std::size_t prefetchChunks = 4) {
+        close();
+        file.open(path, std::ios::binary);
+        if (!file) {
+            std::cerr << "ERROR::TRAJECTORY_REPLAY::OPEN_FAILED " << path << std::endl;
+            return false;
+        }
+        file.seekg(0, std::ios::end);
+        fileSize = static_cast<uint64_t>(file.tellg());
+        file.seekg(0);
+
+        if (!readHeader()) {
+            std::cerr << "ERROR::TRAJECTORY_REPLAY::INVALID_HEADER " << path << std::endl;
+            file.close();
+            return false;
+        }
+        chunks.clear();
+        loadIndex(getTrajectoryIndexPath(path));
+        const std::size_t indexedChunks = chunks.size();
+        scanChunks();
+        scannedChunks = chunks.size() - indexedChunks;
+        if (chunks.empty()) {
+            std::cerr << "ERROR::TRAJECTORY_REPLAY::NO_FRAMES " << path << std::endl;
+            file.close();
+            return false;
+        }
+
+        prefetchCount = prefetchChunks;
+        cacheCapacity = prefetchChunks * 2 + 2;
+        cache.clear();
+        pending.clear();
+        stats = ReplayStats();
+        position = static_cast<double>(chunks.front().firstStep);
+        currentChunk = 0;
+        scheduledChunk = chunks.size();
+        running = true;
+        thread = std::thread([this]() { run(); });
+        return true;
+    }
+
+    /**
+     * @brief Stops the decoder thread and closes the file.
+     */
+    void close() {
+        if (!thread.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running = false;
+        }
+        requested.notify_all();
+        thread.join();
+        file.close();
+        cache.clear();
+    }
+
+    bool isOpen() const { return thread.joinable(); }
+    std::size_t getBallCount() const { return ballCount; }
+    float getDeltaTime() const { return deltaTime; }
+    uint64_t getFirstStep() const { return chunks.front().firstStep; }
+    uint64_t getLastStep() const { return chunks.back().lastStep; }
+    std::size_t getChunkCount() const { return chunks.size(); }
+    std::size_t getScannedChunkCount() const { return scannedChunks; }
+    double getPosition() const { return position; }
+
+    ReplayStats getStats() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return stats;
+    }
+
+    /**
+     * @brief Moves the playback position to a step, clamped to the recording.
+     *
+     * @param step Step to show; fractions are interpolated.
+     */
+    void seek(double step) {
+        position = std::min(std::max(step, static_cast<double>(getFirstStep())), static_cast<double>(getLastStep()));
+    }
+
+    /**
+     * @brief Moves the playback position by the wall time that passed, scaled by speed.
+     *
+     * @param frameTime Wall time of the last frame in seconds.
+     */
+    void advance(float frameTime) {
+        if (paused || deltaTime <= 0.0f) return;
+        seek(position + frameTime / deltaTime * speed);
+    }
+
+    /**
+     * @brief Fills a snapshot with the balls at the playback position.
+     *
+     * Waits for the decoder thread if the chunks needed are not decoded yet.
+     *
+     * @param snapshot Snapshot to fill, reusing its storage.
+     * @return False if a chunk needed is corrupt; the snapshot is left unchanged.
+     */
+    bool fillSnapshot(SimulationSnapshot& snapshot) {
+        const auto start = std::chrono::steady_clock::now();
+        const uint64_t step = static_cast<uint64_t>(position);
+        const std::size_t chunkA = findChunk(step);
+        schedule(chunkA, speed < 0.0f ? -1 : 1);
+
+        std::shared_ptr<const DecodedChunk> a = acquireChunk(chunkA);
+        if (!a->valid) return false;
+        std::size_t frameA = std::upper_bound(a->steps.begin(), a->steps.end(), step) - a->steps.begin();
+        frameA = frameA > 0 ? frameA - 1 : 0;
+
+        // The frame after the position may start the next chunk
+        std::shared_ptr<const DecodedChunk> b = a;
+        std::size_t frameB = frameA + 1;
+        if (frameB == a->steps.size()) {
+            frameB = frameA;
+            if (chunkA + 1 < chunks.size()) {
+                std::shared_ptr<const DecodedChunk> next = acquireChunk(chunkA + 1);
+                if (next->valid) {
+                    b = next;
+                    frameB = 0;
+                }
+            }
+        }
+
+        const uint64_t stepA = a->steps[frameA];
+        const uint64_t stepB = b->steps[frameB];
+        const float t = stepB > stepA ? static_cast<float>(std::min(std::max((position - stepA) / (stepB - stepA), 0.0), 1.0)) : 0.0f;
+        const float inverseTime = stepB > stepA ? 1.0f / ((stepB - stepA) * deltaTime) : 0.0f;
+
+        const std::size_t count = ballCount;
+        if (snapshot.radius.size() != count) {
+            snapshot.radius = radius;
+            snapshot.colorR = colorR;
+            snapshot.colorG = colorG;
+            snapshot.colorB = colorB;
+        }
+        snapshot.x.resize(count);
+        snapshot.y.resize(count);
+        snapshot.vx.resize(count);
+        snapshot.vy.resize(count);
+
+        const uint16_t* valuesA = a->values.data() + frameA * count * 2;
+        const uint16_t* valuesB = b->values.data() + frameB * count * 2;
+        const uint32_t levels = getQuantizationLevels(positionBits);
+        parallelFor(0, count, 16384, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; i++) {
+                const float xa = dequantizePosition(valuesA[i], levels);
+                const float ya = dequantizePosition(valuesA[count + i], levels);
+                const float xb = dequantizePosition(valuesB[i], levels);
+                const float yb = dequantizePosition(valuesB[count + i], levels);
+                snapshot.x[i] = xa + (xb - xa) * t;
+                snapshot.y[i] = ya + (yb - ya) * t;
+                snapshot.vx[i] = (xb - xa) * inverseTime;
+                snapshot.vy[i] = (yb - ya) * inverseTime;
+            }
+        });
+
+        snapshot.stepCount = static_cast<uint64_t>(std::llround(position));
+        snapshot.activeCount = count;
+        snapshot.sleepingCount = 0;
+        snapshot.advanceTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+
+private:
+    /**
+     * @struct DecodedChunk
+     * @brief Frames of one chunk, quantized.
+     */
+    struct DecodedChunk {
+        std::vector<uint64_t> steps;  /* Step of each frame */
+        std::vector<uint16_t> values; /* x then y of every ball, per frame */
+        bool valid = false;           /* Read and decoded without error */
+    };
+
+    /**
+     * @struct CachedChunk
+     * @brief A decoded chunk and its index.
+     */
+    struct CachedChunk {
+        std::size_t index;
+        std::shared_ptr<const DecodedChunk> chunk;
+    };
+
+    /**
+     * @brief Reads and validates the file header and the balls' constant attributes.
+     */
+    bool readHeader() {
+        TrajectoryFileHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) return false;
+        if (std::memcmp(header.magic, "GRVTRAJ", 8) != 0 || header.version != trajectoryFileVersion
+            || header.headerSize != sizeof(TrajectoryFileHeader) || header.headerCrc != computeTrajectoryHeaderCrc(header)
+            || header.positionBits < 8 || header.positionBits > 16 || header.framesPerChunk == 0
+            || header.ballCount > (fileSize - sizeof(header)) / (4 * sizeof(float))) {
+            return false;
+        }
+
+        ballCount = static_cast<std::size_t>(header.ballCount);
+        positionBits = header.positionBits;
+        framesPerChunk = header.framesPerChunk;
+        deltaTime = header.deltaTime;
+        std::vector<float>* attributes[] = { &radius, &colorR, &colorG, &colorB };
+        for (std::vector<float>* attribute : attributes) {
+            attribute->resize(ballCount);
+            if (!file.read(reinterpret_cast<char*>(attribute->data()), ballCount * sizeof(float))) return false;
+        }
+        dataStart = sizeof(header) + ballCount * 4 * sizeof(float);
+        return true;
+    }
+
+    /**
+     * @brief Reads the index entries that match the trajectory file, stopping at the first that does not.
+     */
+    void loadIndex(const std::string& indexPath) {
+        std::ifstream index(indexPath, std::ios::binary);
+        if (!index) return;
+        TrajectoryIndexHeader header;
+        if (!index.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, "GRVTIDX", 8) != 0
+            || header.version != trajectoryFileVersion || header.entrySize != sizeof(TrajectoryIndexEntry)) {
+            std::cerr << "ERROR::TRAJECTORY_REPLAY::INVALID_INDEX " << indexPath << std::endl;
+            return;
+        }
+
+        TrajectoryIndexEntry entry;
+        uint64_t offset = dataStart;
+        while (index.read(reinterpret_cast<char*>(&entry), sizeof(entry))) {
+            if (!isPlausible(entry, offset)) break;
+            chunks.push_back(entry);
+            offset = entry.offset + entry.size;
+        }
+    }
+
+    /**
+     * @brief Adds the chunks after the last indexed one by reading their headers.
+     */
+    void scanChunks() {
+        uint64_t offset = chunks.empty() ? dataStart : chunks.back().offset + chunks.back().size;
+        TrajectoryChunkHeader header;
+        std::vector<uint8_t> steps;
+        file.clear();
+        while (offset + sizeof(header) <= fileSize) {
+            file.seekg(static_cast<std::streamoff>(offset));
+            if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != trajectoryChunkMagic) break;
+
+            TrajectoryIndexEntry entry = {};
+            entry.firstStep = header.firstStep;
+            entry.lastStep = header.firstStep;
+            entry.offset = offset;
+            entry.size = sizeof(header) + header.payloadSize;
+            entry.frameCount = header.frameCount;
+
+            // The step differences lead the payload, at most ten bytes each
+            steps.resize(static_cast<std::size_t>(std::min<uint64_t>(header.payloadSize, uint64_t(header.frameCount) * 10)));
+            if (!file.read(reinterpret_cast<char*>(steps.data()), steps.size())) break;
+            const uint8_t* in = steps.data();
+            bool complete = true;
+            for (uint32_t frame = 1; frame < header.frameCount && complete; frame++) {
+                uint64_t stepDelta = 0;
+                complete = readVarint(in, steps.data() + steps.size(), stepDelta);
+                entry.lastStep += stepDelta;
+            }
+            if (!complete || !isPlausible(entry, offset)) break;
+            chunks.push_back(entry);
+            offset += entry.size;
+        }
+        file.clear();
+    }
+
+    /**
+     * @brief Checks that an index entry follows the previous chunk and lies inside the file.
+     */
+    bool isPlausible(const TrajectoryIndexEntry& entry, uint64_t expectedOffset) const {
+        return entry.offset == expectedOffset && entry.size > sizeof(TrajectoryChunkHeader) && entry.size <= fileSize - entry.offset
+            && entry.frameCount > 0 && entry.lastStep >= entry.firstStep
+            && (chunks.empty() || entry.firstStep > chunks.back().lastStep);
+    }
+
+    /**
+     * @brief Finds the chunk holding a step, or the last chunk before it.
+     */
+    std::size_t findChunk(uint64_t step) const {
+        const uint64_t first = chunks.front().firstStep;
+        if (step <= first) return 0;
+        // Without dropped steps every chunk holds framesPerChunk consecutive steps
+        const uint64_t guess = (step - first) / framesPerChunk;
+        if (guess < chunks.size() && chunks[guess].firstStep <= step
+            && (guess + 1 == chunks.size() || step < chunks[guess + 1].firstStep)) {
+            return static_cast<std::size_t>(guess);
+        }
+        auto next = std::upper_bound(chunks.begin(), chunks.end(), step,
+            [](uint64_t value, const TrajectoryIndexEntry& entry) { return value < entry.firstStep; });
+        return static_cast<std::size_t>(next - chunks.begin()) - 1;
+    }
+
+    /**
+     * @brief Queues the chunk at the playback position and the ones after it in the direction of play.
+     */
+    void schedule(std::size_t chunk, int direction) {
+        if (chunk == scheduledChunk && direction == scheduledDirection) return;
+        scheduledChunk = chunk;
+        scheduledDirection = direction;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            currentChunk = chunk;
+            // Requests for the old position are stale after a seek
+            pending.clear();
+            for (std::size_t k = 0; k <= prefetchCount; k++) {
+                const long long index = static_cast<long long>(chunk) + direction * static_cast<long long>(k);
+                if (index < 0 || index >= static_cast<long long>(chunks.size())) break;
+                if (!findCached(static_cast<std::size_t>(index))) pending.push_back(static_cast<std::size_t>(index));
+            }
+        }
+        requested.notify_one();
+    }
+
+    /**
+     * @brief Gets a decoded chunk, waiting for the decoder thread if it is not cached yet.
+     */
+    std::shared_ptr<const DecodedChunk> acquireChunk(std::size_t index) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (const CachedChunk* cached = findCached(index)) return cached->chunk;
+
+        const auto start = std::chrono::steady_clock::now();
+        if (std::find(pending.begin(), pending.end(), index) == pending.end()) {
+            pending.push_front(index);
+            requested.notify_one();
+        }
+        decoded.wait(lock, [&]() { return findCached(index) != nullptr; });
+        stats.waits++;
+        stats.waitMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return findCached(index)->chunk;
+    }
+
+    const CachedChunk* findCached(std::size_t index) const {
+        for (const CachedChunk& cached : cache) {
+            if (cached.index == index) return &cached;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Body of the decoder thread: decodes requested chunks until closed.
+     */
+    void run() {
+        std::vector<uint8_t> payload;
+        while (true) {
+            std::size_t index;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                requested.wait(lock, [this]() { return !running || !pending.empty(); });
+                if (!running) break;
+                index = pending.front();
+                pending.pop_front();
+                if (findCached(index)) continue;
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            std::shared_ptr<DecodedChunk> chunk = std::make_shared<DecodedChunk>();
+            chunk->valid = readChunk(chunks[index], payload, *chunk);
+            if (!chunk->valid) {
+                std::cerr << "ERROR::TRAJECTORY_REPLAY::CORRUPT_CHUNK " << index << std::endl;
+            }
+            const double decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                cache.push_back({ index, std::move(chunk) });
+                // Evict the chunks farthest from the playback position, but not the one just decoded, which
+                // the playback may be waiting for; the playback keeps its own references to chunks in use
+                while (cache.size() > cacheCapacity) {
+                    auto farthest = std::max_element(cache.begin(), cache.end() - 1, [this](const CachedChunk& a, const CachedChunk& b) {
+                        return getDistance(a.index) < getDistance(b.index);
+                    });
+                    cache.erase(farthest);
+                }
+                stats.chunksDecoded++;
+                stats.decodeMs += decodeMs;
+            }
+            decoded.notify_all();
+        }
+    }
+
+    std::size_t getDistance(std::size_t index) const {
+        return index > currentChunk ? index - currentChunk : currentChunk - index;
+    }
+
+    /**
+     * @brief Reads a chunk from the file, checks its payload and decodes it. Decoder thread only.
+     */
+    bool readChunk(const TrajectoryIndexEntry& entry, std::vector<uint8_t>& payload, DecodedChunk& chunk) {
+        TrajectoryChunkHeader header;
+        file.clear();
+        file.seekg(static_cast<std::streamoff>(entry.offset));
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || sizeof(header) + header.payloadSize != entry.size
+            || header.firstStep != entry.firstStep || header.frameCount != entry.frameCount) {
+            return false;
+        }
+        payload.resize(static_cast<std::size_t>(header.payloadSize));
+        if (!file.read(reinterpret_cast<char*>(payload.data()), payload.size())) return false;
+        if (updateCrc32(0, payload.data(), payload.size()) != header.payloadCrc) return false;
+        return decodeTrajectoryChunk(header, payload.data(), ballCount, chunk.steps, chunk.values);
+    }
+
+    std::ifstream file;                       /* Trajectory file, read by the decoder thread once open */
+    uint64_t fileSize = 0;                    /* Bytes in the trajectory file */
+    uint64_t dataStart = 0;                   /* Offset of the first chunk */
+    std::size_t ballCount = 0;                /* Balls in every frame */
+    uint32_t positionBits = 16;               /* Bits per quantized coordinate */
+    uint32_t framesPerChunk = 1;              /* Frames between keyframes */
+    float deltaTime = 0.0f;                   /* Length of one recorded step */
+    std::vector<float> radius;                /* Radius of each ball */
+    std::vector<float> colorR;                /* Red color channel of each ball */
+    std::vector<float> colorG;                /* Green color channel of each ball */
+    std::vector<float> colorB;                /* Blue color channel of each ball */
+    std::vector<TrajectoryIndexEntry> chunks; /* Every chunk, in step order */
+    std::size_t scannedChunks = 0;            /* Chunks found by scanning instead of in the index */
+    double position = 0.0;                    /* Playback position in steps */
+    std::size_t scheduledChunk = 0;           /* Chunk the prefetch was last queued from, playback thread only */
+    int scheduledDirection = 1;               /* Direction the prefetch was last queued in */
+    std::size_t prefetchCount = 4;            /* Chunks decoded ahead of the playback position */
+    std::size_t cacheCapacity = 10;           /* Decoded chunks kept */
+    std::thread thread;                       /* The decoder thread */
+    std::mutex mutex;                         /* Guards everything below */
+    std::condition_variable requested;        /* Signalled when chunks are queued or the replay closes */
+    std::condition_variable decoded;          /* Signalled when a chunk is decoded */
+    bool running = false;                     /* Cleared to stop the decoder thread */
+    std::deque<std::size_t> pending;          /* Chunks to decode, most urgent first */
+    std::vector<CachedChunk> cache;           /* Decoded chunks */
+    std::size_t currentChunk = 0;             /* Chunk at the playback position */
+    ReplayStats stats;                        /* Decoding work done so far */
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class TripleBuffer
+ * @brief Lock-free hand-over of the latest value from one writer thread to one reader thread.
+ *
+ * The writer owns one slot, the reader owns another and the third is shared.
+ * Publishing swaps the writer's slot with the shared one and marks it fresh;
+ * acquiring swaps the reader's slot with the shared one only if it is fresh.
+ * Neither side ever waits: the writer may publish faster than the reader reads,
+ * in which case intermediate values are dropped, and the reader keeps its
+ * current value until a newer one is published.
+ */
+template <typename T>
+class TripleBuffer {
+public:
+    /**
+     * @brief Gets the slot the writer fills before the next publish. Writer thread only.
+     */
+    T& getWriteBuffer() { return buffers[back]; }
+
+    /**
+     * @brief Hands the write buffer to the reader and takes over the shared slot. Writer thread only.
+     */
+    void publish() {
+        back = shared.exchange(static_cast<uint8_t>(back | freshBit), std::memory_order_acq_rel) & indexMask;
+    }
+
+    /**
+     * @brief Takes over the latest published value, if there is one, and returns the reader's slot. Reader thread only.
+     *
+     * The returned value stays valid until the next acquire. The reader owns
+     * it until then and may change it, e.g. to derive values for the moment it
+     * is read; the changes are lost once a newer value replaces it.
+     */
+    T& acquire() {
+        if (shared.load(std::memory_order_relaxed) & freshBit) {
+            front = shared.exchange(front, std::memory_order_acq_rel) & indexMask;
+        }
+        return buffers[front];
+    }
+
+    /**
+     * @brief Gets the reader's slot without looking for a newer value. Reader thread only.
+     */
+    const T& getReadBuffer() const { return buffers[front]; }
+
+private:
+    static constexpr uint8_t freshBit = 4;  /* Set while the shared slot holds an unread value */
+    static constexpr uint8_t indexMask = 3; /* Slot index bits */
+
+    T buffers[3];                     /* The three slots */
+    std::atomic<uint8_t> shared{ 1 }; /* Index of the shared slot, plus freshBit */
+    uint8_t back = 0;                 /* Slot owned by the writer */
+    uint8_t front = 2;                /* Slot owned by the reader */
+};
+
+#endif
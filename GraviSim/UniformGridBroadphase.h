@@ -0,0 +1,179 @@
+#ifndef UNIFORM_GRID_BROADPHASE_H
+#define UNIFORM_GRID_BROADPHASE_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "Broadphase.h"
+#include "FrameArena.h"
+#include "Parallel.h"
+
+/**
+ * @class UniformGridBroadphase
+ * @brief Spatial hash over the [-1, 1] world box, rebuilt every step with a counting sort.
+ *
+ * Cells are at least as wide as the largest ball diameter, so every overlap is
+ * found by looking at a ball's own cell and its eight neighbours. Each pair of
+ * cells is visited once by only scanning the "forward" half of the neighbourhood.
+ * Rows of cells are split into bands that are searched in parallel, each band
+ * collecting its own pairs in the frame arena of the thread searching it;
+ * the band lists are then concatenated in band order.
+ * Cells holding only sleeping balls are not searched against each other.
+ */
+class UniformGridBroadphase : public Broadphase {
+public:
+    void findPairs(const BallSystem& balls, std::vector<BallPair>& pairs) override {
+        pairs.clear();
+        stats.pairTests = 0;
+
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+        if (count < 2) {
+            stats.pairsFound = 0;
+            return;
+        }
+
+        buildGrid(balls);
+        arenas.reset();
+
+        const std::size_t bandCount = std::min<std::size_t>(gridSize, 4 * static_cast<std::size_t>(getWorkerCount()));
+        bandPairs.resize(bandCount);
+        bandTests.assign(bandCount, 0);
+        parallelFor(0, bandCount, 1, [&](std::size_t begin, std::size_t end) {
+            for (std::size_t band = begin; band < end; band++) {
+                bandPairs[band] = ArenaVector<BallPair>(ArenaAllocator<BallPair>(arenas.get()));
+                const int rowBegin = static_cast<int>(gridSize * band / bandCount);
+                const int rowEnd = static_cast<int>(gridSize * (band + 1) / bandCount);
+                searchRows(balls, rowBegin, rowEnd, bandPairs[band], bandTests[band]);
+            }
+        });
+
+        std::size_t pairCount = pairs.size();
+        for (std::size_t band = 0; band < bandCount; band++) pairCount += bandPairs[band].size();
+        reserveWithHeadroom(pairs, pairCount);
+        for (std::size_t band = 0; band < bandCount; band++) {
+            pairs.insert(pairs.end(), bandPairs[band].begin(), bandPairs[band].end());
+            stats.pairTests += bandTests[band];
+        }
+        stats.pairsFound = pairs.size();
+    }
+
+    const char* getName() const override { return "uniform-grid"; }
+
+    int getGridSize() const { return gridSize; }
+
+private:
+    /**
+     * @brief Finds the pairs whose first ball lies in the cell rows [rowBegin, rowEnd).
+     *
+     * @param balls System to search.
+     * @param rowBegin First row of cells.
+     * @param rowEnd One past the last row of cells.
+     * @param pairs Output list of the band.
+     * @param pairTests Counter of tests performed by the band.
+     */
+    void searchRows(const BallSystem& balls, int rowBegin, int rowEnd, ArenaVector<BallPair>& pairs, std::size_t& pairTests) const {
+        // Forward half of the 3x3 neighbourhood: east, north-west, north, north-east
+        static const int neighbourOffsets[4][2] = { { 1, 0 }, { -1, 1 }, { 0, 1 }, { 1, 1 } };
+
+        for (int cy = rowBegin; cy < rowEnd; cy++) {
+            for (int cx = 0; cx < gridSize; cx++) {
+                const int cell = cy * gridSize + cx;
+                const uint32_t begin = cellStart[cell];
+                const uint32_t end = cellStart[cell + 1];
+                if (begin == end) continue;
+                const bool cellAsleep = cellAwake[cell] == 0;
+
+                // Pairs inside the cell
+                for (uint32_t i = begin; i < end && !cellAsleep; i++) {
+                    for (uint32_t j = i + 1; j < end; j++) {
+                        testPair(balls, sortedBalls[i], sortedBalls[j], pairs, pairTests);
+                    }
+                }
+
+                // Pairs with the forward neighbours
+                for (const auto& offset : neighbourOffsets) {
+                    const int nx = cx + offset[0];
+                    const int ny = cy + offset[1];
+                    if (nx < 0 || nx >= gridSize || ny >= gridSize) continue;
+
+                    const int neighbour = ny * gridSize + nx;
+                    if (cellAsleep && cellAwake[neighbour] == 0) continue;
+                    const uint32_t neighbourBegin = cellStart[neighbour];
+                    const uint32_t neighbourEnd = cellStart[neighbour + 1];
+                    for (uint32_t i = begin; i < end; i++) {
+                        for (uint32_t j = neighbourBegin; j < neighbourEnd; j++) {
+                            testPair(balls, sortedBalls[i], sortedBalls[j], pairs, pairTests);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Chooses the cell size and bins every ball into its cell with a counting sort.
+     *
+     * @param balls System to bin.
+     */
+    void buildGrid(const BallSystem& balls) {
+        const uint32_t count = static_cast<uint32_t>(balls.size());
+
+        float maxRadius = 0.0f;
+        for (uint32_t i = 0; i < count; i++) {
+            maxRadius = std::max(maxRadius, balls.radius[i]);
+        }
+
+        // Cells must fit the largest ball; beyond ~N cells the sort only gets slower
+        const int maxCellsForRadius = maxRadius > 0.0f ? static_cast<int>(2.0f / (2.0f * maxRadius)) : 1;
+        const int maxCellsForCount = static_cast<int>(std::ceil(std::sqrt(static_cast<float>(count))));
+        gridSize = std::max(1, std::min(maxCellsForRadius, maxCellsForCount));
+        cellScale = gridSize / 2.0f;
+
+        const int cellCount = gridSize * gridSize;
+        cellStart.assign(cellCount + 1, 0);
+        cellAwake.assign(cellCount, 0);
+        ballCell.resize(count);
+        sortedBalls.resize(count);
+
+        // Count balls per cell
+        for (uint32_t i = 0; i < count; i++) {
+            const int cell = cellOf(balls.x[i], balls.y[i]);
+            ballCell[i] = cell;
+            cellStart[cell + 1]++;
+            cellAwake[cell] += balls.sleeping[i] ^ 1;
+        }
+
+        // Prefix sum gives the first slot of every cell
+        for (int cell = 0; cell < cellCount; cell++) {
+            cellStart[cell + 1] += cellStart[cell];
+        }
+
+        // Scatter ball indices into their cell's slots
+        cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t i = 0; i < count; i++) {
+            sortedBalls[cellCursor[ballCell[i]]++] = i;
+        }
+    }
+
+    /**
+     * @brief Maps a world position to a cell, clamping positions outside the box to the border cells.
+     */
+    int cellOf(float px, float py) const {
+        const int cx = std::min(gridSize - 1, std::max(0, static_cast<int>((px + 1.0f) * cellScale)));
+        const int cy = std::min(gridSize - 1, std::max(0, static_cast<int>((py + 1.0f) * cellScale)));
+        return cy * gridSize + cx;
+    }
+
+    int gridSize = 1;                             /* Number of cells along each axis */
+    float cellScale = 0.5f;                       /* Cells per world unit */
+    std::vector<uint32_t> cellStart;              /* First sorted slot of each cell, plus a sentinel */
+    std::vector<uint32_t> cellCursor;             /* Scatter cursors used during the counting sort */
+    std::vector<uint32_t> cellAwake;              /* Number of awake balls in each cell */
+    std::vector<uint32_t> ballCell;               /* Cell of each ball */
+    std::vector<uint32_t> sortedBalls;            /* Ball indices ordered by cell */
+    std::vector<ArenaVector<BallPair>> bandPairs; /* Pairs found by each band of rows, valid until the next search */
+    std::vector<std::size_t> bandTests;           /* Pair tests performed by each band of rows */
+    ThreadArenas arenas;                          /* Memory of the band pair lists */
+};
+
+#endif
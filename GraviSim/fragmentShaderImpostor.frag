@@ -0,0 +1,17 @@
+#version 330 core
+
+in vec2 localPosition;
+in vec3 vertexColor;
+
+out vec4 FragColor;
+
+void main()
+{
+    // Signed distance to the unit circle, negative inside
+    float distance = length(localPosition) - 1.0;
+    // Blend the edge over about one pixel
+    float coverage = clamp(0.5 - distance / fwidth(distance), 0.0, 1.0);
+    if (coverage <= 0.0)
+        discard;
+    FragColor = vec4(vertexColor, coverage);
+}
@@ -0,0 +1,334 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include "AllocationCounter.h"
+#include "Simulation.h"
+#include "Benchmark.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "TrajectoryRecorder.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// -----------------------------------------------
+// HEADLESS DRIVER
+// Runs the physics without a window or GL context,
+// so throughput can be measured on machines with
+// no display and no GPU.
+// -----------------------------------------------
+
+/**
+ * @struct HeadlessOptions
+ * @brief Command line settings of a headless run.
+ */
+struct HeadlessOptions {
+    std::size_t ballCount = 10000;                           /* Number of balls */
+    SceneDistribution scene = SceneDistribution::Box;        /* Placement of the generated balls */
+    float minRadius = 0.002f;                                /* Smallest ball radius */
+    float maxRadius = 0.005f;                                /* Largest ball radius */
+    float extent = 1.0f;                                     /* Size of the generated scene */
+    float speed = 0.5f;                                      /* Velocity scale of the generated scene */
+    int steps = 1000;                                        /* Number of physics steps */
+    float deltaTime = 1.0f / 120.0f;                         /* Length of one step */
+    unsigned int seed = 1;                                   /* Scene seed */
+    BroadphaseType broadphase = BroadphaseType::UniformGrid; /* Collision broadphase */
+    GravityMode gravity = GravityMode::Off;                  /* Mutual gravitation */
+    float theta = 0.5f;                                      /* Barnes-Hut opening angle */
+    bool sleeping = true;                                    /* Let resting balls fall asleep */
+    bool continuous = true;                                  /* Time of impact for fast balls */
+    std::string loadPath;                                    /* Scene file to start from instead of a random scene */
+    std::string savePath;                                    /* Scene file to write after the run */
+    std::string recordPath;                                  /* Trajectory file to record every step to */
+    RecorderSettings recording;                              /* Precision and overflow policy of the recording */
+};
+
+/**
+ * @brief Gets the peak resident set size of the process in bytes.
+ */
+std::size_t getPeakResidentSetSize() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return counters.PeakWorkingSetSize;
+    }
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+/**
+ * @brief Sums every position and velocity, so runs can be compared for determinism.
+ */
+double computeChecksum(const BallSystem& balls) {
+    double sum = 0.0;
+    for (std::size_t i = 0; i < balls.size(); i++) {
+        sum += balls.x[i] + balls.y[i] + balls.vx[i] + balls.vy[i];
+    }
+    return sum;
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [options]\n"
+              << "  --balls N            number of balls (default 10000)\n"
+              << "  --scene KIND         box | disc | plummer | lattice (default box)\n"
+              << "  --min-radius R       smallest radius (default 0.002)\n"
+              << "  --max-radius R       largest radius (default 0.005)\n"
+              << "  --extent E           half size or radius of the scene, at most 1 (default 1)\n"
+              << "  --speed V            velocity scale of the scene (default 0.5)\n"
+              << "  --steps N            physics steps to run (default 1000)\n"
+              << "  --dt T               step length in seconds (default 1/120)\n"
+              << "  --seed S             scene seed (default 1)\n"
+              << "  --threads N          worker threads, 0 = all hardware threads\n"
+              << "  --broadphase MODE    none | brute | grid | sap (default grid)\n"
+              << "  --gravity MODE       off | direct | bh (default off)\n"
+              << "  --theta T            Barnes-Hut opening angle (default 0.5)\n"
+              << "  --sleep on|off       let resting balls fall asleep (default on)\n"
+              << "  --ccd on|off         continuous collision for fast balls (default on)\n"
+              << "  --load PATH          start from a scene file instead of a random scene\n"
+              << "  --save PATH          write the final scene to a scene file\n"
+              << "  --record PATH        record every step to a trajectory file\n"
+              << "  --record-bits N      bits per recorded coordinate, 8 to 16 (default 16)\n"
+              << "  --record-chunk N     recorded frames between keyframes (default 64)\n"
+              << "  --record-policy P    drop | block, when the recorder falls behind (default drop)\n"
+              << "  --bench-*            run one of the benchmarks shared with GraviSim\n"
+              << "  --check-ccd          check head-on collisions of fast balls, non-zero exit on failure\n";
+}
+
+/**
+ * @brief Applies one option and its value.
+ *
+ * @param arg Option name.
+ * @param value Option value.
+ * @param options Options to update.
+ * @return False if the option is unknown or its value is invalid.
+ * @throws std::invalid_argument or std::out_of_range if a numeric value does not parse.
+ */
+bool parseOption(const std::string& arg, const std::string& value, HeadlessOptions& options) {
+    if (arg == "--balls") options.ballCount = std::stoul(value);
+    else if (arg == "--min-radius") options.minRadius = std::stof(value);
+    else if (arg == "--max-radius") options.maxRadius = std::stof(value);
+    else if (arg == "--extent") options.extent = std::stof(value);
+    else if (arg == "--speed") options.speed = std::stof(value);
+    else if (arg == "--steps") options.steps = std::stoi(value);
+    else if (arg == "--dt") options.deltaTime = std::stof(value);
+    else if (arg == "--seed") options.seed = static_cast<unsigned int>(std::stoul(value));
+    else if (arg == "--threads") setWorkerCount(static_cast<unsigned int>(std::stoul(value)));
+    else if (arg == "--theta") options.theta = std::stof(value);
+    else if (arg == "--sleep" || arg == "--ccd") {
+        if (value != "on" && value != "off") {
+            std::cerr << "ERROR::HEADLESS::EXPECTED_ON_OR_OFF " << arg << " " << value << std::endl;
+            return false;
+        }
+        (arg == "--sleep" ? options.sleeping : options.continuous) = value == "on";
+    }
+    else if (arg == "--load") options.loadPath = value;
+    else if (arg == "--save") options.savePath = value;
+    else if (arg == "--record") options.recordPath = value;
+    else if (arg == "--record-bits") options.recording.positionBits = static_cast<uint32_t>(std::stoul(value));
+    else if (arg == "--record-chunk") options.recording.framesPerChunk = static_cast<uint32_t>(std::stoul(value));
+    else if (arg == "--record-policy") {
+        if (value == "drop") options.recording.overflow = RecorderOverflow::Drop;
+        else if (value == "block") options.recording.overflow = RecorderOverflow::Block;
+        else {
+            std::cerr << "ERROR::HEADLESS::UNKNOWN_RECORD_POLICY " << value << std::endl;
+            return false;
+        }
+    }
+    else if (arg == "--scene") {
+        if (!parseSceneDistribution(value, options.scene)) {
+            std::cerr << "ERROR::HEADLESS::UNKNOWN_SCENE " << value << std::endl;
+            return false;
+        }
+    }
+    else if (arg == "--broadphase") {
+        if (value == "none") options.broadphase = BroadphaseType::None;
+        else if (value == "brute") options.broadphase = BroadphaseType::BruteForce;
+        else if (value == "grid") options.broadphase = BroadphaseType::UniformGrid;
+        else if (value == "sap") options.broadphase = BroadphaseType::SweepAndPrune;
+        else {
+            std::cerr << "ERROR::HEADLESS::UNKNOWN_BROADPHASE " << value << std::endl;
+            return false;
+        }
+    }
+    else if (arg == "--gravity") {
+        if (value == "off") options.gravity = GravityMode::Off;
+        else if (value == "direct") options.gravity = GravityMode::Direct;
+        else if (value == "bh") options.gravity = GravityMode::BarnesHut;
+        else {
+            std::cerr << "ERROR::HEADLESS::UNKNOWN_GRAVITY " << value << std::endl;
+            return false;
+        }
+    }
+    else {
+        std::cerr << "ERROR::HEADLESS::UNKNOWN_OPTION " << arg << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Parses the command line into options.
+ *
+ * @return False if the arguments are invalid or help was requested.
+ */
+bool parseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "ERROR::HEADLESS::MISSING_VALUE " << arg << std::endl;
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        try {
+            if (!parseOption(arg, value, options)) return false;
+        }
+        catch (const std::exception&) {
+            std::cerr << "ERROR::HEADLESS::INVALID_NUMBER " << arg << " " << value << std::endl;
+            return false;
+        }
+    }
+
+    if (options.minRadius <= 0.0f || options.maxRadius < options.minRadius || options.steps < 0 || options.deltaTime <= 0.0f) {
+        std::cerr << "ERROR::HEADLESS::INVALID_OPTIONS" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    try {
+        // --threads applies to the benchmarks as well
+        for (int i = 1; i + 1 < argc; i++) {
+            if (std::string(argv[i]) == "--threads") {
+                setWorkerCount(static_cast<unsigned int>(std::stoul(argv[i + 1])));
+            }
+        }
+        int benchmarkStatus = 0;
+        if (runBenchmarkCommand(argc, argv, benchmarkStatus)) {
+            return benchmarkStatus;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "ERROR::HEADLESS::INVALID_ARGUMENT " << e.what() << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    Simulation simulation;
+    simulation.collisionSolver.setBroadphase(options.broadphase);
+    simulation.gravitySolver.mode = options.gravity;
+    simulation.gravitySolver.theta = options.theta;
+    simulation.sleepSolver.enabled = options.sleeping;
+    simulation.ccdSolver.enabled = options.continuous;
+    if (!options.loadPath.empty()) {
+        if (!loadScene(options.loadPath, simulation.balls)) return 1;
+        options.ballCount = simulation.balls.size();
+    }
+    else {
+        SceneSettings scene;
+        scene.distribution = options.scene;
+        scene.ballCount = options.ballCount;
+        scene.minRadius = options.minRadius;
+        scene.maxRadius = options.maxRadius;
+        scene.extent = options.extent;
+        scene.speed = options.speed;
+        scene.seed = options.seed;
+        auto start = std::chrono::high_resolution_clock::now();
+        generateScene(simulation.balls, scene);
+        auto end = std::chrono::high_resolution_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        std::cout << "Generated " << options.ballCount << " balls (" << getSceneDistributionName(options.scene) << ") in " << ms << " ms, "
+                  << (ms > 0.0 ? options.ballCount / (ms * 1e3) : 0.0) << " M balls/s" << std::endl;
+    }
+
+    std::cout << "Headless run: " << options.ballCount << " balls, " << options.steps << " steps of "
+              << options.deltaTime << " s, seed " << options.seed << ", " << getWorkerCount() << " threads, "
+              << (simulation.collisionSolver.getBroadphase() ? simulation.collisionSolver.getBroadphase()->getName() : "no collisions") << ", "
+              << getSimdLevelName(simulation.balls.simdLevel) << std::endl;
+
+    TrajectoryRecorder recorder;
+    if (!options.recordPath.empty()) {
+        if (!recorder.open(options.recordPath, simulation.balls, options.deltaTime, options.recording)) return 1;
+        simulation.onStep = [&recorder](const Simulation& sim) { recorder.record(sim.balls, sim.getStepCount()); };
+    }
+
+    // Buffers grow during the first steps; after that a step allocates only when one outgrows its headroom, e.g. while contacts pile up
+    const int warmupSteps = 10;
+    uint64_t steadyAllocations = 0;
+    int allocatingSteps = 0;
+
+    double activeSum = 0.0;
+    std::size_t fastSum = 0;
+    std::size_t impactSum = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < options.steps; i++) {
+        const uint64_t allocationsBefore = getAllocationCount();
+        simulation.step(options.deltaTime);
+        if (i >= warmupSteps) {
+            const uint64_t allocations = getAllocationCount() - allocationsBefore;
+            steadyAllocations += allocations;
+            allocatingSteps += allocations != 0;
+        }
+        activeSum += simulation.getActiveCount();
+        fastSum += simulation.ccdSolver.getFastCount();
+        impactSum += simulation.ccdSolver.getImpactCount();
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    simulation.onStep = nullptr;
+    recorder.close();
+
+    const double seconds = std::chrono::duration<double>(end - start).count();
+    const double ballSteps = static_cast<double>(options.ballCount) * options.steps;
+    std::cout << "  time          " << seconds << " s" << std::endl;
+    std::cout << "  steps/sec     " << (seconds > 0.0 ? options.steps / seconds : 0.0) << std::endl;
+    std::cout << "  ns/ball-step  " << (ballSteps > 0.0 ? seconds * 1e9 / ballSteps : 0.0) << std::endl;
+    std::cout << "  active        " << (options.steps > 0 ? activeSum / options.steps : 0.0) << " balls on average, "
+              << simulation.getSleepingCount() << " sleeping at the end" << std::endl;
+    std::cout << "  continuous    " << fastSum << " fast ball-steps, " << impactSum << " impacts" << std::endl;
+    if (isCountingAllocations()) {
+        std::cout << "  allocations   " << steadyAllocations << " in " << allocatingSteps << " of the "
+                  << std::max(options.steps - warmupSteps, 0) << " steps after the first " << warmupSteps << ", on all threads" << std::endl;
+    }
+    std::cout << "  peak RSS      " << getPeakResidentSetSize() / (1024.0 * 1024.0) << " MiB" << std::endl;
+    std::cout << "  checksum      " << computeChecksum(simulation.balls) << std::endl;
+
+    if (!options.recordPath.empty()) {
+        const RecorderStats stats = recorder.getStats();
+        std::cout << "  recorded      " << stats.framesRecorded << " frames in " << stats.chunks << " chunks to " << options.recordPath
+                  << ", " << stats.framesDropped << " dropped, " << stats.blockedSteps << " blocked" << std::endl;
+        std::cout << "  compression   " << stats.rawBytes / (1024.0 * 1024.0) << " MiB raw -> " << stats.compressedBytes / (1024.0 * 1024.0)
+                  << " MiB, ratio " << stats.getCompressionRatio() << ", " << stats.getBytesPerSecond() / (1024.0 * 1024.0) << " MiB/s written" << std::endl;
+        if (stats.failed) return 1;
+    }
+
+    if (!options.savePath.empty()) {
+        if (!saveScene(simulation.balls, options.savePath)) return 1;
+        std::cout << "  saved         " << options.savePath << std::endl;
+    }
+    return 0;
+}
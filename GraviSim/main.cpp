@@ -1,20 +1,33 @@
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
+#include <chrono>
+#include <cstdio>
 #include <random>
 #include <vector>
 #include <iostream>
+#include <string>
+#include "AllocationCounter.h"
 #include "ShapeManager.h"
 #include "Shader.h"
 #include "Ball.h"
+#include "Simulation.h"
+#include "SimulationThread.h"
+#include "Benchmark.h"
+#include "FrameProfiler.h"
+#include "SceneRenderer.h"
+#include "SceneFile.h"
+#include "SceneGenerator.h"
+#include "TrajectoryRecorder.h"
+#include "TrajectoryReplay.h"
 
 // -----------------------------------------------
 // FUNCTION DEFINITIONS
 // -----------------------------------------------
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
-void processMouse(GLFWwindow* window, Shader& pullLineShader, ShapeManager& pullLine, int pullLineIndex);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
+void processMouse(GLFWwindow* window);
 void processKeyBoard(GLFWwindow* window);
-float getRandomFloat(float min, float max);
 void convertToOpenGLCoordinates(double xpos, double ypos, float& mouseX, float& mouseY);
 
 // -----------------------------------------------
@@ -22,17 +35,67 @@ void convertToOpenGLCoordinates(double xpos, double ypos, float& mouseX, float&
 // -----------------------------------------------
 #define SCR_WIDTH 800
 #define SCR_HEIGHT 800
-float lastFrameTime = 0.0f;
 bool isPressed = false;
 glm::vec2 endPos(0.0f, 0.0f);
-std::vector<Ball> ballList;
-Ball* selectedBall = nullptr;
-std::random_device rd;
-std::mt19937 gen(rd());
+Simulation simulation;
+SimulationThread simulationThread(simulation);
+TrajectoryRecorder recorder;
+TrajectoryReplay replay;
+SimulationSnapshot replaySnapshot;
+const SimulationSnapshot* renderSnapshot = nullptr;
+std::size_t selectedBall = BallSystem::npos;
+bool instancedRendering = true;
+bool impostorCircles = true;
+bool printProfile = false;
 
 using namespace std;
 
-int main() {
+int main(int argc, char** argv) {
+    // Command line options:
+    //   --threads N    threads of the physics job system, all hardware threads by default
+    //   --load PATH    start from a scene file, e.g. a checkpoint saved with K
+    //   --replay PATH  play a trajectory file, e.g. one recorded with R, instead of simulating
+    //   --balls N      generate N balls instead of the default five
+    //   --scene NAME   distribution of the generated balls, box by default
+    std::string loadPath;
+    std::string replayPath;
+    SceneSettings scene;
+    scene.distribution = SceneDistribution::Box;
+    scene.ballCount = 5;
+    scene.minRadius = 0.1f;
+    scene.maxRadius = 0.3f;
+    scene.speed = 0.0f;
+    scene.seed = std::random_device()();
+    for (int i = 1; i + 1 < argc; i++) {
+        if (std::string(argv[i]) == "--threads") {
+            setWorkerCount(static_cast<unsigned int>(std::stoul(argv[i + 1])));
+        }
+        if (std::string(argv[i]) == "--load") {
+            loadPath = argv[i + 1];
+        }
+        if (std::string(argv[i]) == "--replay") {
+            replayPath = argv[i + 1];
+        }
+        if (std::string(argv[i]) == "--balls") {
+            // Radii shrink with the count so the balls cover the same part of the box
+            scene.ballCount = std::max<std::size_t>(std::stoul(argv[i + 1]), 1);
+            const float meanRadius = std::min(std::sqrt(0.3f * 4.0f / (glm::pi<float>() * scene.ballCount)), 0.2f);
+            scene.minRadius = 0.5f * meanRadius;
+            scene.maxRadius = 1.5f * meanRadius;
+        }
+        if (std::string(argv[i]) == "--scene" && !parseSceneDistribution(argv[i + 1], scene.distribution)) {
+            cout << "Unknown scene " << argv[i + 1] << ", using box" << endl;
+        }
+    }
+
+    // -----------------------------------------------
+    // BENCHMARKS
+    // -----------------------------------------------
+    int benchmarkStatus = 0;
+    if (runBenchmarkCommand(argc, argv, benchmarkStatus)) {
+        return benchmarkStatus;
+    }
+
     // -----------------------------------------------
     // SETUP GLFW
     // -----------------------------------------------
@@ -53,6 +116,7 @@ int main() {
     // Set callback functions
     glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetKeyCallback(window, key_callback);
 
     // -----------------------------------------------
     // LOAD GLAD
@@ -62,27 +126,37 @@ int main() {
         cout << "Failed to initialize GLAD" << endl;
         return -1;
     }
-
-    // Create multiple balls
-    for (size_t i = 0; i < 5; i++) {
-        float randRadius = getRandomFloat(0.1f, 0.3f);
-        float randX = getRandomFloat(-1.0f + randRadius, 1.0f - randRadius);
-        float randY = getRandomFloat(-1.0f + randRadius, 1.0f - randRadius);
-        float randVelX = 0.0f;
-        float randVelY = 0.0f;
-        float randColorR = getRandomFloat(0.0f, 1.0f);
-        float randColorG = getRandomFloat(0.0f, 1.0f);
-        float randColorB = getRandomFloat(0.0f, 1.0f);
-
-        Ball ball(glm::vec3(randX, randY, 0.0f), glm::vec2(randVelX, randVelY), glm::vec3(randColorR, randColorG, randColorB), randRadius, 25);
-        ballList.emplace_back(ball);
+    // Persistent mapping for streaming buffers, if the driver has it
+    ShapeManager::loadBufferStorage((GLADloadproc)glfwGetProcAddress);
+    cout << "Streaming buffers: " << (ShapeManager::hasBufferStorage() ? "persistent mapped" : "unsynchronized map") << endl;
+
+    // Replay a recording, restore the scene, or create multiple balls
+    if (!replayPath.empty()) {
+        if (!replay.open(replayPath)) {
+            glfwTerminate();
+            return -1;
+        }
+        cout << "Replaying " << replay.getBallCount() << " balls, steps " << replay.getFirstStep() << " to " << replay.getLastStep()
+             << " in " << replay.getChunkCount() << " chunks from " << replayPath << endl;
+        cout << "Space pauses, Left/Right seek 5 s, Up/Down double/halve the speed, Backspace reverses, Home/End jump" << endl;
+    }
+    else if (!loadPath.empty() && loadScene(loadPath, simulation.balls)) {
+        cout << "Loaded " << simulation.balls.size() << " balls from " << loadPath << endl;
+    }
+    else {
+        auto start = std::chrono::steady_clock::now();
+        generateScene(simulation.balls, scene);
+        auto end = std::chrono::steady_clock::now();
+        const double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        cout << "Generated " << scene.ballCount << " balls (" << getSceneDistributionName(scene.distribution) << ", seed " << scene.seed
+             << ") in " << ms << " ms, " << (ms > 0.0 ? scene.ballCount / (ms * 1e3) : 0.0) << " M balls/s" << endl;
     }
 
     // -----------------------------------------------
     // SETUP SHADER
     // -----------------------------------------------
-    Shader myShader("vertexShader.vert", "fragmentShader.frag");
     Shader pullLineShader("vertexShaderLine.vert", "fragmentShader.frag");
+    UniformHandle<glm::vec3> pullLineColorUniform = pullLineShader.getUniform<glm::vec3>("color");
 
     // -----------------------------------------------
     // CREATE PULL LINE
@@ -93,90 +167,187 @@ int main() {
     pullLine.addAttribute(pullLineIndex, 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 
     // -----------------------------------------------
-    // CREATE DIRECTION LINE
+    // SETUP SCENE RENDERER
     // -----------------------------------------------
-    float directionLineVertices[] = { 0.0f, 0.0f, 0.0f, 0.0f };
-    ShapeManager directionLine;
-    int directionLineIndex = directionLine.createShape(directionLineVertices, sizeof(directionLineVertices));
-    directionLine.addAttribute(directionLineIndex, 0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
+    // Balls and direction lines, drawn from the snapshots of the simulation thread
+    SceneRenderer renderer(simulation.balls.material.segments, replay.isOpen() ? replay.getBallCount() : simulation.balls.size());
 
+    // Uniform lookups during setup are expected; from here on every frame should make none
+    Shader::resetUniformLookupCount();
 
     // -----------------------------------------------
-    // CREATE CIRCLE
+    // START SIMULATION THREAD
     // -----------------------------------------------
-    ShapeManager circle;
-    std::vector<int> circleIndices;
-    for (auto& ball : ballList) {
-        std::vector<float> circleVertices;
-        ball.generateBallVertices(circleVertices);
-        int circleIndex = circle.createShape(circleVertices.data(), circleVertices.size() * sizeof(float));
-        circle.addAttribute(circleIndex, 0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        circleIndices.push_back(circleIndex);
+    // From here on the simulation is only changed through commands and only read through snapshots
+    // A replay renders the recording instead and leaves the simulation idle
+    if (!replay.isOpen()) {
+        simulationThread.start();
     }
 
+    // -----------------------------------------------
+    // SETUP PROFILER
+    // -----------------------------------------------
+    // Phases of a frame, timed on the CPU and, where they issue GL work, on the GPU; P prints the statistics
+    FrameProfiler profiler;
+    const int inputPhase = profiler.addPhase("input", false);
+    const int physicsPhase = profiler.addPhase("physics", false);
+    const int uploadPhase = profiler.addPhase("upload");
+    const int drawPhase = profiler.addPhase("draw");
+    const int swapPhase = profiler.addPhase("swap", false);
+    uint64_t profiledStep = 0;
+
+    // Upload bandwidth and draw statistics, reported in the window title once per second
+    float statsStartTime = static_cast<float>(glfwGetTime());
+    unsigned int statsFrames = 0;
+    uint64_t statsStartStep = 0;
+    float lastFrameTime = statsStartTime;
+    renderer.resetUploadStats();
+    pullLine.resetUploadStats();
+
+    // Buffers grow during the first frames; after that a frame, including the steps behind it, should not allocate
+    const unsigned int warmupFrames = 10;
+    unsigned int frameCount = 0;
+    uint64_t frameAllocationsBefore = getAllocationCount();
+    uint64_t steadyAllocations = 0;
+    unsigned int allocatingFrames = 0;
 
     // -----------------------------------------------
     // MAIN LOOP
     // -----------------------------------------------
     while (!glfwWindowShouldClose(window)) {
-        // Process keyboard Input
-        processKeyBoard(window);
-
+        profiler.beginFrame();
         float currentTime = static_cast<float>(glfwGetTime());
-        float deltaTime = currentTime - lastFrameTime;
+        const float frameTime = currentTime - lastFrameTime;
         lastFrameTime = currentTime;
 
+        {
+            FrameProfiler::ScopedPhase phase(profiler, inputPhase);
+            // Poll IO events and process keyboard and mouse input
+            glfwPollEvents();
+            processKeyBoard(window);
+            processMouse(window);
+        }
+
+        // Render the latest state published by the simulation thread, or the recording at the playback position
+        if (replay.isOpen()) {
+            replay.advance(frameTime);
+            replay.fillSnapshot(replaySnapshot);
+        }
+        const SimulationSnapshot& snapshot = replay.isOpen() ? replaySnapshot : simulationThread.acquireSnapshot();
+        renderSnapshot = &snapshot;
+        // Physics runs on its own thread, which reports the time of each advance with the snapshot;
+        // a replay reports the time it took to fill the snapshot instead
+        if (snapshot.stepCount != profiledStep) {
+            profiler.addCpuSample(physicsPhase, snapshot.advanceTimeMs);
+            profiledStep = snapshot.stepCount;
+        }
+
+        profiler.beginPhase(uploadPhase);
         // Specify the color of the background
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         // Clean the back buffer and assign the new color to it
         glClear(GL_COLOR_BUFFER_BIT);
 
-        for (size_t i = 0; i < ballList.size(); i++) {
-            Ball& newBall = ballList[i];
-
-            // -----------------------------------------------
-            // UPDATE LINES
-            // -----------------------------------------------
-            // Update pull line vertices if a ball is selected
-            if (selectedBall != nullptr && selectedBall == &newBall) {
-                pullLineVertices[0] = selectedBall->position.x;
-                pullLineVertices[1] = selectedBall->position.y;
-                pullLineVertices[2] = endPos.x;
-                pullLineVertices[3] = endPos.y;
-                pullLine.updateBuffer(pullLineIndex, pullLineVertices, sizeof(pullLineVertices));
-            }
-            // Update direction line vertices
-            directionLineVertices[0] = 0.0f;
-            directionLineVertices[1] = 0.0f;
-            directionLineVertices[2] = newBall.radius;
-            directionLineVertices[3] = 0.0f;
-            directionLine.updateBuffer(directionLineIndex, directionLineVertices, sizeof(directionLineVertices));
-
-            // Move the ball
-            myShader.use();
-            myShader.setVec3("position", newBall.position);
-            newBall.updatePhysics(deltaTime);
-
-            // -----------------------------------------------
-            // RENDER
-            // -----------------------------------------------
-            // Render the ball
-            myShader.setVec3("color", newBall.color);
-            circle.renderShape(circleIndices[i], sizeof(float) * 3, GL_TRIANGLE_FAN);
-            // Render the direction line
-            myShader.setVec3("color", glm::vec3(0.0f, 0.0f, 0.0f));
-            glLineWidth(2.0f);
-            directionLine.renderShape(directionLineIndex, 2, GL_LINES);
+        // -----------------------------------------------
+        // UPDATE LINES
+        // -----------------------------------------------
+        // Update pull line vertices if a ball is selected
+        if (selectedBall != BallSystem::npos) {
+            pullLineVertices[0] = snapshot.x[selectedBall];
+            pullLineVertices[1] = snapshot.y[selectedBall];
+            pullLineVertices[2] = endPos.x;
+            pullLineVertices[3] = endPos.y;
+            pullLine.updateBuffer(pullLineIndex, pullLineVertices, sizeof(pullLineVertices));
+        }
+
+        // -----------------------------------------------
+        // UPLOAD INSTANCE DATA
+        // -----------------------------------------------
+        // Upload every ball once; the direction lines read it in every mode
+        renderer.upload(snapshot);
+        profiler.endPhase(uploadPhase);
+
+        // -----------------------------------------------
+        // RENDER
+        // -----------------------------------------------
+        profiler.beginPhase(drawPhase);
+        renderer.instanced = instancedRendering;
+        renderer.impostors = impostorCircles;
+        renderer.submit(snapshot);
+
+        // Render the pull line above the balls and their direction lines
+        RenderQueue& renderQueue = renderer.getQueue();
+        if (isPressed && selectedBall != BallSystem::npos) {
+            pullLine.submitShape(renderQueue, pullLineShader.ID, pullLineIndex, 8, GL_LINES, SceneRenderer::overlayLayer);
+            renderQueue.setUniform(pullLineColorUniform, glm::vec3(1.0f, 0.0f, 0.0f));
+            renderQueue.setLineWidth(2.0f);
+        }
+
+        // Issue the frame's draws sorted by state
+        renderer.flush();
+        profiler.endPhase(drawPhase);
+
+        if (printProfile) {
+            profiler.report(cout);
+            printProfile = false;
+        }
+
+        statsFrames++;
+        if (currentTime - statsStartTime >= 1.0f) {
+            const double seconds = currentTime - statsStartTime;
+            const double megabytes = (renderer.getUploadStats().bytes + pullLine.getUploadStats().bytes) / (1024.0 * 1024.0);
+            // Formatted into a fixed buffer so the title does not allocate
+            char title[256];
+            std::snprintf(title, sizeof(title),
+                "Gravity Simulation - %d fps, %d steps/s, %f MB/frame uploaded (%f MB/s), %u stalls, %u draws, %u program switches, %u VAO binds",
+                static_cast<int>(statsFrames / seconds + 0.5), static_cast<int>((snapshot.stepCount - statsStartStep) / seconds + 0.5),
+                megabytes / statsFrames, megabytes / seconds, renderer.getUploadStats().stalls, renderer.getRenderStats().draws,
+                renderer.getRenderStats().programSwitches, renderer.getRenderStats().vaoBinds);
+            glfwSetWindowTitle(window, title);
+            statsStartTime = currentTime;
+            statsStartStep = snapshot.stepCount;
+            statsFrames = 0;
+            renderer.resetUploadStats();
+            pullLine.resetUploadStats();
         }
 
-        // Process mouse input
-        processMouse(window, pullLineShader, pullLine, pullLineIndex);
+#ifndef NDEBUG
+        // Report frames whose uniforms were not all resolved from the cache
+        if (Shader::getUniformLookupCount() > 0) {
+            cout << "Uniform lookups this frame: " << Shader::getUniformLookupCount() << endl;
+            Shader::resetUniformLookupCount();
+        }
+#endif
 
-        // Swap buffers and poll IO events
+        // Swap buffers
+        profiler.beginPhase(swapPhase);
         glfwSwapBuffers(window);
-        glfwPollEvents();
+        profiler.endPhase(swapPhase);
+
+        const uint64_t frameAllocationsAfter = getAllocationCount();
+        if (++frameCount > warmupFrames) {
+            steadyAllocations += frameAllocationsAfter - frameAllocationsBefore;
+            allocatingFrames += frameAllocationsAfter != frameAllocationsBefore;
+        }
+        frameAllocationsBefore = frameAllocationsAfter;
     }
 
+    simulationThread.stop();
+    if (isCountingAllocations()) {
+        cout << "Allocations: " << steadyAllocations << " in " << allocatingFrames << " of the "
+             << (frameCount > warmupFrames ? frameCount - warmupFrames : 0) << " frames after the first " << warmupFrames
+             << ", on all threads" << endl;
+    }
+    recorder.close();
+    if (replay.isOpen()) {
+        const TrajectoryReplay::ReplayStats replayStats = replay.getStats();
+        cout << "Replay: " << replayStats.chunksDecoded << " chunks decoded, " << replayStats.waits << " waits ("
+             << replayStats.waitMs << " ms)" << endl;
+        replay.close();
+    }
+    renderer.cleanup();
+    pullLine.cleanup();
+    profiler.cleanup();
     glfwTerminate();
     return 0;
 }
@@ -186,18 +357,162 @@ void processKeyBoard(GLFWwindow* window) {
         glfwSetWindowShouldClose(window, true);
 }
 
-void processMouse(GLFWwindow* window, Shader& pullLineShader, ShapeManager& pullLine, int pullLineIndex) {
-    if (!isPressed || selectedBall == nullptr) return;
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    // While replaying, keys control the playback; keys that change the simulation do nothing
+    if (replay.isOpen()) {
+        if (action == GLFW_PRESS || action == GLFW_REPEAT) {
+            bool moved = true;
+            if (key == GLFW_KEY_SPACE) {
+                replay.paused = !replay.paused;
+            }
+            else if (key == GLFW_KEY_RIGHT || key == GLFW_KEY_LEFT) {
+                const double seconds = key == GLFW_KEY_RIGHT ? 5.0 : -5.0;
+                replay.seek(replay.getPosition() + seconds / replay.getDeltaTime());
+            }
+            else if (key == GLFW_KEY_UP) {
+                replay.speed *= 2.0f;
+            }
+            else if (key == GLFW_KEY_DOWN) {
+                replay.speed *= 0.5f;
+            }
+            else if (key == GLFW_KEY_BACKSPACE) {
+                replay.speed = -replay.speed;
+            }
+            else if (key == GLFW_KEY_HOME) {
+                replay.seek(static_cast<double>(replay.getFirstStep()));
+            }
+            else if (key == GLFW_KEY_END) {
+                replay.seek(static_cast<double>(replay.getLastStep()));
+            }
+            else {
+                moved = false;
+            }
+            if (moved) {
+                cout << "Replay: step " << static_cast<uint64_t>(replay.getPosition()) << " of " << replay.getLastStep() << ", speed "
+                     << replay.speed << (replay.paused ? ", paused" : "") << endl;
+            }
+        }
+        // Rendering and profiling keys still apply
+        if (key != GLFW_KEY_I && key != GLFW_KEY_Q && key != GLFW_KEY_P) return;
+    }
+
+    // Cycle through the broadphase algorithms
+    if (key == GLFW_KEY_B && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            switch (simulation.collisionSolver.getBroadphaseType()) {
+            case BroadphaseType::None:
+                simulation.collisionSolver.setBroadphase(BroadphaseType::BruteForce);
+                break;
+            case BroadphaseType::BruteForce:
+                simulation.collisionSolver.setBroadphase(BroadphaseType::UniformGrid);
+                break;
+            case BroadphaseType::UniformGrid:
+                simulation.collisionSolver.setBroadphase(BroadphaseType::SweepAndPrune);
+                break;
+            default:
+                simulation.collisionSolver.setBroadphase(BroadphaseType::None);
+                break;
+            }
+            Broadphase* broadphase = simulation.collisionSolver.getBroadphase();
+            cout << "Broadphase: " << (broadphase ? broadphase->getName() : "none") << endl;
+        });
+    }
+
+    // Toggle between fixed and variable time steps
+    if (key == GLFW_KEY_F && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            simulation.timestep.fixedTimestep = !simulation.timestep.fixedTimestep;
+            cout << "Timestep: " << (simulation.timestep.fixedTimestep ? "fixed" : "variable") << endl;
+        });
+    }
+
+    // Cycle through the mutual gravity modes
+    if (key == GLFW_KEY_G && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            switch (simulation.gravitySolver.mode) {
+            case GravityMode::Off:
+                simulation.gravitySolver.mode = GravityMode::BarnesHut;
+                cout << "Gravity: barnes-hut (theta " << simulation.gravitySolver.theta << ")" << endl;
+                break;
+            case GravityMode::BarnesHut:
+                simulation.gravitySolver.mode = GravityMode::Direct;
+                cout << "Gravity: direct" << endl;
+                break;
+            default:
+                simulation.gravitySolver.mode = GravityMode::Off;
+                cout << "Gravity: off" << endl;
+                break;
+            }
+        });
+    }
+
+    // Toggle between instanced and per-ball rendering
+    if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        instancedRendering = !instancedRendering;
+        cout << "Rendering: " << (instancedRendering ? "instanced" : "per ball") << endl;
+    }
+
+    // Toggle between quad impostors and triangle fans for the circles
+    if (key == GLFW_KEY_Q && action == GLFW_PRESS) {
+        impostorCircles = !impostorCircles;
+        cout << "Circles: " << (impostorCircles ? "quad impostors" : "triangle fans") << endl;
+    }
+
+    // Save a checkpoint of the scene between two steps
+    if (key == GLFW_KEY_K && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            if (saveScene(simulation.balls, "checkpoint.scene")) {
+                cout << "Saved " << simulation.balls.size() << " balls to checkpoint.scene" << endl;
+            }
+        });
+    }
+
+    // Start or stop recording every step to recording.traj
+    if (key == GLFW_KEY_R && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            if (recorder.isOpen()) {
+                simulation.onStep = nullptr;
+                recorder.close();
+                const RecorderStats stats = recorder.getStats();
+                cout << "Recording stopped: " << stats.framesRecorded << " frames, " << stats.framesDropped << " dropped, ratio "
+                     << stats.getCompressionRatio() << ", " << stats.getBytesPerSecond() / 1024.0 << " KiB/s" << endl;
+            }
+            else if (recorder.open("recording.traj", simulation.balls, simulation.timestep.fixedDeltaTime)) {
+                simulation.onStep = [](const Simulation& sim) { recorder.record(sim.balls, sim.getStepCount()); };
+                cout << "Recording " << simulation.balls.size() << " balls to recording.traj" << endl;
+            }
+        });
+    }
+
+    // Print the frame profile
+    if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+        printProfile = true;
+    }
+
+    // Toggle continuous collision detection of fast balls
+    if (key == GLFW_KEY_C && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            simulation.ccdSolver.enabled = !simulation.ccdSolver.enabled;
+            cout << "Continuous collision: " << (simulation.ccdSolver.enabled ? "on" : "off") << endl;
+        });
+    }
+
+    // Toggle sleeping of resting balls
+    if (key == GLFW_KEY_S && action == GLFW_PRESS) {
+        simulationThread.post([](Simulation& simulation) {
+            simulation.sleepSolver.enabled = !simulation.sleepSolver.enabled;
+            cout << "Sleeping: " << (simulation.sleepSolver.enabled ? "on" : "off") << " ("
+                 << simulation.getActiveCount() << " active, " << simulation.getSleepingCount() << " sleeping)" << endl;
+        });
+    }
+}
+
+void processMouse(GLFWwindow* window) {
+    if (!isPressed || selectedBall == BallSystem::npos) return;
 
     double xpos, ypos;
     glfwGetCursorPos(window, &xpos, &ypos);
     convertToOpenGLCoordinates(xpos, ypos, endPos.x, endPos.y);
-
-    // Render pull line
-    pullLineShader.use();
-    pullLineShader.setVec3("color", glm::vec3(1.0f, 0.0f, 0.0f));
-    glLineWidth(2.0f);
-    pullLine.renderShape(pullLineIndex, 8, GL_LINES);
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
@@ -210,11 +525,8 @@ void convertToOpenGLCoordinates(double xpos, double ypos, float& mouseX, float&
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
-    auto isPointInCircle = [](float x, float y, const Ball& ball) {
-        float dx = x - ball.position.x;
-        float dy = y - ball.position.y;
-        return (dx * dx + dy * dy) < (ball.radius * ball.radius);
-        };
+    // A recording cannot be pushed around
+    if (replay.isOpen()) return;
 
     double xpos, ypos;
     float mouseX, mouseY;
@@ -226,47 +538,36 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
         if (action == GLFW_PRESS) {
             isPressed = true;
-            selectedBall = nullptr;
 
-            // Find the selected ball
-            for (auto& newBall : ballList) {
-                if (isPointInCircle(mouseX, mouseY, newBall)) {
-                    selectedBall = &newBall;
-                    break;
-                }
-            }
+            // Find the selected ball where it is drawn
+            selectedBall = renderSnapshot ? renderSnapshot->findBallAt(mouseX, mouseY) : BallSystem::npos;
         }
         else if (action == GLFW_RELEASE) {
             isPressed = false;
 
-            if (selectedBall) {
+            if (selectedBall != BallSystem::npos) {
                 glfwGetCursorPos(window, &xpos, &ypos);
                 convertToOpenGLCoordinates(xpos, ypos, mouseX, mouseY);
 
                 endPos = glm::vec2(mouseX, mouseY);
-                startPos = selectedBall->position;
+                startPos = glm::vec2(renderSnapshot->x[selectedBall], renderSnapshot->y[selectedBall]);
                 glm::vec2 vectorComponents = endPos - startPos;
                 float magnitude = glm::length(vectorComponents);
 
                 if (magnitude > 0.0001f) {  // Prevent division by zero
                     glm::vec2 pullLineDirection = vectorComponents / magnitude * glm::distance(startPos, endPos);
-                    selectedBall->velocity = -pullLineDirection * 2.5f; // Multiply it by a constant for more force
+                    glm::vec2 velocity = -pullLineDirection * 2.5f; // Multiply it by a constant for more force
+                    std::size_t index = selectedBall;
+                    simulationThread.post([index, velocity](Simulation& simulation) {
+                        if (index >= simulation.balls.size()) return;
+                        Ball ball(simulation.balls, index);
+                        ball.setVelocity(velocity); // Also wakes the ball
+                    });
                 }
 
                 // Reset selection after release
-                selectedBall = nullptr;
+                selectedBall = BallSystem::npos;
             }
         }
     }
 }
-
-float getRandomFloat(float min, float max) {
-    std::uniform_real_distribution<float> dis(min, max);
-    return dis(gen);
-}
-
-// -----------------------------------------------
-// TASKS
-// -----------------------------------------------
-// TODO Implement collision between balls
-// FIX Reduce global variables
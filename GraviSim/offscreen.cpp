@@ -0,0 +1,353 @@
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include "AllocationCounter.h"
+#include "Simulation.h"
+#include "SimulationThread.h"
+#include "Benchmark.h"
+#include "SceneGenerator.h"
+#include "SceneRenderer.h"
+#include "FrameCapture.h"
+#include "FrameWriter.h"
+#include "TrajectoryReplay.h"
+
+// -----------------------------------------------
+// OFFSCREEN DRIVER
+// Renders the simulation without a window through
+// an EGL surfaceless context, e.g. Mesa llvmpipe on
+// machines with no display and no GPU, and writes
+// the frames to images or a raw video stream. Also
+// measures render throughput at a given ball count.
+// Run from the GraviSim directory: the shaders are
+// loaded relative to the working directory.
+// -----------------------------------------------
+
+/**
+ * @struct OffscreenOptions
+ * @brief Command line settings of an offscreen run.
+ */
+struct OffscreenOptions {
+    int width = 800;                                  /* Frame width in pixels */
+    int height = 800;                                 /* Frame height in pixels */
+    int frames = 600;                                 /* Number of frames to render */
+    float fps = 60.0f;                                /* Simulated frames per second of simulation time */
+    std::size_t ballCount = 10000;                    /* Number of balls */
+    SceneDistribution scene = SceneDistribution::Box; /* Placement of the generated balls */
+    float minRadius = 0.002f;                         /* Smallest ball radius */
+    float maxRadius = 0.005f;                         /* Largest ball radius */
+    unsigned int seed = 1;                            /* Scene seed */
+    FrameFormat format = FrameFormat::None;           /* Format of the written frames */
+    std::string output;                               /* Output file or file name pattern */
+    bool instanced = true;                            /* One instanced draw for all circles */
+    bool impostors = true;                            /* Quad impostors instead of triangle fans */
+    std::string replayPath;                           /* Trajectory file to render instead of simulating */
+    float speed = 1.0f;                               /* Replay speed, negative plays backwards */
+    double start = -1.0;                              /* Step the replay starts at, negative for the first */
+};
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [options]\n"
+              << "  --width N            frame width in pixels (default 800)\n"
+              << "  --height N           frame height in pixels (default 800)\n"
+              << "  --frames N           frames to render (default 600)\n"
+              << "  --fps F              frames per second of simulation time (default 60)\n"
+              << "  --balls N            number of balls (default 10000)\n"
+              << "  --scene KIND         box | disc | plummer | lattice (default box)\n"
+              << "  --min-radius R       smallest radius (default 0.002)\n"
+              << "  --max-radius R       largest radius (default 0.005)\n"
+              << "  --seed S             scene seed (default 1)\n"
+              << "  --threads N          worker threads, 0 = all hardware threads\n"
+              << "  --format FORMAT      none | ppm | png | raw (default none)\n"
+              << "  --output PATH        ppm/png: file name pattern with one %d, such as frame_%05d.png\n"
+              << "                       raw: file name, or - for standard output\n"
+              << "  --instanced on|off   one instanced draw for all circles (default on)\n"
+              << "  --impostors on|off   quad impostors instead of triangle fans (default on)\n"
+              << "  --replay PATH        render a recorded trajectory file instead of simulating\n"
+              << "  --speed S            replay speed, negative plays backwards (default 1)\n"
+              << "  --start STEP         step the replay starts at (default the first recorded)\n"
+              << "Raw output is rgb24, e.g. ffmpeg -f rawvideo -pix_fmt rgb24 -s WxH -r FPS -i - out.mp4\n";
+}
+
+/**
+ * @brief Parses the command line into options.
+ *
+ * @return False if the arguments are invalid or help was requested.
+ */
+bool parseOptions(int argc, char** argv, OffscreenOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--help" || arg == "-h") return false;
+        if (i + 1 >= argc) {
+            std::cerr << "ERROR::OFFSCREEN::MISSING_VALUE " << arg << std::endl;
+            return false;
+        }
+        const std::string value = argv[++i];
+
+        if (arg == "--width") options.width = std::stoi(value);
+        else if (arg == "--height") options.height = std::stoi(value);
+        else if (arg == "--frames") options.frames = std::stoi(value);
+        else if (arg == "--fps") options.fps = std::stof(value);
+        else if (arg == "--balls") options.ballCount = std::stoul(value);
+        else if (arg == "--min-radius") options.minRadius = std::stof(value);
+        else if (arg == "--max-radius") options.maxRadius = std::stof(value);
+        else if (arg == "--seed") options.seed = static_cast<unsigned int>(std::stoul(value));
+        else if (arg == "--threads") setWorkerCount(static_cast<unsigned int>(std::stoul(value)));
+        else if (arg == "--output") options.output = value;
+        else if (arg == "--instanced") options.instanced = value != "off";
+        else if (arg == "--impostors") options.impostors = value != "off";
+        else if (arg == "--replay") options.replayPath = value;
+        else if (arg == "--speed") options.speed = std::stof(value);
+        else if (arg == "--start") options.start = std::stod(value);
+        else if (arg == "--scene") {
+            if (!parseSceneDistribution(value, options.scene)) {
+                std::cerr << "ERROR::OFFSCREEN::UNKNOWN_SCENE " << value << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--format") {
+            if (value == "none") options.format = FrameFormat::None;
+            else if (value == "ppm") options.format = FrameFormat::Ppm;
+            else if (value == "png") options.format = FrameFormat::Png;
+            else if (value == "raw") options.format = FrameFormat::Raw;
+            else {
+                std::cerr << "ERROR::OFFSCREEN::UNKNOWN_FORMAT " << value << std::endl;
+                return false;
+            }
+        }
+        else {
+            std::cerr << "ERROR::OFFSCREEN::UNKNOWN_OPTION " << arg << std::endl;
+            return false;
+        }
+    }
+
+    if (options.format != FrameFormat::None && options.output.empty()) {
+        std::cerr << "ERROR::OFFSCREEN::MISSING_OUTPUT" << std::endl;
+        return false;
+    }
+    // The pattern is handed to snprintf, so anything but one frame number conversion gets the number added instead
+    if ((options.format == FrameFormat::Ppm || options.format == FrameFormat::Png) && !FrameWriter::isFramePattern(options.output)) {
+        options.output = FrameWriter::makeFramePattern(options.output);
+        std::cerr << "Output is not a pattern with one %d, writing frames to the pattern " << options.output << std::endl;
+    }
+    if (options.width <= 0 || options.height <= 0 || options.frames < 0 || options.fps <= 0.0f
+        || options.minRadius <= 0.0f || options.maxRadius < options.minRadius) {
+        std::cerr << "ERROR::OFFSCREEN::INVALID_OPTIONS" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Creates an OpenGL 3.3 core context without any surface and makes it current.
+ *
+ * Prefers Mesa's surfaceless platform, which needs neither a display server nor
+ * a GPU, and falls back to the default display.
+ *
+ * @return The display of the context, or EGL_NO_DISPLAY on failure.
+ */
+EGLDisplay createSurfacelessContext() {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "ERROR::OFFSCREEN::EGL_INITIALIZE_FAILED" << std::endl;
+        return EGL_NO_DISPLAY;
+    }
+
+    // Rendering goes to a framebuffer object, so any config that supports desktop GL will do
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, 0,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        std::cerr << "ERROR::OFFSCREEN::EGL_NO_CONFIG" << std::endl;
+        eglTerminate(display);
+        return EGL_NO_DISPLAY;
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        std::cerr << "ERROR::OFFSCREEN::EGL_CONTEXT_FAILED" << std::endl;
+        eglTerminate(display);
+        return EGL_NO_DISPLAY;
+    }
+    return display;
+}
+
+int main(int argc, char** argv) {
+    OffscreenOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    // Raw frames may go to standard output, so all reporting goes to standard error
+    std::ostream& log = std::cerr;
+
+    // -----------------------------------------------
+    // SETUP EGL
+    // -----------------------------------------------
+    EGLDisplay display = createSurfacelessContext();
+    if (display == EGL_NO_DISPLAY) {
+        return -1;
+    }
+
+    // -----------------------------------------------
+    // LOAD GLAD
+    // -----------------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        log << "Failed to initialize GLAD" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+    ShapeManager::loadBufferStorage((GLADloadproc)eglGetProcAddress);
+
+    // -----------------------------------------------
+    // SETUP SIMULATION
+    // -----------------------------------------------
+    // A replay feeds the renderer from the recording and leaves the simulation empty
+    Simulation simulation;
+    TrajectoryReplay replay;
+    if (!options.replayPath.empty()) {
+        if (!replay.open(options.replayPath)) {
+            eglTerminate(display);
+            return -1;
+        }
+        replay.speed = options.speed;
+        if (options.start >= 0.0) replay.seek(options.start);
+        options.ballCount = replay.getBallCount();
+    }
+    else {
+        SceneSettings scene;
+        scene.distribution = options.scene;
+        scene.ballCount = options.ballCount;
+        scene.minRadius = options.minRadius;
+        scene.maxRadius = options.maxRadius;
+        scene.seed = options.seed;
+        generateScene(simulation.balls, scene);
+    }
+    SimulationSnapshot snapshot;
+
+    int exitCode = 0;
+    {
+        // -----------------------------------------------
+        // SETUP RENDERING
+        // -----------------------------------------------
+        SceneRenderer renderer(simulation.balls.material.segments, options.ballCount);
+        renderer.instanced = options.instanced;
+        renderer.impostors = options.impostors;
+        FrameWriter writer(options.format, options.output, options.width, options.height);
+        FrameCapture capture(options.width, options.height, options.format != FrameFormat::None ? &writer : nullptr);
+        if (!capture.isComplete()) {
+            exitCode = -1;
+        }
+
+        log << "Offscreen run: " << options.ballCount << " balls, " << options.frames << " frames of "
+            << options.width << "x" << options.height << ", " << getWorkerCount() << " threads, "
+            << reinterpret_cast<const char*>(glGetString(GL_RENDERER)) << ", "
+            << (ShapeManager::hasBufferStorage() ? "persistent mapped" : "unsynchronized map") << " streaming" << std::endl;
+
+        // -----------------------------------------------
+        // RENDER LOOP
+        // -----------------------------------------------
+        // Every frame advances the simulation by the same time, so the output does not depend on the render speed
+        double physicsSeconds = 0.0;
+        double renderSeconds = 0.0;
+        double readbackSeconds = 0.0;
+        // Buffers grow during the first frames; after that a frame should not allocate
+        const int warmupFrames = 10;
+        uint64_t steadyAllocations = 0;
+        int allocatingFrames = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < options.frames && exitCode == 0; frame++) {
+            const uint64_t allocationsBefore = getAllocationCount();
+            auto phaseStart = std::chrono::steady_clock::now();
+            if (replay.isOpen()) {
+                if (frame > 0) replay.advance(1.0f / options.fps);
+                if (!replay.fillSnapshot(snapshot)) exitCode = -1;
+            }
+            else {
+                simulation.advance(1.0f / options.fps);
+                snapshot.capture(simulation);
+            }
+            auto now = std::chrono::steady_clock::now();
+            physicsSeconds += std::chrono::duration<double>(now - phaseStart).count();
+
+            phaseStart = now;
+            capture.bind();
+            glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
+            renderer.upload(snapshot);
+            renderer.submit(snapshot);
+            renderer.flush();
+            now = std::chrono::steady_clock::now();
+            renderSeconds += std::chrono::duration<double>(now - phaseStart).count();
+
+            phaseStart = now;
+            capture.capture();
+            readbackSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - phaseStart).count();
+
+            if (frame >= warmupFrames) {
+                const uint64_t allocations = getAllocationCount() - allocationsBefore;
+                steadyAllocations += allocations;
+                allocatingFrames += allocations != 0;
+            }
+        }
+        capture.finish();
+        glFinish();
+        writer.close();
+        auto end = std::chrono::steady_clock::now();
+
+        const double seconds = std::chrono::duration<double>(end - start).count();
+        const FrameWriter::WriterStats writerStats = writer.getStats();
+        log << "  time          " << seconds << " s" << std::endl;
+        log << "  frames/sec    " << (seconds > 0.0 ? options.frames / seconds : 0.0) << std::endl;
+        log << "  ms/frame      " << (options.frames > 0 ? seconds * 1e3 / options.frames : 0.0) << " total, "
+            << (options.frames > 0 ? physicsSeconds * 1e3 / options.frames : 0.0) << " physics, "
+            << (options.frames > 0 ? renderSeconds * 1e3 / options.frames : 0.0) << " render, "
+            << (options.frames > 0 ? readbackSeconds * 1e3 / options.frames : 0.0) << " readback" << std::endl;
+        if (isCountingAllocations()) {
+            log << "  allocations   " << steadyAllocations << " in " << allocatingFrames << " of the "
+                << std::max(options.frames - warmupFrames, 0) << " frames after the first " << warmupFrames << ", on all threads" << std::endl;
+        }
+        log << "  draws/frame   " << renderer.getRenderStats().draws << std::endl;
+        log << "  readbacks     " << capture.getStats().readbacks << ", " << capture.getStats().stalls << " waited for the GPU" << std::endl;
+        log << "  written       " << writerStats.frames << " frames, " << writerStats.bytes / (1024.0 * 1024.0) << " MiB, "
+            << writerStats.queueWaits << " waits for the writer" << std::endl;
+        if (replay.isOpen()) {
+            const TrajectoryReplay::ReplayStats replayStats = replay.getStats();
+            log << "  replayed      to step " << static_cast<uint64_t>(replay.getPosition()) << " of " << replay.getLastStep() << ", "
+                << replayStats.chunksDecoded << " chunks decoded, " << replayStats.waits << " waits (" << replayStats.waitMs << " ms)" << std::endl;
+        }
+        if (writerStats.failed) {
+            exitCode = -1;
+        }
+
+        capture.cleanup();
+        renderer.cleanup();
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglTerminate(display);
+    return exitCode;
+}
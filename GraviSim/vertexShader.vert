@@ -3,8 +3,10 @@
 layout (location = 0) in vec3 aPos; 
 
 uniform vec3 position; 
+uniform float radius;
 
 void main()
 {
-    gl_Position = vec4(aPos + position, 1.0);
+    // The mesh is a unit shape, scaled by the radius
+    gl_Position = vec4(aPos * radius + position, 1.0);
 }
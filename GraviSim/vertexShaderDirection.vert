@@ -0,0 +1,16 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 instancePosition;
+layout (location = 4) in vec2 instanceVelocity;
+
+uniform float velocityScale;
+
+out vec3 vertexColor;
+
+void main()
+{
+    // The unit line runs from the ball's center along its velocity, as far as the ball travels in velocityScale seconds
+    gl_Position = vec4(instancePosition + aPos.x * instanceVelocity * velocityScale, 0.0, 1.0);
+    vertexColor = vec3(0.0, 0.0, 0.0);
+}
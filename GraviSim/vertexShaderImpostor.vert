@@ -0,0 +1,18 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+
+uniform vec3 position;
+uniform float radius;
+uniform vec3 color;
+
+out vec2 localPosition;
+out vec3 vertexColor;
+
+void main()
+{
+    // The quad spans the unit square around the ball, scaled by the radius
+    gl_Position = vec4(aPos * radius + position.xy, position.z, 1.0);
+    localPosition = aPos;
+    vertexColor = color;
+}
@@ -0,0 +1,17 @@
+#version 330 core
+
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 instancePosition;
+layout (location = 2) in float instanceRadius;
+layout (location = 3) in vec3 instanceColor;
+
+out vec2 localPosition;
+out vec3 vertexColor;
+
+void main()
+{
+    // The quad spans the unit square around the ball, scaled by the radius and moved to the ball
+    gl_Position = vec4(aPos * instanceRadius + instancePosition, 0.0, 1.0);
+    localPosition = aPos;
+    vertexColor = instanceColor;
+}
@@ -0,0 +1,15 @@
+#version 330 core
+
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec2 instancePosition;
+layout (location = 2) in float instanceRadius;
+layout (location = 3) in vec3 instanceColor;
+
+out vec3 vertexColor;
+
+void main()
+{
+    // The mesh is a unit shape, scaled by the radius and moved to the ball
+    gl_Position = vec4(aPos.xy * instanceRadius + instancePosition, aPos.z, 1.0);
+    vertexColor = instanceColor;
+}